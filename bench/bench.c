@@ -0,0 +1,291 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "rubiks.h"
+#include "cube.h"
+#include "cubiestate.h"
+#include "random.h"
+#include "stepqueue.h"
+#include "timer.h"
+#include "quaternion.h"
+#include "view/rubiksmesh.h"
+#include "logger.h"
+#include "utils.h"
+
+// Microbenchmarks for the engine's hot paths. Each benchmark is calibrated
+// so one repetition runs for at least the target time, warmed up, then
+// timed over several repetitions. Results are one JSON object per line on
+// stdout with ns/op percentiles across the repetitions.
+
+#ifndef BENCH_BUILD
+#define BENCH_BUILD "unknown" // optimization flags, set by the Makefile
+#endif
+
+#define STATE_BUFFER_SIZE 4096
+#define QUEUE_PRELOAD 1000
+// Nearest-rank p99 only differs from the maximum from 100 repetitions up
+#define DEFAULT_REPS 100
+
+typedef struct {
+	const char *name;
+	void (*run)(long ops);
+} Benchmark;
+
+static void benchRotateFace(long ops);
+static void benchGetCubeAtPos(long ops);
+static void benchGetFaceColors(long ops);
+static void benchGetShownFace(long ops);
+static void benchWriteState(long ops);
+static void benchDeserializeState(long ops);
+static void benchQueue(long ops);
+static void benchWriteMatrix(long ops);
+static void benchWriteMatrices(long ops);
+static void benchBuildMesh(long ops);
+static void benchRandomize(long ops);
+
+static const Benchmark benchmarks[] = {
+	{ "rc_rotateFace", benchRotateFace },
+	{ "rc_getCubeAtPos", benchGetCubeAtPos },
+	{ "rc_getFaceColors", benchGetFaceColors },
+	{ "cube_getShownFace", benchGetShownFace },
+	{ "rc_writeState", benchWriteState },
+	{ "rc_deserializeState", benchDeserializeState },
+	{ "enqueue+dequeue", benchQueue },
+	{ "quat_writeMatrix", benchWriteMatrix },
+	{ "quat_writeMatrices", benchWriteMatrices },
+	{ "rc_buildMesh", benchBuildMesh },
+	{ "cs_randomize", benchRandomize },
+};
+
+#define NUM_BENCHMARKS (int)(sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+static Rubiks cube;
+static Rubiks scrambled; // cube is reset to this before every run
+static Random generator;
+static Random seeded;
+static char state[STATE_BUFFER_SIZE];
+static FILE *stateFile;
+static StepQueue queue;
+static float quatX[NUM_CUBES], quatY[NUM_CUBES], quatZ[NUM_CUBES], quatW[NUM_CUBES];
+static float matrices[NUM_CUBES*16];
+static float mesh[RUBIKS_MESH_FLOATS];
+static volatile int sink; // keeps results live
+static volatile float floatSink;
+
+static void printUsage(const char *name);
+static void setup();
+static void teardown();
+static long calibrate(const Benchmark *benchmark, double targetSeconds);
+static double timeRun(const Benchmark *benchmark, long ops);
+static void report(const Benchmark *benchmark, long ops, double *nsPerOp, int reps);
+
+int main(int argc, char *argv[]) {
+	int reps = DEFAULT_REPS;
+	int warmup = 5;
+	double targetMs = 10;
+	const char *filter = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "r:w:t:f:h")) != -1) {
+		switch (opt) {
+			case 'r':
+				reps = atoi(optarg);
+				break;
+			case 'w':
+				warmup = atoi(optarg);
+				break;
+			case 't':
+				targetMs = atof(optarg);
+				break;
+			case 'f':
+				filter = optarg;
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind != argc || reps < 1 || warmup < 0 || targetMs <= 0) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	setup();
+	double *nsPerOp = malloc(reps * sizeof(double));
+	for (int b=0; b<NUM_BENCHMARKS; b++) {
+		const Benchmark *benchmark = &benchmarks[b];
+		if (filter != NULL && strstr(benchmark->name, filter) == NULL) {
+			continue;
+		}
+		long ops = calibrate(benchmark, targetMs / 1000);
+		for (int i=0; i<warmup; i++) {
+			timeRun(benchmark, ops);
+		}
+		for (int i=0; i<reps; i++) {
+			nsPerOp[i] = timeRun(benchmark, ops) * 1e9 / ops;
+		}
+		report(benchmark, ops, nsPerOp, reps);
+	}
+	free(nsPerOp);
+	teardown();
+	return EXIT_SUCCESS;
+}
+
+static void printUsage(const char *name) {
+	fprintf(stderr, "Usage: %s [-r repetitions] [-w warmup] [-t target ms per repetition] [-f filter]\n", name);
+	fprintf(stderr, "\tRuns the benchmarks whose name contains filter and prints one JSON object\n");
+	fprintf(stderr, "\tper benchmark with ns/op percentiles across the repetitions (default %i).\n",
+		DEFAULT_REPS);
+	fprintf(stderr, "\tWith fewer than 100 repetitions p99 is the maximum.\n");
+}
+
+// Every run starts from the same deterministic scramble
+static void setup() {
+	random_seed(&generator, 1);
+	rc_initialize(&cube);
+	rc_shuffle(&cube, 100, &generator);
+	scrambled = cube;
+	seeded = generator;
+
+	stateFile = fmemopen(state, sizeof(state), "w");
+	if (stateFile == NULL) {
+		log_fatal("%s", "Unable to open state buffer");
+		exit(1);
+	}
+	rc_writeState(&cube, stateFile);
+	fflush(stateFile);
+
+	for (int i=0; i<NUM_CUBES; i++) {
+		quatX[i] = cube.cubes[i].quat.x;
+		quatY[i] = cube.cubes[i].quat.y;
+		quatZ[i] = cube.cubes[i].quat.z;
+		quatW[i] = cube.cubes[i].quat.w;
+	}
+
+	initQueue(&queue);
+	Step step = {0, CLOCKWISE};
+	enqueueMultiple(&queue, step, QUEUE_PRELOAD);
+}
+
+static void teardown() {
+	fclose(stateFile);
+	freeQueue(&queue);
+}
+
+// Double the op count until one run takes at least the target time
+static long calibrate(const Benchmark *benchmark, double targetSeconds) {
+	long ops = 1;
+	while (timeRun(benchmark, ops) < targetSeconds && ops < (1L << 40)) {
+		ops *= 2;
+	}
+	return ops;
+}
+
+static double timeRun(const Benchmark *benchmark, long ops) {
+	// rc_rotateFace turns the cube in place, so undo the last run's turns
+	cube = scrambled;
+	generator = seeded;
+	double start = timer_now();
+	benchmark->run(ops);
+	return timer_now() - start;
+}
+
+static void report(const Benchmark *benchmark, long ops, double *nsPerOp, int reps) {
+	qsort(nsPerOp, reps, sizeof(double), compareDoubles);
+	double mean = 0;
+	for (int i=0; i<reps; i++) {
+		mean += nsPerOp[i];
+	}
+	mean /= reps;
+	printf("{\"benchmark\":\"%s\",\"build\":\"%s\",\"ops_per_rep\":%li,\"reps\":%i,\"ns_per_op\":{"
+		"\"min\":%.3f,\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}}\n",
+		benchmark->name, BENCH_BUILD, ops, reps, nsPerOp[0], mean, percentile(nsPerOp, reps, 0.5),
+		percentile(nsPerOp, reps, 0.9), percentile(nsPerOp, reps, 0.99), nsPerOp[reps-1]);
+	fflush(stdout);
+}
+
+static void benchRotateFace(long ops) {
+	for (long i=0; i<ops; i++) {
+		rc_rotateFace(&cube, i % NUM_FACES, CLOCKWISE);
+	}
+}
+
+static void benchGetCubeAtPos(long ops) {
+	for (long i=0; i<ops; i++) {
+		sink = rc_getCubeAtPos(&cube, i % NUM_CUBES)->id;
+	}
+}
+
+static void benchGetFaceColors(long ops) {
+	char colors[FACE_SIZE];
+	for (long i=0; i<ops; i++) {
+		rc_getFaceColors(&cube, i % NUM_FACES, colors);
+		sink = colors[0];
+	}
+}
+
+static void benchGetShownFace(long ops) {
+	for (long i=0; i<ops; i++) {
+		sink = cube_getShownFace(&cube.cubes[i % NUM_CUBES], i % NUM_FACES);
+	}
+}
+
+static void benchWriteState(long ops) {
+	for (long i=0; i<ops; i++) {
+		rewind(stateFile);
+		rc_writeState(&cube, stateFile);
+	}
+	fflush(stateFile);
+}
+
+static void benchDeserializeState(long ops) {
+	Rubiks copy;
+	for (long i=0; i<ops; i++) {
+		rc_deserializeState(&copy, state);
+		sink = copy.cubes[0].position;
+	}
+}
+
+// Steady state with the queue neither empty nor growing
+static void benchQueue(long ops) {
+	for (long i=0; i<ops; i++) {
+		Step step = {i % NUM_FACES, CLOCKWISE};
+		enqueue(&queue, step);
+		sink = dequeue(&queue).face;
+	}
+}
+
+// One op is one cubie's matrix, as the mesh needs every frame
+static void benchWriteMatrix(long ops) {
+	for (long i=0; i<ops; i++) {
+		quat_writeMatrix(&cube.cubes[i % NUM_CUBES].quat, matrices);
+		floatSink = matrices[0];
+	}
+}
+
+// Same ops as above, converted a whole cube at a time
+static void benchWriteMatrices(long ops) {
+	for (long i=0; i<ops; i+=NUM_CUBES) {
+		int count = ops - i < NUM_CUBES ? ops - i : NUM_CUBES;
+		quat_writeMatrices(quatX, quatY, quatZ, quatW, count, matrices);
+		floatSink = matrices[0];
+	}
+}
+
+static void benchBuildMesh(long ops) {
+	for (long i=0; i<ops; i++) {
+		rc_buildMesh(&cube, -1, 0, mesh, NULL, NULL);
+		floatSink = mesh[0];
+	}
+}
+
+static void benchRandomize(long ops) {
+	CubieState state;
+	for (long i=0; i<ops; i++) {
+		cs_randomize(&state, &generator);
+		sink = state.cubeAt[0];
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef BIGCUBE_H
+#define BIGCUBE_H
+
+#include "cube.h"
+
+#define BIGCUBE_MIN_SIZE 2
+#define BIGCUBE_MAX_SIZE 256
+
+// Where a turn's strip lies on one neighboring face, as sticker indexes
+typedef struct {
+	int start; // first sticker of the strip in the outer layer
+	int along; // step to the next sticker of the strip
+	int inward; // step to the same sticker one layer deeper
+} BigCubeStrip;
+
+// NxN cube stored as stickers, one byte each holding the face it belongs
+// to. Each face is a size x size grid, row-major as seen from outside with
+// its ABOVE neighbor up. A layer turn moves four strips of size stickers,
+// plus the face grid when the layer is an outer one.
+typedef struct {
+	int size;
+	unsigned char *stickers; // NUM_FACES * size * size
+	BigCubeStrip strips[NUM_FACES][4]; // for each face, its neighbors' strips
+} BigCube;
+
+int bc_init(BigCube *cube, int size);
+void bc_free(BigCube *cube);
+void bc_reset(BigCube *cube);
+
+// layer counts inward from face, 0 turns just the face
+void bc_turn(BigCube *cube, int face, int layer, int direction);
+void bc_turnWide(BigCube *cube, int face, int layers, int direction);
+
+int bc_checkSolved(BigCube *cube);
+int bc_getSticker(BigCube *cube, int face, int row, int column);
+
+#endif
@@ -4,11 +4,23 @@
 #include "cube.h"
 #include "rubiks.h"
 
+// Quarter turn of any move in progress on one cube, advanced in fixed timesteps
+typedef struct {
+	int move; // -1 when idle
+	int direction;
+	double rotation; // progress through the turn, from 0 to 1
+	double previousRotation;
+	double accumulator; // simulated time not yet stepped
+} FaceAnimation;
+
 Vec3f rc_determineCubeCoord(Cube *cube);
-void rc_updateFaceRotations(Rubiks *rubiks, double rotationSpeed);
-void rc_beginFaceRotation(Rubiks *rubiks, int face, int direction, int instant);
-int rc_isRotating();
-int rc_faceIsRotating(int face);
-int rc_getFaceRotationDegrees(int face);
+
+// Each animated cube keeps its own FaceAnimation
+void rc_initAnimation(FaceAnimation *animation);
+void rc_updateAnimation(FaceAnimation *animation, Rubiks *rubiks, double turnsPerSecond, double elapsed);
+void rc_beginAnimation(FaceAnimation *animation, Rubiks *rubiks, int move, int direction, int instant);
+int rc_animationIsRotating(FaceAnimation *animation);
+int rc_animationMove(FaceAnimation *animation);
+float rc_animationDegrees(FaceAnimation *animation);
 
 #endif
@@ -1,10 +1,70 @@
 #ifndef SOLVERCONTROLLER_H
 #define SOLVERCONTROLLER_H
 
+#include <pthread.h>
+
 #include "rubiks.h"
+#include "stepqueue.h"
+#include "movechannel.h"
+#include "controller/rubikscontroller.h"
+#include "controller/solverstats.h"
+
+// Planning state threaded through the stage solvers, one per solve in flight
+typedef struct {
+	StepQueue queue; // steps planned but not yet published
+	long statesChecked; // stage checks run while planning, for solve statistics
+	int failed; // set when a solve function meets a state it can't handle
+} SolverPlan;
+
+// Solves and plays back moves for one cube. Solvers share nothing, so each
+// cube in a process can have its own, driven from its own thread.
+typedef struct {
+	SolverPlan plan;
+	MoveChannel channel; // published steps waiting for playback
+	Rubiks failedState; // last state that failed to plan, not retried
+	int haveFailedState;
+
+	// Background solver: the playback thread hands a snapshot over under
+	// workerLock and the worker pushes moves into the channel
+	pthread_t worker;
+	pthread_mutex_t workerLock;
+	pthread_cond_t workerWake;
+	int workerRunning;
+	int workerStopping;
+	int requestPending;
+	int requestGeneration;
+	Rubiks requestState;
+	Step *workerSolution;
+	int generation; // bumped by every request and cancel
+	double planSeconds; // of the last solve the worker finished
+	int planTimed; // planSeconds not yet taken
+
+	// Playback thread only
+	int awaiting; // a request is being solved or played back
+	int accepting; // moves popped belong to the current request
+} Solver;
 
-void solver_init();
+int solver_init(Solver *solver);
+void solver_free(Solver *solver);
 int solver_checkSolved(Rubiks *rubiks);
-void solver_solve(Rubiks *rubiks, int animationsOn);
+int solver_solve(Solver *solver, Rubiks *rubiks, FaceAnimation *animation, int animationsOn);
+
+// Solve on a background thread; solver_solve then only plays moves back
+int solver_startWorker(Solver *solver);
+void solver_stopWorker(Solver *solver);
+void solver_cancel(Solver *solver);
+// Time the worker took over its last solve, once per solve, for profiling
+int solver_takePlanTime(Solver *solver, double *seconds);
+
+// Planning and playback halves of solver_solve
+void solver_plan(Solver *solver, Rubiks *rubiks);
+int solver_playNext(Solver *solver, Rubiks *rubiks, FaceAnimation *animation, int animationsOn);
+
+// Precompute a full solution. Needs no Solver and may run on any number of
+// threads at once.
+int solver_computeSolution(Rubiks *rubiks, Step *solution, int *inProgress, int maxSteps, SolverStats *stats);
+
+// Stages are numbered in solving order, WHITE CROSS first
+const char *solver_stageName(int stage);
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef SOLVERSTATS_H
+#define SOLVERSTATS_H
+
+#include <stdio.h>
+#include "stepqueue.h"
+
+#define SOLVER_NUM_STAGES 5
+
+// Quarter turns count every step; half turns count a run of steps on the
+// same face as one move, or none if they cancel out. A run is credited to
+// the stage that began it, so stage half turns add up to the solve's.
+typedef struct {
+	int quarterTurns;
+	int halfTurns;
+	int plans; // times the stage's solve ran, more than once is a re-plan
+	long statesChecked; // stage checks run while planning it
+	double seconds; // wall time planning and applying its moves
+} SolverStageStats;
+
+typedef struct {
+	int solved;
+	int failedStage; // stage that stalled or failed to plan, or -1
+	int quarterTurns;
+	int halfTurns;
+	long statesChecked;
+	double seconds;
+	SolverStageStats stages[SOLVER_NUM_STAGES];
+} SolverStats;
+
+// Every solve of a batch is kept so percentiles can be taken at the end
+typedef struct {
+	SolverStats *solves;
+	int count;
+	int capacity;
+} SolverStatsAggregate;
+
+void stats_clear(SolverStats *stats);
+int stats_countHalfTurns(const Step *steps, int count);
+void stats_writeJSON(const SolverStats *stats, FILE *fp);
+
+void stats_initAggregate(SolverStatsAggregate *aggregate);
+int stats_addSolve(SolverStatsAggregate *aggregate, const SolverStats *stats);
+void stats_writeAggregateJSON(SolverStatsAggregate *aggregate, FILE *fp);
+void stats_freeAggregate(SolverStatsAggregate *aggregate);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef CUBIESTATE_H
+#define CUBIESTATE_H
+
+#include "rubiks.h"
+#include "quaternion.h"
+#include "random.h"
+
+#define NUM_ORIENTATIONS 24
+#define ORIENTATION_IDENTITY 0
+
+#define NUM_CORNERS 8
+#define NUM_EDGES 12
+
+// Corner and edge positions in the conventional order used by facelet strings
+// and coordinate tables: URF UFL ULB UBR DFR DLF DBL DRB / UR UF UL UB DR DF DL DB FR FL BL BR
+extern const unsigned char cornerSlots[NUM_CORNERS];
+extern const unsigned char edgeSlots[NUM_EDGES];
+
+// Compact, quaternion-free cube state. Every cube orientation is one of the
+// 24 rotations of the cube, stored as an index into a fixed table.
+typedef struct {
+	unsigned char cubeAt[NUM_CUBES];      // cube id occupying each position
+	unsigned char orientation[NUM_CUBES]; // rotation of the cube at each position
+} CubieState;
+
+// Permutation and orientation of the corners and edges, indexed by slot.
+// Twists are 0..2 and flips 0..1; center twist is not represented.
+typedef struct {
+	unsigned char cornerPerm[NUM_CORNERS];
+	unsigned char cornerTwist[NUM_CORNERS];
+	unsigned char edgePerm[NUM_EDGES];
+	unsigned char edgeFlip[NUM_EDGES];
+} CubieCoords;
+
+// State management
+void cs_initSolved(CubieState *state);
+void cs_fromRubiks(CubieState *state, Rubiks *rubiks);
+void cs_toRubiks(const CubieState *state, Rubiks *rubiks);
+void cs_rotateFace(CubieState *state, int face, int direction);
+int cs_checkSolved(const CubieState *state);
+
+// Coordinates assume the centers are at home
+void cs_toCoords(const CubieState *state, CubieCoords *coords);
+void cs_fromCoords(CubieState *state, const CubieCoords *coords);
+
+// Whether coordinates with no piece used twice describe a reachable state
+#define CS_COORDS_OK 0
+#define CS_COORDS_TWIST 1
+#define CS_COORDS_FLIP 2
+#define CS_COORDS_PARITY 3
+int cs_checkCoords(const CubieCoords *coords);
+
+// Uniformly random reachable state, centers at home
+void cs_randomCoords(CubieCoords *coords, Random *random);
+void cs_randomize(CubieState *state, Random *random);
+
+// Orientation tables
+int cs_orientationFromQuat(Quaternion *quat);
+Quaternion cs_orientationQuat(int orientation);
+int cs_orientationCompose(int outer, int inner);
+int cs_orientationInverse(int orientation);
+int cs_orientationFace(int orientation, int face);
+int cs_orientationPosition(int orientation, int position);
+int cs_faceTurn(int face, int direction);
+
+#endif
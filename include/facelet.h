@@ -0,0 +1,28 @@
+#ifndef FACELET_H
+#define FACELET_H
+
+#include "cubiestate.h"
+
+// Standard 54 character facelet strings: nine facelets for each of the
+// U, R, F, D, L and B faces in that order, each a face letter.
+#define FACELET_COUNT 54
+
+#define FACELET_OK 0
+#define FACELET_ERROR_LENGTH -1
+#define FACELET_ERROR_CHARACTER -2
+#define FACELET_ERROR_COUNT -3
+#define FACELET_ERROR_CENTERS -4
+#define FACELET_ERROR_CORNER -5
+#define FACELET_ERROR_EDGE -6
+#define FACELET_ERROR_DUPLICATE_CORNER -7
+#define FACELET_ERROR_DUPLICATE_EDGE -8
+#define FACELET_ERROR_TWIST -9
+#define FACELET_ERROR_FLIP -10
+#define FACELET_ERROR_PARITY -11
+
+// Buffer-only conversions, out/in are not NUL terminated
+void facelet_encode(const CubieState *state, char *out);
+int facelet_decode(CubieState *state, const char *in, int length);
+const char* facelet_errorString(int error);
+
+#endif
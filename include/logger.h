@@ -1,3 +1,6 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
 #include <stdio.h>
 
 #define LOG_TRACE 5
@@ -18,28 +21,34 @@
 #define WHT "\x1B[37m"
 #define RESET "\x1B[0m"
 
-#define LOG_LEVEL LOG_INFO
-
-#define log_trace(fmt, ...) \
-	do { if (LOG_LEVEL >= LOG_TRACE) fprintf(stderr, "[TRACE] %s:%d:%s(): " fmt "\n", __FILE__, \
-		__LINE__, __func__, __VA_ARGS__); } while (0)
-
-#define log_debug(fmt, ...) \
-	do { if (LOG_LEVEL >= LOG_DEBUG) fprintf(stderr, BLU "[DEBUG]" RESET " %s:%d:%s(): " fmt "\n", __FILE__, \
-		__LINE__, __func__, __VA_ARGS__); } while (0)
-
-#define log_info(fmt, ...) \
-	do { if (LOG_LEVEL >= LOG_INFO) fprintf(stderr, CYN "[INFO]" RESET " %s(): " fmt "\n", \
-		__func__, __VA_ARGS__); } while (0)
-
-#define log_warn(fmt, ...) \
-	do { if (LOG_LEVEL >= LOG_WARN) fprintf(stderr, YEL "[WARN]" RESET " %s:%d:%s(): " fmt "\n", __FILE__, \
-		__LINE__, __func__, __VA_ARGS__); } while (0)
-
-#define log_error(fmt, ...) \
-	do { if (LOG_LEVEL >= LOG_ERROR) fprintf(stderr, RED "[ERROR]" RESET " %s:%d:%s(): " fmt "\n", __FILE__, \
-		__LINE__, __func__, __VA_ARGS__); } while (0)
-
-#define log_fatal(fmt, ...) \
-	do { if (LOG_LEVEL >= LOG_FATAL) fprintf(stderr, BLD RED "[FATAL] %s:%d:%s(): " fmt RESET"\n", __FILE__, \
-		__LINE__, __func__, __VA_ARGS__); } while (0)
+// Calls above this level are compiled out; the rest are selected at run time
+#define LOG_LEVEL LOG_TRACE
+#define LOG_DEFAULT_LEVEL LOG_INFO
+
+// Highest level enabled for any module, so a disabled call costs one compare
+extern int logger_threshold;
+
+// Until logger_init starts the background writer, records are written
+// synchronously. Configure before starting other threads.
+int logger_init();
+void logger_shutdown();
+void logger_flush();
+int logger_configure(const char *spec);
+void logger_setLevel(int level);
+int logger_setModuleLevel(const char *module, int level);
+int logger_enabled(int level, const char *file);
+void logger_write(int level, const char *file, int line, const char *func, const char *fmt, ...)
+	__attribute__((format(printf, 5, 6)));
+
+#define log_at(level, ...) \
+	do { if ((level) <= LOG_LEVEL && (level) <= logger_threshold && logger_enabled(level, __FILE__)) \
+		logger_write(level, __FILE__, __LINE__, __func__, __VA_ARGS__); } while (0)
+
+#define log_trace(fmt, ...) log_at(LOG_TRACE, fmt, __VA_ARGS__)
+#define log_debug(fmt, ...) log_at(LOG_DEBUG, fmt, __VA_ARGS__)
+#define log_info(fmt, ...) log_at(LOG_INFO, fmt, __VA_ARGS__)
+#define log_warn(fmt, ...) log_at(LOG_WARN, fmt, __VA_ARGS__)
+#define log_error(fmt, ...) log_at(LOG_ERROR, fmt, __VA_ARGS__)
+#define log_fatal(fmt, ...) log_at(LOG_FATAL, fmt, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MOVECHANNEL_H
+#define MOVECHANNEL_H
+
+#include "stepqueue.h"
+
+#define MOVECHANNEL_CACHE_LINE 64
+
+// Lock-free single-producer/single-consumer ring of steps.
+// Exactly one thread may push and exactly one thread may pop.
+typedef struct {
+	Step *items;
+	unsigned int mask;
+	char pad0[MOVECHANNEL_CACHE_LINE];
+	unsigned int head; // next slot to pop, written by consumer only
+	char pad1[MOVECHANNEL_CACHE_LINE];
+	unsigned int tail; // next slot to push, written by producer only
+	char pad2[MOVECHANNEL_CACHE_LINE];
+} MoveChannel;
+
+int mc_init(MoveChannel *channel, int capacity);
+void mc_free(MoveChannel *channel);
+
+// Producer side
+int mc_push(MoveChannel *channel, Step step);
+int mc_pushMultiple(MoveChannel *channel, const Step *steps, int count);
+
+// Consumer side
+int mc_pop(MoveChannel *channel, Step *step);
+void mc_drain(MoveChannel *channel);
+
+int mc_size(MoveChannel *channel);
+int mc_isEmpty(MoveChannel *channel);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef NOTATION_H
+#define NOTATION_H
+
+#include "stepqueue.h"
+
+// Singmaster notation: face letters U D L R F B, wide moves u d l r f b (or
+// Uw, Dw, ...), slices M E S and rotations x y z, each optionally followed by
+// ' (counterclockwise) or 2 (half turn), separated by whitespace or nothing.
+// Half turns expand to two clockwise steps. Step faces hold move numbers.
+#define NOTATION_ERROR_SYNTAX -1
+#define NOTATION_ERROR_OVERFLOW -3
+
+int notation_parse(const char *text, int length, Step *steps, int maxSteps, int *errorOffset);
+int notation_format(const Step *steps, int count, char *out, int size);
+const char* notation_errorString(int error);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+
+// Per-section frame timings on the monotonic clock. Recent samples feed the
+// overlay, a log scale histogram of every sample feeds the exit summary.
+// Only the render thread records; work timed on other threads, like the
+// solver worker's plans, is handed over and added as a sample.
+
+#define PROF_FRAME 0
+#define PROF_PLAYBACK 1 // solver playback on the render thread
+#define PROF_UPDATE 2
+#define PROF_DRAW 3
+#define PROF_SWAP 4
+#define PROF_PLAN 5 // one sample per solve planned by the worker
+#define PROF_NUM_SECTIONS 6
+
+#define PROF_WINDOW 256 // recent samples per section
+
+typedef struct {
+	double last; // all times in milliseconds
+	double mean;
+	double p50;
+	double p99;
+	double max;
+	long count;
+} ProfStats;
+
+void prof_init();
+double prof_begin();
+void prof_end(int section, double start);
+void prof_addSample(int section, double ms);
+void prof_addMoves(int count);
+
+const char* prof_sectionName(int section);
+void prof_recentStats(int section, ProfStats *stats);
+void prof_totalStats(int section, ProfStats *stats);
+double prof_movesPerSecond();
+void prof_printSummary(FILE *fp);
+
+#endif
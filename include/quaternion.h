@@ -19,9 +19,16 @@ void quat_initEuler(Quaternion *quat, Vec3f angles);
 Quaternion quat_multiply(Quaternion *left, Quaternion *right);
 Vec3f quat_vecMultiply(Quaternion *left, Vec3f right);
 Quaternion quat_multiplyNoNormal(Quaternion *left, Quaternion *right);
-float* quat_toMatrix(Quaternion *quat);
+void quat_writeMatrix(Quaternion *quat, float mat[16]);
+// Batch form over struct-of-arrays components, writing count consecutive
+// 4x4 matrices laid out like quat_writeMatrix's
+void quat_writeMatrices(const float *x, const float *y, const float *z, const float *w,
+	int count, float *matrices);
 void quat_setEqual(Quaternion *q1, Quaternion *q2);
 int quat_checkEqual(Quaternion *q1, Quaternion *q2);
 int quat_checkIdentity(Quaternion *q1);
 
+// util methods
+float degToRad(float deg);
+
 #endif
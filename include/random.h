@@ -0,0 +1,23 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+// xoshiro256** generator. Each owner (a thread, a wall, a tool run) keeps its
+// own, so nothing is shared and a seed gives the same stream on any libc.
+typedef struct {
+	uint64_t s[4];
+} Random;
+
+void random_seed(Random *random, uint64_t seed);
+uint64_t random_next(Random *random);
+
+// Uniform in [0, bound), bound > 0
+uint32_t random_below(Random *random, uint32_t bound);
+// Uniform in [0, 1)
+double random_unit(Random *random);
+
+// Advance 2^128 draws, for non-overlapping streams from one seed
+void random_jump(Random *random);
+
+#endif
@@ -1,8 +1,11 @@
 #ifndef RUBIKS_H
 #define RUBIKS_H
 
+#include <stdio.h>
 #include "vector.h"
 #include "cube.h"
+#include "stepqueue.h"
+#include "random.h"
 
 #define CLOCKWISE 1
 #define COUNTERCLOCKWISE -1
@@ -10,9 +13,53 @@
 #define FACE_SIZE 9
 #define NUM_CUBES 27
 
+// Moves after the six outer faces, which keep their face numbers. Slices
+// turn the middle layer, wide moves an outer face with the slice beside it,
+// and rotations the whole cube, each in the direction of its axis face.
+#define SLICE_M 6 // like L
+#define SLICE_E 7 // like D
+#define SLICE_S 8 // like F
+#define WIDE_MOVES 9 // WIDE_MOVES + face
+#define ROTATE_X 15 // like R
+#define ROTATE_Y 16 // like U
+#define ROTATE_Z 17 // like F
+#define NUM_MOVES 18
+
+typedef struct {
+	const char *name;
+	int axis; // face the move turns like
+	int firstLayer; // layers turned, from -1 opposite the axis face to 1 at it
+	int lastLayer;
+} MoveData;
+
+static const MoveData moveData[NUM_MOVES] = {
+	{ "L", LEFT_FACE, 1, 1 },
+	{ "R", RIGHT_FACE, 1, 1 },
+	{ "D", DOWN_FACE, 1, 1 },
+	{ "U", UP_FACE, 1, 1 },
+	{ "F", FRONT_FACE, 1, 1 },
+	{ "B", BACK_FACE, 1, 1 },
+	{ "M", LEFT_FACE, 0, 0 },
+	{ "E", DOWN_FACE, 0, 0 },
+	{ "S", FRONT_FACE, 0, 0 },
+	{ "l", LEFT_FACE, 0, 1 },
+	{ "r", RIGHT_FACE, 0, 1 },
+	{ "d", DOWN_FACE, 0, 1 },
+	{ "u", UP_FACE, 0, 1 },
+	{ "f", FRONT_FACE, 0, 1 },
+	{ "b", BACK_FACE, 0, 1 },
+	{ "x", RIGHT_FACE, -1, 1 },
+	{ "y", UP_FACE, -1, 1 },
+	{ "z", FRONT_FACE, -1, 1 },
+};
+
+// Only outer faces ever move cubies. The frame records which physical face
+// is currently seen as each face, so a whole-cube rotation just relabels
+// the faces and later moves are read through it.
 typedef struct {
 	Cube cubes[NUM_CUBES];
 	int cubeInProgress;
+	int frame[NUM_FACES];
 } Rubiks;
 
 // Data management
@@ -23,7 +70,11 @@ Cube* rc_getCubeById(Rubiks *rubiks, int cubeId);
 
 // Control
 void rc_rotateFace(Rubiks *rubiks, int face, int direction);
-void rc_shuffle(Rubiks *rubiks, int times);
+void rc_applyMove(Rubiks *rubiks, int move, int direction);
+int rc_resolveMove(int frame[NUM_FACES], int move, int direction, Step turns[2]);
+int rc_frameFace(Rubiks *rubiks, int face);
+void rc_shuffle(Rubiks *rubiks, int times, Random *random);
+void rc_randomize(Rubiks *rubiks, Random *random);
 
 // State checking
 int rc_checkSolved(Rubiks *rubiks);
@@ -34,6 +85,7 @@ int rc_serialize(Rubiks *rubiks, char* out);
 int rc_getFaceColors(Rubiks *rubiks, int face, char* colors);
 
 void rc_serializeState(Rubiks *rubiks);
+void rc_writeState(Rubiks *rubiks, FILE *fp);
 void rc_deserializeState(Rubiks *rubiks, char* state);
 
 #endif
@@ -0,0 +1,22 @@
+#ifndef STATECODEC_H
+#define STATECODEC_H
+
+#include "cubiestate.h"
+
+// Binary state record: 2 byte magic, 1 byte version, then the orientation
+// index of every cube except the core packed at 5 bits each (little endian).
+#define STATE_BINARY_MAGIC0 'R'
+#define STATE_BINARY_MAGIC1 'C'
+#define STATE_BINARY_VERSION 1
+#define STATE_BINARY_HEADER_SIZE 3
+#define STATE_BINARY_SIZE 20
+
+int codec_isBinary(const unsigned char *in, int length);
+void codec_encodeBinary(const CubieState *state, unsigned char *out);
+int codec_decodeBinary(CubieState *state, const unsigned char *in);
+
+// Bulk variants over arrays of states and contiguous STATE_BINARY_SIZE records
+void codec_encodeBinaryBulk(const CubieState *states, int count, unsigned char *out);
+int codec_decodeBinaryBulk(CubieState *states, int count, const unsigned char *in);
+
+#endif
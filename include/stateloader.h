@@ -0,0 +1,27 @@
+#ifndef STATELOADER_H
+#define STATELOADER_H
+
+#include <stddef.h>
+#include "cubiestate.h"
+
+// Streams states out of a memory-mapped file. Binary files are a sequence of
+// STATE_BINARY_SIZE records; text files hold one state per line, either a
+// 54 character facelet string or the quaternion dump from rc_serializeState.
+// Blank lines and lines starting with '#' are skipped.
+typedef struct {
+	const char *data;
+	size_t size;
+	size_t offset;
+	size_t released;
+	int binary;
+	int line;
+} StateLoader;
+
+int loader_open(StateLoader *loader, const char *fileName);
+int loader_next(StateLoader *loader, CubieState *state);
+void loader_rewind(StateLoader *loader);
+void loader_close(StateLoader *loader);
+
+int loader_parseQuaternionState(CubieState *state, const char *text, size_t length);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef STATERANK_H
+#define STATERANK_H
+
+#include <stdint.h>
+#include "cubiestate.h"
+
+// Perfect index of a reachable state (centers at home, center twist ignored)
+// in [0, 43252003274489856000), a 66 bit value split into two words.
+typedef struct {
+	uint64_t high;
+	uint64_t low;
+} StateRank;
+
+#define RANK_COUNT_HIGH 2ull
+#define RANK_COUNT_LOW 6358515127070752768ull
+#define RANK_STRING_SIZE 21
+
+StateRank rank_fromState(const CubieState *state);
+int rank_toState(CubieState *state, StateRank rank);
+
+StateRank rank_fromCoords(const CubieCoords *coords);
+int rank_toCoords(CubieCoords *coords, StateRank rank);
+
+int rank_compare(StateRank a, StateRank b);
+int rank_isValid(StateRank rank);
+void rank_toString(StateRank rank, char *out);
+int rank_fromString(StateRank *rank, const char *text, int length);
+
+#endif
@@ -6,16 +6,21 @@
 typedef struct stepItem {
 	int face;
 	int direction;
-	struct stepItem *next;
 } Step;
 
+// Growable ring buffer of steps, capacity is always a power of two
 typedef struct stepQueue {
-	Step *first;
+	Step *items;
+	int capacity;
+	int head;
 	int size;
 } StepQueue;
 
 void initQueue(StepQueue *queue);
+void freeQueue(StepQueue *queue);
+void clearQueue(StepQueue *queue);
 void enqueue(StepQueue *queue, Step item);
 void enqueueMultiple(StepQueue *queue, Step item, int count);
+void enqueueSequence(StepQueue *queue, const Step *items, int count);
 Step dequeue(StepQueue *queue);
 #endif
@@ -0,0 +1,7 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+// Seconds on a monotonic clock, only meaningful as a difference
+double timer_now();
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Opt-in event tracing to Chrome trace event JSON, which chrome://tracing
+// and ui.perfetto.dev open as per-thread flame charts. Events are buffered
+// per thread and written when a buffer fills and on trace_close. Events a
+// thread records while the trace closes are dropped.
+//
+// Names and categories are not copied: pass string literals or other
+// strings that outlive the trace.
+
+// Nonzero while a trace file is open, so a disabled event costs one load and
+// compare. Read it atomically, as the macros below do.
+extern int trace_enabled;
+
+// trace_init opens the file named by RUBIKS_TRACE, if set
+int trace_init();
+int trace_open(const char *fileName);
+void trace_close();
+void trace_nameThread(const char *name);
+
+void trace_event(char phase, const char *name, const char *category);
+void trace_complete(const char *name, const char *category, double start, double end);
+
+#define trace_begin(name, category) \
+	do { if (__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)) trace_event('B', name, category); } while (0)
+#define trace_end(name, category) \
+	do { if (__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)) trace_event('E', name, category); } while (0)
+
+#endif
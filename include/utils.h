@@ -12,4 +12,9 @@ double maxd(double a, double b);
 double mind(double a, double b);
 int nearlyEqualF(float a, float b);
 
+// qsort comparator for ascending doubles
+int compareDoubles(const void *a, const void *b);
+// Nearest-rank percentile, p from 0 to 1, of count sorted values
+double percentile(const double *sorted, int count, double p);
+
 #endif
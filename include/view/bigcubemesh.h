@@ -0,0 +1,14 @@
+#ifndef BIGCUBEMESH_H
+#define BIGCUBEMESH_H
+
+#include "bigcube.h"
+
+// One quad per sticker
+#define BIGCUBE_MESH_VERTEX_COUNT(size) (NUM_FACES * (size) * (size) * 4)
+
+// Sticker quads in model space, spanning the same extent as the 3x3 cube,
+// and each sticker's face color. Both arrays hold 3 floats per vertex, and
+// the quads of each face are consecutive, in face order.
+void bc_buildMesh(BigCube *cube, float *positions, float *colors);
+
+#endif
@@ -1,3 +1,4 @@
 static const double cubeWidth = 0.2;
 static const RGB3f lineColor = {0.05, 0.05, 0.05};
 static const RGB3f inProgressLineColor = {1.0, 0.0, 0.0};
+static const RGB3f backgroundColor = {0.85, 0.85, 0.85};
@@ -4,6 +4,15 @@
 #include "utils.h"
 #include "cube.h"
 
-void cube_draw(Cube cube, Vec3f coords, RGB3f lineColor, double cubeWidth);
+// Six quads per cube
+#define CUBE_VERTEX_COUNT 24
+
+// Write a cube's 24 vertices, rotated by its rotation matrix (from its
+// quaternion) and then by the column-major placement transform, as xyz
+// triples into positions
+void cube_writeVertices(const float rotation[16], const float transform[16], float *positions);
+
+// Write per-vertex rgb fill colors and outline colors
+void cube_writeColors(const Cube *cube, RGB3f lineColor, float *fillColors, float *lineColors);
 
 #endif
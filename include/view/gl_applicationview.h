@@ -1,8 +1,9 @@
 #ifndef GLAPPLICATIONVIEW_H
 #define GLAPPLICATIONVIEW_H
 
-void glapp_init();
-void glapp_loadState(char* fileName);
+int glapp_init();
+int glapp_loadState(char* fileName);
+int glapp_showWall(int columns, int rows);
 int glapp_run();
 
 #endif
@@ -0,0 +1,8 @@
+#ifndef PROFILERVIEW_H
+#define PROFILERVIEW_H
+
+// Draw the rolling timing overlay in the top left of a width x height
+// pixel framebuffer
+void prof_draw(int width, int height);
+
+#endif
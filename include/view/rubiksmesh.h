@@ -0,0 +1,17 @@
+#ifndef RUBIKSMESH_H
+#define RUBIKSMESH_H
+
+#include "rubiks.h"
+#include "view/cubeview.h"
+
+#define RUBIKS_MESH_VERTEX_COUNT (NUM_CUBES * CUBE_VERTEX_COUNT)
+#define RUBIKS_MESH_FLOATS (RUBIKS_MESH_VERTEX_COUNT * 3)
+
+// Quads for every cubie in model space as seen through the cube's frame,
+// with the layers of move (or -1) turned by degrees about its axis. Each
+// array holds RUBIKS_MESH_FLOATS floats; the color arrays may both be NULL
+// when only positions are needed.
+void rc_buildMesh(Rubiks *rubiks, int move, float degrees,
+	float *positions, float *fillColors, float *lineColors);
+
+#endif
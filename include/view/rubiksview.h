@@ -2,6 +2,7 @@
 #define RUBIKSVIEW_H
 
 #include "rubiks.h"
+#include "controller/rubikscontroller.h"
 
-void rc_draw(Rubiks *rubiks);
+void rc_draw(Rubiks *rubiks, FaceAnimation *animation);
 #endif
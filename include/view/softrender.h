@@ -0,0 +1,31 @@
+#ifndef SOFTRENDER_H
+#define SOFTRENDER_H
+
+#include <stdio.h>
+#include "utils.h"
+#include "vector.h"
+#include "rubiks.h"
+#include "bigcube.h"
+
+// CPU rasterizer reproducing rc_draw without a GL context. Each framebuffer
+// is independent, so frames can be rendered on several threads at once.
+typedef struct {
+	int width;
+	int height;
+	unsigned char *pixels; // rgb, top row first
+	float *depth;
+} Framebuffer;
+
+int sr_initFramebuffer(Framebuffer *fb, int width, int height);
+void sr_freeFramebuffer(Framebuffer *fb);
+void sr_clear(Framebuffer *fb);
+
+// Draw the cube as the GL view would with the camera rotated by
+// rotation.x about x and then rotation.y about y, in degrees
+void sr_drawRubiks(Framebuffer *fb, Rubiks *rubiks, int move, float degrees, Vec2d rotation);
+int sr_drawBigCube(Framebuffer *fb, BigCube *cube, Vec2d rotation);
+
+int sr_writePPM(Framebuffer *fb, FILE *fp);
+int sr_writePNG(Framebuffer *fb, FILE *fp);
+
+#endif
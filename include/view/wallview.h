@@ -0,0 +1,10 @@
+#ifndef WALLVIEW_H
+#define WALLVIEW_H
+
+#include "vector.h"
+#include "wall.h"
+
+// Draw every cube of the wall facing the camera rotation, filling the view
+void wall_draw(Wall *wall, Vec2d rotation);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <pthread.h>
+
+#include "rubiks.h"
+#include "stepqueue.h"
+#include "controller/rubikscontroller.h"
+
+// A grid of independent cubes, each repeatedly shuffled and solved with its
+// own animation and precomputed solution. Solutions are planned on worker
+// threads so a new shuffle never stalls the frame.
+
+#define WALL_WORKERS 2
+
+typedef struct {
+	Rubiks rubiks;
+	FaceAnimation animation;
+	Step *solution;
+	int *inProgress; // cube being worked on by each solution move
+	int solutionLength;
+	int nextMove;
+	double idle; // seconds left before the next shuffle
+	unsigned int version; // changes whenever the cube needs redrawing
+	int waiting; // shuffled and queued for a worker, render thread only
+
+	// Handed over by a worker under the wall's lock
+	int solved;
+	Step *readySolution;
+	int *readyInProgress;
+	int readyLength; // -1 when the solve failed
+} WallCube;
+
+typedef struct {
+	int columns;
+	int rows;
+	WallCube *cubes; // row major, top row first
+	Random random; // shuffles and their timing
+
+	// Solver workers, fed shuffled cubes under lock
+	pthread_t workers[WALL_WORKERS];
+	int workerCount;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	int stopping;
+	int *queue; // indexes of cubes waiting for a worker, oldest first
+	int queueHead;
+	int queueCount;
+} Wall;
+
+int wall_init(Wall *wall, int columns, int rows, uint64_t seed);
+void wall_free(Wall *wall);
+int wall_update(Wall *wall, double turnsPerSecond, double elapsed);
+int wall_size(Wall *wall);
+
+#endif
@@ -0,0 +1,205 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bigcube.h"
+#include "rubiks.h"
+#include "logger.h"
+
+// Sticker centers are worked out on an integer grid where the faces lie at
+// +-size and neighboring sticker centers are 2 apart
+
+static void faceAxes(int face, int normal[3], int up[3], int right[3]);
+static int stickerIndex(int size, const int point[3]);
+static void rotateClockwise(int face, const int point[3], int rotated[3]);
+static void rotateGrid(unsigned char *grid, int size, int direction);
+static int dot(const int a[3], const int b[3]);
+static void toInts(Vec3f v, int out[3]);
+
+// Each face's strips are found once from the geometry: the strip on its
+// LEFT neighbor, then that strip turned clockwise onto each following
+// neighbor, so sticker i of one strip always lands on sticker i of the next
+int bc_init(BigCube *cube, int size) {
+	if (size < BIGCUBE_MIN_SIZE || size > BIGCUBE_MAX_SIZE) {
+		log_error("Cube size must be %i to %i, not %i", BIGCUBE_MIN_SIZE, BIGCUBE_MAX_SIZE, size);
+		return 0;
+	}
+	cube->size = size;
+	cube->stickers = malloc((size_t)NUM_FACES * size * size);
+	if (cube->stickers == NULL) {
+		log_error("Unable to allocate %ix%i cube", size, size);
+		return 0;
+	}
+	for (int face=0; face<NUM_FACES; face++) {
+		int normal[3], up[3], right[3], side[3];
+		faceAxes(face, normal, up, right);
+		toInts(faceData[faceData[face].neighbors[LEFT]].normal, side);
+
+		int points[3][3];
+		for (int axis=0; axis<3; axis++) {
+			int base = (size-1)*normal[axis] + size*side[axis] + (size-1)*up[axis];
+			points[0][axis] = base;
+			points[1][axis] = base - 2*up[axis];
+			points[2][axis] = base - 2*normal[axis];
+		}
+		for (int strip=0; strip<4; strip++) {
+			int start = stickerIndex(size, points[0]);
+			cube->strips[face][strip].start = start;
+			cube->strips[face][strip].along = stickerIndex(size, points[1]) - start;
+			cube->strips[face][strip].inward = stickerIndex(size, points[2]) - start;
+			for (int p=0; p<3; p++) {
+				int rotated[3];
+				rotateClockwise(face, points[p], rotated);
+				memcpy(points[p], rotated, sizeof(rotated));
+			}
+		}
+	}
+	bc_reset(cube);
+	return 1;
+}
+
+void bc_free(BigCube *cube) {
+	free(cube->stickers);
+	cube->stickers = NULL;
+	cube->size = 0;
+}
+
+void bc_reset(BigCube *cube) {
+	int area = cube->size * cube->size;
+	for (int face=0; face<NUM_FACES; face++) {
+		memset(cube->stickers + face*area, face, area);
+	}
+}
+
+// Clockwise as seen from face: each strip moves onto the next neighbor
+void bc_turn(BigCube *cube, int face, int layer, int direction) {
+	int size = cube->size;
+	if (face < 0 || face >= NUM_FACES || layer < 0 || layer >= size) {
+		log_error("Invalid turn of face %i layer %i", face, layer);
+		return;
+	}
+	unsigned char *s = cube->stickers;
+	const BigCubeStrip *strips = cube->strips[face];
+	int a = strips[0].start + layer*strips[0].inward;
+	int b = strips[1].start + layer*strips[1].inward;
+	int c = strips[2].start + layer*strips[2].inward;
+	int d = strips[3].start + layer*strips[3].inward;
+	for (int i=0; i<size; i++) {
+		unsigned char saved = s[d];
+		if (direction == CLOCKWISE) {
+			s[d] = s[c];
+			s[c] = s[b];
+			s[b] = s[a];
+			s[a] = saved;
+		} else {
+			s[d] = s[a];
+			s[a] = s[b];
+			s[b] = s[c];
+			s[c] = saved;
+		}
+		a += strips[0].along;
+		b += strips[1].along;
+		c += strips[2].along;
+		d += strips[3].along;
+	}
+
+	int area = size * size;
+	if (layer == 0) {
+		rotateGrid(s + face*area, size, direction);
+	}
+	if (layer == size-1) {
+		// seen from the opposite face the turn goes the other way
+		rotateGrid(s + (face^1)*area, size, -direction);
+	}
+}
+
+void bc_turnWide(BigCube *cube, int face, int layers, int direction) {
+	for (int layer=0; layer<layers; layer++) {
+		bc_turn(cube, face, layer, direction);
+	}
+}
+
+// Solved in any orientation: every face a single color
+int bc_checkSolved(BigCube *cube) {
+	int area = cube->size * cube->size;
+	for (int face=0; face<NUM_FACES; face++) {
+		const unsigned char *grid = cube->stickers + face*area;
+		for (int i=1; i<area; i++) {
+			if (grid[i] != grid[0]) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+int bc_getSticker(BigCube *cube, int face, int row, int column) {
+	return cube->stickers[(face*cube->size + row)*cube->size + column];
+}
+
+static void faceAxes(int face, int normal[3], int up[3], int right[3]) {
+	toInts(faceData[face].normal, normal);
+	toInts(faceData[faceData[face].neighbors[ABOVE]].normal, up);
+	toInts(faceData[faceData[face].neighbors[RIGHT]].normal, right);
+}
+
+static int stickerIndex(int size, const int point[3]) {
+	for (int face=0; face<NUM_FACES; face++) {
+		int normal[3], up[3], right[3];
+		faceAxes(face, normal, up, right);
+		if (dot(point, normal) == size) {
+			int row = (size - 1 - dot(point, up)) / 2;
+			int column = (dot(point, right) + size - 1) / 2;
+			return (face*size + row)*size + column;
+		}
+	}
+	log_fatal("No sticker at {%i, %i, %i}", point[0], point[1], point[2]);
+	exit(1);
+}
+
+// Turning clockwise as seen from face takes its ABOVE neighbor's direction
+// to its RIGHT neighbor's and RIGHT to BELOW
+static void rotateClockwise(int face, const int point[3], int rotated[3]) {
+	int normal[3], up[3], right[3];
+	faceAxes(face, normal, up, right);
+	int n = dot(point, normal);
+	int u = dot(point, up);
+	int r = dot(point, right);
+	for (int axis=0; axis<3; axis++) {
+		rotated[axis] = n*normal[axis] + u*right[axis] - r*up[axis];
+	}
+}
+
+// Rotate a face grid in place a ring at a time
+static void rotateGrid(unsigned char *grid, int size, int direction) {
+	int last = size - 1;
+	for (int row=0; row<size/2; row++) {
+		for (int col=row; col<last-row; col++) {
+			unsigned char *a = grid + row*size + col;
+			unsigned char *b = grid + col*size + last-row;
+			unsigned char *c = grid + (last-row)*size + last-col;
+			unsigned char *d = grid + (last-col)*size + row;
+			unsigned char saved = *d;
+			if (direction == CLOCKWISE) {
+				*d = *c;
+				*c = *b;
+				*b = *a;
+				*a = saved;
+			} else {
+				*d = *a;
+				*a = *b;
+				*b = *c;
+				*c = saved;
+			}
+		}
+	}
+}
+
+static int dot(const int a[3], const int b[3]) {
+	return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+static void toInts(Vec3f v, int out[3]) {
+	out[0] = (int)v.x;
+	out[1] = (int)v.y;
+	out[2] = (int)v.z;
+}
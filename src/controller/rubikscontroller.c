@@ -1,95 +1,91 @@
 #include <math.h>
+#include "utils.h"
 #include "vector.h"
 #include "logger.h"
 #include "controller/rubikscontroller.h"
 
-float faceRotationDegrees[NUM_FACES] = {0, 0, 0, 0, 0, 0};
-int faceRotationDirection[NUM_FACES] = {0, 0, 0, 0, 0, 0};
+#define ANIMATION_TIMESTEP (1.0 / 240)
+#define ANIMATION_MAX_BACKLOG 0.25 // seconds, drop time beyond this after a stall
 
+// Positions run left to right, back to front, top to bottom
 Vec3f rc_determineCubeCoord(Cube *cube) {
-	// TODO there has to be a smarter way to do this math
 	Vec3f coord;
+	coord.x = cube->position % 3 - 1;
+	coord.y = 1 - cube->position / 9;
+	coord.z = 1 - (cube->position / 3) % 3;
+	return coord;
+}
 
-	if (rc_checkCubeInFace(cube, LEFT_FACE)) {
-		coord.x = -1;
-	} else if (rc_checkCubeInFace(cube, RIGHT_FACE)) {
-		coord.x = 1;
-	} else {
-		coord.x = 0;
-	}
-
-	if (rc_checkCubeInFace(cube, DOWN_FACE)) {
-		coord.y = -1;
-	} else if (rc_checkCubeInFace(cube, UP_FACE)) {
-		coord.y = 1;
-	} else {
-		coord.y = 0;
-	}
+void rc_initAnimation(FaceAnimation *animation) {
+	animation->move = -1;
+	animation->direction = 0;
+	animation->rotation = 0;
+	animation->previousRotation = 0;
+	animation->accumulator = 0;
+}
 
-	if (rc_checkCubeInFace(cube, FRONT_FACE)) {
-		coord.z = -1;
-	} else if (rc_checkCubeInFace(cube, BACK_FACE)) {
-		coord.z = 1;
-	} else {
-		coord.z = 0;
+// Advance the move in fixed steps of simulated time. Time left over when a
+// turn completes carries into the next turn, so a sequence of turns takes
+// the same wall time at any frame rate.
+void rc_updateAnimation(FaceAnimation *animation, Rubiks *rubiks, double turnsPerSecond, double elapsed) {
+	if (!rc_animationIsRotating(animation)) {
+		animation->accumulator = 0;
+		return;
 	}
+	animation->accumulator = mind(animation->accumulator + elapsed, ANIMATION_MAX_BACKLOG);
 
-	return coord;
-}
-
-void rc_updateFaceRotations(Rubiks *rubiks, double rotationSpeed) {
-	int updatedFaces = 0;
-	for (int i=0; i<NUM_FACES; i++) {
-		if (faceRotationDirection[i]) {
-			updatedFaces++;
-			faceRotationDegrees[i] += rotationSpeed * faceRotationDirection[i];
-			if (fabsf(faceRotationDegrees[i]) >= 90) {
-				rc_rotateFace(rubiks, i, faceRotationDirection[i]);
-				faceRotationDegrees[i] = 0;
-				faceRotationDirection[i] = 0;
-			}
+	while (animation->accumulator >= ANIMATION_TIMESTEP) {
+		animation->accumulator -= ANIMATION_TIMESTEP;
+		animation->previousRotation = animation->rotation;
+		animation->rotation += turnsPerSecond * ANIMATION_TIMESTEP;
+		if (animation->rotation >= 1) {
+			rc_applyMove(rubiks, animation->move, animation->direction);
+			animation->move = -1;
+			animation->direction = 0;
+			animation->rotation = 0;
+			animation->previousRotation = 0;
+			break;
 		}
 	}
-	if (updatedFaces > 1) {
-		log_fatal("%s", "More than one face rotating at once!");
-	}
 }
 
-void rc_beginFaceRotation(Rubiks *rubiks, int face, int direction, int instant) {
-	log_debug("Begin face rotation: face: %i, direction: %i [instant=%s]",
-		face, direction, instant ? "yes" : "no"
+void rc_beginAnimation(FaceAnimation *animation, Rubiks *rubiks, int move, int direction, int instant) {
+	log_debug("Begin move: move: %i, direction: %i [instant=%s]",
+		move, direction, instant ? "yes" : "no"
 	);
 	if (direction != CLOCKWISE && direction != COUNTERCLOCKWISE) {
-		log_error("Invalid direction %i for face %i", direction, face);
+		log_error("Invalid direction %i for move %i", direction, move);
 		return;
 	}
-	if (face >= NUM_FACES || face < 0) {
-		log_error("Invalid face to rotate: %i", face);
+	if (move >= NUM_MOVES || move < 0) {
+		log_error("Invalid move: %i", move);
+		return;
 	}
 
-	log_debug("%c%s", faceData[face].name, direction==1?"":"`");
+	log_debug("%s%s", moveData[move].name, direction==1?"":"`");
 
-	if (!rc_isRotating()) {
+	if (!rc_animationIsRotating(animation)) {
 		if (instant) {
-			rc_rotateFace(rubiks, face, direction);
+			rc_applyMove(rubiks, move, direction);
 		} else {
-			faceRotationDirection[face] = direction;
+			animation->move = move;
+			animation->direction = direction;
 		}
 	}
 }
 
-int rc_isRotating() {
-	int alreadyRotating = 0;
-	for (int i=0; i<NUM_FACES; i++) {
-		alreadyRotating += (faceRotationDirection[i]!=0);
-	}
-	return alreadyRotating;
+int rc_animationIsRotating(FaceAnimation *animation) {
+	return animation->move != -1;
 }
 
-int rc_faceIsRotating(int face) {
-	return faceRotationDirection[face] != 0;
+int rc_animationMove(FaceAnimation *animation) {
+	return animation->move;
 }
 
-int rc_getFaceRotationDegrees(int face) {
-	return faceRotationDegrees[face];
+// Interpolate between the last two simulation steps for rendering
+float rc_animationDegrees(FaceAnimation *animation) {
+	double alpha = animation->accumulator / ANIMATION_TIMESTEP;
+	double turns = animation->previousRotation
+		+ (animation->rotation - animation->previousRotation) * alpha;
+	return 90 * turns * animation->direction;
 }
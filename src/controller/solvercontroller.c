@@ -1,13 +1,37 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "controller/solvercontroller.h"
+#include "controller/solverstats.h"
 #include "controller/rubikscontroller.h"
 #include "rubiks.h"
 #include "cube.h"
 #include "logger.h"
 #include "stepqueue.h"
+#include "movechannel.h"
+#include "timer.h"
+#include "trace.h"
+
+#define NUM_STEPS SOLVER_NUM_STAGES
+#define CHANNEL_CAPACITY 1024
+
+// planStage results besides a stage number
+#define PLAN_SOLVED -1
+#define PLAN_FAILED -2
+
+// The worker brackets each solve's moves with marker steps whose direction
+// is the generation of the request, so moves of a cancelled solve still in
+// the channel can be told apart and skipped
+#define MARK_BEGIN -1
+#define MARK_END -2
+#define MARK_FAILED -3
 
-#define NUM_STEPS 5
+#define WORKER_MAX_SOLUTION 4096
+#define WORKER_FULL_SLEEP_NS 1000000
 
 int checkCubesPosAndRot(Rubiks *rubiks, int *ids, int idsLength);
 int checkCurrentState(Rubiks *rubiks);
@@ -19,11 +43,11 @@ int checkMiddleLayer(Rubiks *rubiks);
 int checkDownFace(Rubiks *rubiks);
 int checkFinalLayer(Rubiks *rubiks);
 
-void solveWhiteCross(Rubiks *rubiks);
-void solveWhiteCorners(Rubiks *rubiks);
-void solveMiddleLayer(Rubiks *rubiks);
-void solveDownFace(Rubiks *rubiks);
-void solveFinalLayer(Rubiks *rubiks);
+void solveWhiteCross(SolverPlan *plan, Rubiks *rubiks);
+void solveWhiteCorners(SolverPlan *plan, Rubiks *rubiks);
+void solveMiddleLayer(SolverPlan *plan, Rubiks *rubiks);
+void solveDownFace(SolverPlan *plan, Rubiks *rubiks);
+void solveFinalLayer(SolverPlan *plan, Rubiks *rubiks);
 
 typedef struct{
 	int num;
@@ -42,14 +66,14 @@ typedef struct {
 } CornerPieceFaces;
 
 RotAndDir shortestDistanceToFace(int faceToRotate, int startSideFace, int desiredSideFace);
-RotAndDir rotateFaceToTarget(int faceToRotate, int fromFace, int toFace);
-EdgePieceFaces getEdgePieceFaces(Cube *cube);
-CornerPieceFaces getCornerPieceFaces(Cube *cube);
+RotAndDir rotateFaceToTarget(SolverPlan *plan, int faceToRotate, int fromFace, int toFace);
+EdgePieceFaces getEdgePieceFaces(SolverPlan *plan, Cube *cube);
+CornerPieceFaces getCornerPieceFaces(SolverPlan *plan, Cube *cube);
 
 typedef struct{
 	const char *name;
 	int (*checkFunction)(Rubiks *rubiks);
-	void (*solveFunction)(Rubiks *rubiks);
+	void (*solveFunction)(SolverPlan *plan, Rubiks *rubiks);
 } StepDefinition;
 
 StepDefinition steps[NUM_STEPS] = {
@@ -60,12 +84,56 @@ StepDefinition steps[NUM_STEPS] = {
 	{"FINAL LAYER", &checkFinalLayer, &solveFinalLayer}
 };
 
-StepQueue queue;
-void enqueueStep(int faceToRotate, int direction);
-void enqueueMultipleStep(int faceToRotate, int direction, int num);
+void enqueueStep(SolverPlan *plan, int faceToRotate, int direction);
+void enqueueMultipleStep(SolverPlan *plan, int faceToRotate, int direction, int num);
+static void initPlan(SolverPlan *plan);
+static void publishSteps(Solver *solver);
+static int planStage(SolverPlan *plan, Rubiks *rubiks);
+static void failPlan(SolverPlan *plan, const char *reason);
+static int computeSolution(Rubiks *rubiks, Step *solution, int *inProgress, int maxSteps, SolverStats *stats,
+	const int *generation, int watch);
+static int isFailedState(Solver *solver, Rubiks *rubiks);
+static void requestSolve(Solver *solver, Rubiks *rubiks);
+static void *workerMain(void *arg);
+static void solveSnapshot(Solver *solver, Rubiks *snapshot, int solving);
+static int pushStep(Solver *solver, Step step, int solving);
+
+int solver_init(Solver *solver) {
+	if (!mc_init(&solver->channel, CHANNEL_CAPACITY)) {
+		log_error("%s", "Unable to create solver move channel");
+		return 0;
+	}
+	initPlan(&solver->plan);
+	solver->haveFailedState = 0;
+	pthread_mutex_init(&solver->workerLock, NULL);
+	pthread_cond_init(&solver->workerWake, NULL);
+	solver->workerRunning = 0;
+	solver->workerStopping = 0;
+	solver->requestPending = 0;
+	solver->requestGeneration = 0;
+	solver->workerSolution = NULL;
+	solver->generation = 0;
+	solver->planSeconds = 0;
+	solver->planTimed = 0;
+	solver->awaiting = 0;
+	solver->accepting = 0;
+	return 1;
+}
 
-void solver_init() {
-	initQueue(&queue);
+void solver_free(Solver *solver) {
+	solver_stopWorker(solver);
+	freeQueue(&solver->plan.queue);
+	mc_free(&solver->channel);
+	pthread_mutex_destroy(&solver->workerLock);
+	pthread_cond_destroy(&solver->workerWake);
+	free(solver->workerSolution);
+	solver->workerSolution = NULL;
+}
+
+static void initPlan(SolverPlan *plan) {
+	initQueue(&plan->queue);
+	plan->statesChecked = 0;
+	plan->failed = 0;
 }
 
 int solver_checkSolved(Rubiks *rubiks) {
@@ -144,26 +212,331 @@ int checkFinalLayer(Rubiks* rubiks) {
 	return checkCubesPosAndRot(rubiks, downFaceCubeIds, DOWN_FACE_NUM_CUBES);
 }
 
-void solver_solve(Rubiks *rubiks, int animationsOn) {
-	if (rc_isRotating()) {
+// Returns 1 if a move was started. With the worker running this only asks
+// for a solve of the current state and plays back what has arrived.
+int solver_solve(Solver *solver, Rubiks *rubiks, FaceAnimation *animation, int animationsOn) {
+	if (rc_animationIsRotating(animation)) {
+		return 0;
+	}
+
+	if (solver->workerRunning) {
+		if (!solver->awaiting && !isFailedState(solver, rubiks)) {
+			requestSolve(solver, rubiks);
+		}
+	} else if (mc_isEmpty(&solver->channel)) {
+		solver_plan(solver, rubiks);
+	}
+	return solver_playNext(solver, rubiks, animation, animationsOn);
+}
+
+int solver_startWorker(Solver *solver) {
+	if (solver->workerRunning) {
+		return 1;
+	}
+	if (solver->workerSolution == NULL) {
+		solver->workerSolution = malloc(WORKER_MAX_SOLUTION * sizeof(Step));
+		if (solver->workerSolution == NULL) {
+			log_error("%s", "Unable to allocate solver worker, solving on the calling thread");
+			return 0;
+		}
+	}
+	solver->workerStopping = 0;
+	if (pthread_create(&solver->worker, NULL, workerMain, solver) != 0) {
+		log_error("%s", "Unable to start solver worker, solving on the calling thread");
+		return 0;
+	}
+	solver->workerRunning = 1;
+	return 1;
+}
+
+void solver_stopWorker(Solver *solver) {
+	if (!solver->workerRunning) {
 		return;
 	}
+	solver_cancel(solver);
+	pthread_mutex_lock(&solver->workerLock);
+	solver->workerStopping = 1;
+	pthread_cond_signal(&solver->workerWake);
+	pthread_mutex_unlock(&solver->workerLock);
+	pthread_join(solver->worker, NULL);
+	solver->workerRunning = 0;
+	mc_drain(&solver->channel);
+}
+
+// Drop the moves of any solve in progress, e.g. when the user turns the
+// cube. The next solver_solve asks for a solve of the new state.
+void solver_cancel(Solver *solver) {
+	__atomic_add_fetch(&solver->generation, 1, __ATOMIC_ACQ_REL);
+	solver->awaiting = 0;
+	solver->accepting = 0;
+	if (!solver->workerRunning) {
+		clearQueue(&solver->plan.queue);
+		mc_drain(&solver->channel);
+	}
+}
+
+int solver_takePlanTime(Solver *solver, double *seconds) {
+	pthread_mutex_lock(&solver->workerLock);
+	int timed = solver->planTimed;
+	*seconds = solver->planSeconds;
+	solver->planTimed = 0;
+	pthread_mutex_unlock(&solver->workerLock);
+	return timed;
+}
 
-	if (queue.size == 0) {
+// Producer side: generate the steps for the next unsolved stage. A state
+// that failed to plan is not retried until the cube changes.
+void solver_plan(Solver *solver, Rubiks *rubiks) {
+	if (solver->plan.queue.size == 0) {
+		if (isFailedState(solver, rubiks)) {
+			return;
+		}
 		log_info("%s", "Queue empty, generating next steps");
 		rc_serializeState(rubiks);
-		for (int currentStep=0; currentStep<NUM_STEPS; currentStep++) {
-			if (!checkStep(rubiks, currentStep)) {
-				(*steps[currentStep].solveFunction)(rubiks);
-				break;
+		if (planStage(&solver->plan, rubiks) == PLAN_FAILED) {
+			solver->failedState = *rubiks;
+			solver->haveFailedState = 1;
+		}
+	}
+	publishSteps(solver);
+}
+
+// Returns the stage planned, PLAN_SOLVED or PLAN_FAILED, in which case
+// nothing is left queued
+static int planStage(SolverPlan *plan, Rubiks *rubiks) {
+	for (int currentStep=0; currentStep<NUM_STEPS; currentStep++) {
+		plan->statesChecked++;
+		if (!checkStep(rubiks, currentStep)) {
+			int queued = plan->queue.size;
+			plan->failed = 0;
+			trace_begin(steps[currentStep].name, "solver");
+			(*steps[currentStep].solveFunction)(plan, rubiks);
+			trace_end(steps[currentStep].name, "solver");
+			if (plan->failed) {
+				log_error("Unable to plan %s", steps[currentStep].name);
+				plan->queue.size = queued;
+				return PLAN_FAILED;
+			}
+			return currentStep;
+		}
+	}
+	return PLAN_SOLVED;
+}
+
+// Solve functions call this instead of exiting on a state they don't expect
+static void failPlan(SolverPlan *plan, const char *reason) {
+	log_error("Solver failed: %s", reason);
+	plan->failed = 1;
+}
+
+const char *solver_stageName(int stage) {
+	return steps[stage].name;
+}
+
+// Solve a copy of rubiks ahead of time, writing up to maxSteps moves, as
+// seen through the cube's frame, to solution and, if inProgress is not NULL,
+// the cube each move works on.
+// If stats is not NULL it is filled in for this solve.
+// Returns the number of moves, or -1 if the solve did not fit, stalled or
+// met a state the solver can't handle.
+int solver_computeSolution(Rubiks *rubiks, Step *solution, int *inProgress, int maxSteps, SolverStats *stats) {
+	return computeSolution(rubiks, solution, inProgress, maxSteps, stats, NULL, -1);
+}
+
+// Gives up, returning -1, once *generation moves past watch. The plan lives
+// on the stack, so solves on different threads share nothing.
+static int computeSolution(Rubiks *rubiks, Step *solution, int *inProgress, int maxSteps, SolverStats *stats,
+		const int *generation, int watch) {
+	Rubiks copy = *rubiks;
+	SolverPlan plan;
+	initPlan(&plan);
+	SolverStats local;
+	if (stats == NULL) {
+		stats = &local;
+	}
+	stats_clear(stats);
+	trace_begin("solver_computeSolution", "solver");
+	double solveStart = timer_now();
+
+	int count = 0;
+	// Same-face run being counted as one half turn, credited to the stage
+	// whose move began it, so runs crossing plans are counted once
+	int runFace = -1;
+	int runQuarters = 0;
+	int runStage = 0;
+	for (;;) {
+		if (generation != NULL && __atomic_load_n(generation, __ATOMIC_ACQUIRE) != watch) {
+			count = -1;
+			break;
+		}
+		long stageFirstCheck = plan.statesChecked;
+		double stageStart = timer_now();
+		int stage = planStage(&plan, &copy);
+		if (stage == PLAN_SOLVED) {
+			stats->solved = 1;
+			break;
+		}
+		if (stage == PLAN_FAILED || plan.queue.size == 0 || count + plan.queue.size > maxSteps) {
+			stats->failedStage = stage == PLAN_FAILED ? checkCurrentState(&copy) : stage;
+			count = -1;
+			break;
+		}
+		int first = count;
+		while (plan.queue.size > 0) {
+			Step step = dequeue(&plan.queue);
+			if (inProgress != NULL) {
+				inProgress[count] = copy.cubeInProgress;
+			}
+			rc_rotateFace(&copy, step.face, step.direction);
+			step.face = rc_frameFace(rubiks, step.face);
+			solution[count++] = step;
+			if (step.face != runFace) {
+				stats->stages[runStage].halfTurns += runFace >= 0 && (runQuarters % 4) != 0;
+				runFace = step.face;
+				runQuarters = 0;
+				runStage = stage;
 			}
+			runQuarters += step.direction;
+		}
+		SolverStageStats *stageStats = &stats->stages[stage];
+		stageStats->plans++;
+		stageStats->quarterTurns += count - first;
+		stageStats->statesChecked += plan.statesChecked - stageFirstCheck;
+		stageStats->seconds += timer_now() - stageStart;
+	}
+
+	stats->stages[runStage].halfTurns += runFace >= 0 && (runQuarters % 4) != 0;
+	if (count >= 0) {
+		stats->quarterTurns = count;
+		stats->halfTurns = stats_countHalfTurns(solution, count);
+	}
+	stats->statesChecked = plan.statesChecked;
+	stats->seconds = timer_now() - solveStart;
+	trace_end("solver_computeSolution", "solver");
+	freeQueue(&plan.queue);
+	return count;
+}
+
+// Consumer side: start playing back the next published step, if any
+int solver_playNext(Solver *solver, Rubiks *rubiks, FaceAnimation *animation, int animationsOn) {
+	if (rc_animationIsRotating(animation)) {
+		return 0;
+	}
+	Step step;
+	while (mc_pop(&solver->channel, &step)) {
+		if (step.face >= 0) {
+			if (solver->workerRunning && !solver->accepting) {
+				continue; // left over from a cancelled solve
+			}
+			log_info("Next step on queue: %c%s", faceData[step.face].name, (step.direction<0?"'":""));
+			// steps turn physical faces, which may be seen as others after a rotation
+			rc_beginAnimation(animation, rubiks, rc_frameFace(rubiks, step.face), step.direction, !animationsOn);
+			return 1;
+		}
+		if (step.direction != __atomic_load_n(&solver->generation, __ATOMIC_ACQUIRE)) {
+			continue;
+		}
+		if (step.face == MARK_BEGIN) {
+			solver->accepting = 1;
+		} else {
+			solver->accepting = 0;
+			solver->awaiting = 0;
+			if (step.face == MARK_FAILED) {
+				solver->failedState = *rubiks;
+				solver->haveFailedState = 1;
+			}
+		}
+	}
+	return 0;
+}
+
+static int isFailedState(Solver *solver, Rubiks *rubiks) {
+	return solver->haveFailedState
+		&& memcmp(rubiks->cubes, solver->failedState.cubes, sizeof(rubiks->cubes)) == 0;
+}
+
+static void requestSolve(Solver *solver, Rubiks *rubiks) {
+	pthread_mutex_lock(&solver->workerLock);
+	solver->requestState = *rubiks;
+	solver->requestGeneration = __atomic_add_fetch(&solver->generation, 1, __ATOMIC_ACQ_REL);
+	solver->requestPending = 1;
+	pthread_cond_signal(&solver->workerWake);
+	pthread_mutex_unlock(&solver->workerLock);
+	solver->awaiting = 1;
+	solver->accepting = 0;
+}
+
+static void *workerMain(void *arg) {
+	Solver *solver = arg;
+	trace_nameThread("solver");
+	pthread_mutex_lock(&solver->workerLock);
+	for (;;) {
+		while (!solver->workerStopping && !solver->requestPending) {
+			pthread_cond_wait(&solver->workerWake, &solver->workerLock);
+		}
+		if (solver->workerStopping) {
+			break;
 		}
+		Rubiks snapshot = solver->requestState;
+		int solving = solver->requestGeneration;
+		solver->requestPending = 0;
+		pthread_mutex_unlock(&solver->workerLock);
+		solveSnapshot(solver, &snapshot, solving);
+		pthread_mutex_lock(&solver->workerLock);
 	}
+	pthread_mutex_unlock(&solver->workerLock);
+	return NULL;
+}
 
-	if ((queue.size > 0 && !rc_isRotating())) {
-		Step step = dequeue(&queue);
-		log_info("Next step on queue: %c%s", faceData[step.face].name, (step.direction<0?"'":""));
-		rc_beginFaceRotation(rubiks, step.face, step.direction, !animationsOn);
+// Moves stream out as they are pushed, so playback starts before a long
+// solution is all in the channel
+static void solveSnapshot(Solver *solver, Rubiks *snapshot, int solving) {
+	Step *solution = solver->workerSolution;
+	SolverStats stats;
+	int count = computeSolution(snapshot, solution, NULL, WORKER_MAX_SOLUTION, &stats, &solver->generation, solving);
+	if (count < 0 && __atomic_load_n(&solver->generation, __ATOMIC_ACQUIRE) != solving) {
+		return;
+	}
+	pthread_mutex_lock(&solver->workerLock);
+	solver->planSeconds = stats.seconds;
+	solver->planTimed = 1;
+	pthread_mutex_unlock(&solver->workerLock);
+	Step begin = {MARK_BEGIN, solving};
+	if (!pushStep(solver, begin, solving)) {
+		return;
+	}
+	for (int i=0; i<count; i++) {
+		// back from the faces seen at solve time to physical faces
+		Step step = {snapshot->frame[solution[i].face], solution[i].direction};
+		if (!pushStep(solver, step, solving)) {
+			return;
+		}
+	}
+	Step end = {count < 0 ? MARK_FAILED : MARK_END, solving};
+	pushStep(solver, end, solving);
+}
+
+// Waits while the channel is full, unless the solve is cancelled
+static int pushStep(Solver *solver, Step step, int solving) {
+	struct timespec wait = {0, WORKER_FULL_SLEEP_NS};
+	while (!mc_push(&solver->channel, step)) {
+		if (__atomic_load_n(&solver->generation, __ATOMIC_ACQUIRE) != solving) {
+			return 0;
+		}
+		nanosleep(&wait, NULL);
+	}
+	return 1;
+}
+
+// Move planned steps into the channel, keeping any overflow queued
+static void publishSteps(Solver *solver) {
+	StepQueue *queue = &solver->plan.queue;
+	while (queue->size > 0) {
+		Step step = queue->items[queue->head];
+		if (!mc_push(&solver->channel, step)) {
+			break;
+		}
+		dequeue(queue);
 	}
 }
 
@@ -197,7 +570,7 @@ CubeSolutionState getNextUnsolved(Rubiks *rubiks, int stepCubes[], int size) {
 	return state;
 }
 
-CubeSolutionState getNextUnsolvedInFace(Rubiks *rubiks, int stepCubes[], int size, int face) {
+CubeSolutionState getNextUnsolvedInFace(SolverPlan *plan, Rubiks *rubiks, int stepCubes[], int size, int face) {
 
 	int correctPos, correctRot;
 	int stepCubeIndex = 0;
@@ -211,7 +584,7 @@ CubeSolutionState getNextUnsolvedInFace(Rubiks *rubiks, int stepCubes[], int siz
 		correctRot = cube_checkRotation(cube);
 		if (!(correctPos && correctRot)) {
 			log_info("Cube %i is unsolved.", id);
-			EdgePieceFaces faces = getEdgePieceFaces(cube);
+			EdgePieceFaces faces = getEdgePieceFaces(plan, cube);
 			if (faces.secondary == face) {
 				found = 1;
 				break;
@@ -234,7 +607,7 @@ CubeSolutionState getNextUnsolvedInFace(Rubiks *rubiks, int stepCubes[], int siz
 	return state;
 }
 
-int getFaceForCube(Cube *cube, int excludeList[], int excludeListLen) {
+int getFaceForCube(SolverPlan *plan, Cube *cube, int excludeList[], int excludeListLen) {
 	int currentFace = -1;
 	for (int faceNum=0; faceNum<NUM_FACES; faceNum++) {
 		if (indexOf(excludeList, excludeListLen, faceNum) >=0) {
@@ -246,21 +619,22 @@ int getFaceForCube(Cube *cube, int excludeList[], int excludeListLen) {
 		}
 	}
 	if (currentFace == -1) {
-		log_fatal("Did not find side face for cube: %i", cube->id);
-		exit(1);
+		log_error("Did not find side face for cube: %i", cube->id);
+		failPlan(plan, "cube outside every face");
+		currentFace = 0; // any valid face, the plan is thrown away
 	}
 	return currentFace;
 }
 
-EdgePieceFaces getEdgePieceFaces(Cube *cube) {
+EdgePieceFaces getEdgePieceFaces(SolverPlan *plan, Cube *cube) {
 	// Get two faces that an edge piece resides in
 	// left face should be the leftmost face, or the only side face when other is UP/DOWN
 
 	int excludes[] = {UP_FACE, DOWN_FACE};
-	int primary = getFaceForCube(cube, excludes, 2);
+	int primary = getFaceForCube(plan, cube, excludes, 2);
 
 	excludes[0] = primary;
-	int secondary = getFaceForCube(cube, excludes, 1);
+	int secondary = getFaceForCube(plan, cube, excludes, 1);
 
 	EdgePieceFaces r = {primary, secondary};
 
@@ -272,16 +646,16 @@ EdgePieceFaces getEdgePieceFaces(Cube *cube) {
 	return r;
 }
 
-CornerPieceFaces getCornerPieceFaces(Cube *cube) {
+CornerPieceFaces getCornerPieceFaces(SolverPlan *plan, Cube *cube) {
 	int excludes[] = {UP_FACE, DOWN_FACE, -1};
-	int primary = getFaceForCube(cube, excludes, 2);
+	int primary = getFaceForCube(plan, cube, excludes, 2);
 
 	excludes[2] = primary;
-	int secondary = getFaceForCube(cube, excludes, 3);
+	int secondary = getFaceForCube(plan, cube, excludes, 3);
 
 	excludes[0] = primary;
 	excludes[1] = secondary;
-	int horizontal = getFaceForCube(cube, excludes, 2);
+	int horizontal = getFaceForCube(plan, cube, excludes, 2);
 
 	CornerPieceFaces r = {primary, secondary, horizontal};
 	// sort left to right
@@ -293,90 +667,90 @@ CornerPieceFaces getCornerPieceFaces(Cube *cube) {
 }
 
 int whiteCrossFaces[4] = {BACK_FACE, LEFT_FACE, RIGHT_FACE, FRONT_FACE};
-void solveWhiteCross(Rubiks *rubiks) {
+void solveWhiteCross(SolverPlan *plan, Rubiks *rubiks) {
 	log_info("%s", "Inside solveWhiteCross()");
 
 	CubeSolutionState state = getNextUnsolved(rubiks, whiteCrossCubeIds, 4);
 
-	EdgePieceFaces faces = getEdgePieceFaces(state.cube);
+	EdgePieceFaces faces = getEdgePieceFaces(plan, state.cube);
 	int targetFace = whiteCrossFaces[state.stepCubeIndex];
 
 	if (state.correctPos && !state.correctRot) {
 		log_info("Cube %i is in correct position, but incorrect rotation", state.cube->id);
-		enqueueStep(faces.primary, CLOCKWISE);
-		enqueueStep(faceData[faces.primary].neighbors[RIGHT], COUNTERCLOCKWISE);
-		enqueueStep(DOWN_FACE, COUNTERCLOCKWISE);
-		enqueueStep(faceData[faces.primary].neighbors[RIGHT], CLOCKWISE);
+		enqueueStep(plan, faces.primary, CLOCKWISE);
+		enqueueStep(plan, faceData[faces.primary].neighbors[RIGHT], COUNTERCLOCKWISE);
+		enqueueStep(plan, DOWN_FACE, COUNTERCLOCKWISE);
+		enqueueStep(plan, faceData[faces.primary].neighbors[RIGHT], CLOCKWISE);
 		// Rotation of side face to top position handled by "in correct face" case
 	} else if (rc_checkCubeInFace(state.cube, targetFace)) {
 		log_info("Cube %i is in correct face, but not correct position", state.cube->id);
 		// TODO rework getEdgePieces so this isn't necessary
 		// if primary face is the face we want, rotate away from secondary face
 		int startFace = (faces.primary == targetFace) ? faces.secondary : faces.primary;
-		rotateFaceToTarget(targetFace, startFace, UP_FACE);
+		rotateFaceToTarget(plan, targetFace, startFace, UP_FACE);
 	} else if (!state.correctPos) {
 		log_info("Cube %i is in incorrect position", state.cube->id);
-		rotateFaceToTarget(faces.primary, faces.secondary, DOWN_FACE);
-		rotateFaceToTarget(DOWN_FACE, faces.primary, targetFace);
-		rotateFaceToTarget(faces.primary, DOWN_FACE, faces.secondary);
+		rotateFaceToTarget(plan, faces.primary, faces.secondary, DOWN_FACE);
+		rotateFaceToTarget(plan, DOWN_FACE, faces.primary, targetFace);
+		rotateFaceToTarget(plan, faces.primary, DOWN_FACE, faces.secondary);
 		// Rotation to UP_FACE handled by (in correct face) case
 	}
 }
 
 // moves corner piece from DOWN->UP or UP->DOWN
-void repositionCornerPiece(int faceToRotate, int direction) {
-	enqueueStep(faceToRotate, direction);
-	enqueueStep(DOWN_FACE, direction);
-	enqueueStep(faceToRotate, -direction);
-	enqueueStep(DOWN_FACE, -direction);
+void repositionCornerPiece(SolverPlan *plan, int faceToRotate, int direction) {
+	enqueueStep(plan, faceToRotate, direction);
+	enqueueStep(plan, DOWN_FACE, direction);
+	enqueueStep(plan, faceToRotate, -direction);
+	enqueueStep(plan, DOWN_FACE, -direction);
 }
 
-void solveWhiteCorners(Rubiks *rubiks) {
+void solveWhiteCorners(SolverPlan *plan, Rubiks *rubiks) {
 	log_info("%s", "Inside solveWhiteCorners()");
 
 	CubeSolutionState state = getNextUnsolved(rubiks, whiteCornersCubeIds, 4);
-	CornerPieceFaces faces = getCornerPieceFaces(state.cube);
+	CornerPieceFaces faces = getCornerPieceFaces(plan, state.cube);
 
 	// TODO make these rotations smarter -- account for rotation
 	if (!state.correctPos && faces.horizontal == UP_FACE) {
-		repositionCornerPiece(faces.primary, CLOCKWISE);
+		repositionCornerPiece(plan, faces.primary, CLOCKWISE);
 	} else if (state.correctPos && !state.correctRot) {
-		repositionCornerPiece(faces.primary, CLOCKWISE);
+		repositionCornerPiece(plan, faces.primary, CLOCKWISE);
 	} else if (state.cube->position == state.cube->initialPosition + 18) {
-		repositionCornerPiece(faces.primary, CLOCKWISE);
+		repositionCornerPiece(plan, faces.primary, CLOCKWISE);
 	} else if (faces.horizontal == DOWN_FACE) {
 		// TODO determine shortest # rotations and direction
-		enqueueStep(DOWN_FACE, CLOCKWISE);
+		enqueueStep(plan, DOWN_FACE, CLOCKWISE);
 	}
 }
 
 typedef enum {DownToLeft, DownToRight, Middle, IncorrectSide, MLSolved, MLUnknown} MiddleLayerForm;
-void middleLayerRotationSequence(MiddleLayerForm form, int face1, int face2) {
+void middleLayerRotationSequence(SolverPlan *plan, MiddleLayerForm form, int face1, int face2) {
 	if (form == MLSolved) {
-		log_error("%s", "Attempting to solve already solved step!");
-		exit(1);
+		failPlan(plan, "attempting to solve already solved step");
+		return;
 	}
 	int direction = form ? COUNTERCLOCKWISE : CLOCKWISE;
-	enqueueStep(DOWN_FACE, direction);
-	enqueueStep(face2, direction);
-	enqueueStep(DOWN_FACE, -direction);
-	enqueueStep(face2, -direction);
-	enqueueStep(DOWN_FACE, -direction);
-	enqueueStep(face1, -direction);
-	enqueueStep(DOWN_FACE, direction);
-	enqueueStep(face1, direction);
+	enqueueStep(plan, DOWN_FACE, direction);
+	enqueueStep(plan, face2, direction);
+	enqueueStep(plan, DOWN_FACE, -direction);
+	enqueueStep(plan, face2, -direction);
+	enqueueStep(plan, DOWN_FACE, -direction);
+	enqueueStep(plan, face1, -direction);
+	enqueueStep(plan, DOWN_FACE, direction);
+	enqueueStep(plan, face1, direction);
 }
 
-void solveMiddleLayer(Rubiks *rubiks) {
+void solveMiddleLayer(SolverPlan *plan, Rubiks *rubiks) {
 	log_info("%s", "Inside solveMiddleLayer()");
 
-	CubeSolutionState state = getNextUnsolvedInFace(rubiks, middleLayerCubeIds, 4, DOWN_FACE);
+	CubeSolutionState state = getNextUnsolvedInFace(plan, rubiks, middleLayerCubeIds, 4, DOWN_FACE);
 	if (state.cube == NULL) {
 		state = getNextUnsolved(rubiks, middleLayerCubeIds, 4);
 	}
 	log_info("Attempting to solve edge piece %i for middle layer", state.cube->id);
 
-	EdgePieceFaces faces = getEdgePieceFaces(state.cube);
+	EdgePieceFaces faces = getEdgePieceFaces(plan, state.cube);
 	EdgePieceFaces target = middleLayerFaces[state.stepCubeIndex];
 
 	MiddleLayerForm form = MLUnknown;
@@ -407,36 +781,35 @@ void solveMiddleLayer(Rubiks *rubiks) {
 	}
 
 	if (form == MLUnknown) {
-		log_fatal("%s", "UNEXPECTED STATE");
-		exit(1);
+		failPlan(plan, "unexpected middle layer state");
 	} else if (form == IncorrectSide) {
-		rotateFaceToTarget(DOWN_FACE, faces.primary, faceToRotate);
+		rotateFaceToTarget(plan, DOWN_FACE, faces.primary, faceToRotate);
 	} else {
-		middleLayerRotationSequence(form, faces.primary, faceToRotate);
+		middleLayerRotationSequence(plan, form, faces.primary, faceToRotate);
 	}
 }
 
 typedef enum {Line, Center, LShape, YCrSolved, Unknown} YCrossForm;
-void yellowCrossRotationSequence(YCrossForm form) {
+void yellowCrossRotationSequence(SolverPlan *plan, YCrossForm form) {
 	if (form == YCrSolved) {
 		log_error("%s", "Attempting to solve already solved step!");
 	}
-	enqueueStep(BACK_FACE, CLOCKWISE);
-	enqueueStep(form ? DOWN_FACE : RIGHT_FACE, CLOCKWISE);
-	enqueueStep(form ? RIGHT_FACE : DOWN_FACE, CLOCKWISE);
-	enqueueStep(form ? DOWN_FACE : RIGHT_FACE, COUNTERCLOCKWISE);
-	enqueueStep(form ? RIGHT_FACE : DOWN_FACE, COUNTERCLOCKWISE);
-	enqueueStep(BACK_FACE, COUNTERCLOCKWISE);
+	enqueueStep(plan, BACK_FACE, CLOCKWISE);
+	enqueueStep(plan, form ? DOWN_FACE : RIGHT_FACE, CLOCKWISE);
+	enqueueStep(plan, form ? RIGHT_FACE : DOWN_FACE, CLOCKWISE);
+	enqueueStep(plan, form ? DOWN_FACE : RIGHT_FACE, COUNTERCLOCKWISE);
+	enqueueStep(plan, form ? RIGHT_FACE : DOWN_FACE, COUNTERCLOCKWISE);
+	enqueueStep(plan, BACK_FACE, COUNTERCLOCKWISE);
 }
 
-void yellowCornersRotationSequence() {
-	enqueueStep(RIGHT_FACE, CLOCKWISE);
-	enqueueStep(DOWN_FACE, CLOCKWISE);
-	enqueueStep(RIGHT_FACE, COUNTERCLOCKWISE);
-	enqueueStep(DOWN_FACE, CLOCKWISE);
-	enqueueStep(RIGHT_FACE, CLOCKWISE);
-	enqueueMultipleStep(DOWN_FACE, CLOCKWISE, 2);
-	enqueueStep(RIGHT_FACE, COUNTERCLOCKWISE);
+void yellowCornersRotationSequence(SolverPlan *plan) {
+	enqueueStep(plan, RIGHT_FACE, CLOCKWISE);
+	enqueueStep(plan, DOWN_FACE, CLOCKWISE);
+	enqueueStep(plan, RIGHT_FACE, COUNTERCLOCKWISE);
+	enqueueStep(plan, DOWN_FACE, CLOCKWISE);
+	enqueueStep(plan, RIGHT_FACE, CLOCKWISE);
+	enqueueMultipleStep(plan, DOWN_FACE, CLOCKWISE, 2);
+	enqueueStep(plan, RIGHT_FACE, COUNTERCLOCKWISE);
 }
 
 typedef enum {OneCorner, TwoCorners, NoCornersLeftCube, NoCornersRightCube} YCornersForm;
@@ -463,7 +836,7 @@ int getSolvedForFinalLayer(Rubiks *rubiks, int *positions, int *solvedList) {
 
 static int yeCubePositions[4] = {19, 23, 25, 21}; // in clockwise order
 static int ycnCubePositions[4] = {18, 20, 24, 26};
-void solveDownFace(Rubiks *rubiks) {
+void solveDownFace(SolverPlan *plan, Rubiks *rubiks) {
 	// TWO STEPS:
 	// 1) Solve yellow cross
 	// 2) Solve yellow corners
@@ -485,7 +858,7 @@ void solveDownFace(Rubiks *rubiks) {
 		form = Center;
 	} else if (cubesSolved[0] && cubesSolved[2]) {
 		log_info("Straight line of cross cubes is solved: %i, %i", yeCubePositions[0], yeCubePositions[2]);
-		enqueueStep(DOWN_FACE, CLOCKWISE); // rotate to match pattern
+		enqueueStep(plan, DOWN_FACE, CLOCKWISE); // rotate to match pattern
 		form = Line;
 	} else if (cubesSolved[1] && cubesSolved[3]) {
 		log_info("Straight line of cross cubes is solved: %i, %i", yeCubePositions[1], yeCubePositions[3]);
@@ -504,19 +877,19 @@ void solveDownFace(Rubiks *rubiks) {
 				yeCubePositions[firstCube], yeCubePositions[secondCube]
 			);
 			Cube *cube = rc_getCubeAtPos(rubiks, yeCubePositions[secondCube]);
-			EdgePieceFaces faces = getEdgePieceFaces(cube);
-			rotateFaceToTarget(DOWN_FACE, faces.primary, LEFT_FACE); // rotate to match pattern
+			EdgePieceFaces faces = getEdgePieceFaces(plan, cube);
+			rotateFaceToTarget(plan, DOWN_FACE, faces.primary, LEFT_FACE); // rotate to match pattern
 			form = LShape;
 		}
 	}
 	if (form == Unknown) {
-		log_fatal("%s", "Unable to determine yellow cross form!");
-		exit(1);
+		failPlan(plan, "unable to determine yellow cross form");
+		return;
 	} else if (form != YCrSolved) {
 		int unsolvedIndex = indexOf(cubesSolved, 4, 0);
 		Cube *unsolvedCube = rc_getCubeAtPos(rubiks, yeCubePositions[unsolvedIndex]);
 		rubiks->cubeInProgress = unsolvedCube->id;
-		yellowCrossRotationSequence(form);
+		yellowCrossRotationSequence(plan, form);
 		return; // TODO refactor cross & corners
 	}
 
@@ -527,69 +900,69 @@ void solveDownFace(Rubiks *rubiks) {
 		// TODO refactor this and >=2 case to use same lookup -- difference is faces.secondary/primary
 		for (int i=0; i<4; i++) {
 			Cube *cube = rc_getCubeAtPos(rubiks, ycnCubePositions[i]);
-			CornerPieceFaces faces = getCornerPieceFaces(cube);
+			CornerPieceFaces faces = getCornerPieceFaces(plan, cube);
 			if (cube_getShownFace(cube, faces.secondary) == DOWN_FACE) {
 				rubiks->cubeInProgress = cube->id;
-				rotateFaceToTarget(DOWN_FACE, faces.primary, BACK_FACE);
+				rotateFaceToTarget(plan, DOWN_FACE, faces.primary, BACK_FACE);
 				break;
 			}
 		}
-		yellowCornersRotationSequence();
+		yellowCornersRotationSequence(plan);
 	} else if (numSolved == 1) {
 		int solvedIndex = indexOf(cubesSolved, 4, 1);
 		Cube *solvedCube = rc_getCubeAtPos(rubiks, ycnCubePositions[solvedIndex]);
 		rubiks->cubeInProgress = solvedCube->id;
-		CornerPieceFaces faces = getCornerPieceFaces(solvedCube);
-		rotateFaceToTarget(DOWN_FACE, faces.primary, BACK_FACE); // rotate to match pattern
-		yellowCornersRotationSequence();
+		CornerPieceFaces faces = getCornerPieceFaces(plan, solvedCube);
+		rotateFaceToTarget(plan, DOWN_FACE, faces.primary, BACK_FACE); // rotate to match pattern
+		yellowCornersRotationSequence(plan);
 	} else if (numSolved >= 2) {
 		for (int i=0; i<4; i++) {
 			if (cubesSolved[i]) {
 				continue;
 			}
 			Cube *cube = rc_getCubeAtPos(rubiks, ycnCubePositions[i]);
-			CornerPieceFaces faces = getCornerPieceFaces(cube);
+			CornerPieceFaces faces = getCornerPieceFaces(plan, cube);
 			if (cube_getShownFace(cube, faces.primary) == DOWN_FACE) {
 				rubiks->cubeInProgress = cube->id;
-				rotateFaceToTarget(DOWN_FACE, faces.primary, BACK_FACE);
+				rotateFaceToTarget(plan, DOWN_FACE, faces.primary, BACK_FACE);
 				break;
 			}
 		}
-		yellowCornersRotationSequence();
+		yellowCornersRotationSequence(plan);
 	}
 }
 
-void finalLayerCornerRotationSequence(int solvedFace) {
+void finalLayerCornerRotationSequence(SolverPlan *plan, int solvedFace) {
 	int right = faceData[solvedFace].neighbors[RIGHT];
 	int front = faceData[right].neighbors[RIGHT];
-	enqueueStep(right, COUNTERCLOCKWISE);
-	enqueueStep(front, CLOCKWISE);
-	enqueueStep(right, COUNTERCLOCKWISE);
-	enqueueMultipleStep(solvedFace, CLOCKWISE, 2);
-	enqueueStep(right, CLOCKWISE);
-	enqueueStep(front, COUNTERCLOCKWISE);
-	enqueueStep(right, COUNTERCLOCKWISE);
-	enqueueMultipleStep(solvedFace, CLOCKWISE, 2);
-	enqueueMultipleStep(right, CLOCKWISE, 2);
-	enqueueStep(DOWN_FACE, COUNTERCLOCKWISE);
-}
-
-void finalLayerEdgeRotationSequence(int direction, int solvedFace) {
+	enqueueStep(plan, right, COUNTERCLOCKWISE);
+	enqueueStep(plan, front, CLOCKWISE);
+	enqueueStep(plan, right, COUNTERCLOCKWISE);
+	enqueueMultipleStep(plan, solvedFace, CLOCKWISE, 2);
+	enqueueStep(plan, right, CLOCKWISE);
+	enqueueStep(plan, front, COUNTERCLOCKWISE);
+	enqueueStep(plan, right, COUNTERCLOCKWISE);
+	enqueueMultipleStep(plan, solvedFace, CLOCKWISE, 2);
+	enqueueMultipleStep(plan, right, CLOCKWISE, 2);
+	enqueueStep(plan, DOWN_FACE, COUNTERCLOCKWISE);
+}
+
+void finalLayerEdgeRotationSequence(SolverPlan *plan, int direction, int solvedFace) {
 	int left = faceData[solvedFace].neighbors[LEFT];
 	int right = faceData[solvedFace].neighbors[RIGHT];
 	int front = faceData[right].neighbors[RIGHT];
-	enqueueMultipleStep(front, CLOCKWISE, 2);
-	enqueueStep(DOWN_FACE, direction);
-	enqueueStep(left, CLOCKWISE);
-	enqueueStep(right, COUNTERCLOCKWISE);
-	enqueueMultipleStep(front, CLOCKWISE, 2);
-	enqueueStep(left, COUNTERCLOCKWISE);
-	enqueueStep(right, CLOCKWISE);
-	enqueueStep(DOWN_FACE, direction);
-	enqueueMultipleStep(front, CLOCKWISE, 2);
-}
-
-void solveFinalLayer(Rubiks *rubiks) {
+	enqueueMultipleStep(plan, front, CLOCKWISE, 2);
+	enqueueStep(plan, DOWN_FACE, direction);
+	enqueueStep(plan, left, CLOCKWISE);
+	enqueueStep(plan, right, COUNTERCLOCKWISE);
+	enqueueMultipleStep(plan, front, CLOCKWISE, 2);
+	enqueueStep(plan, left, COUNTERCLOCKWISE);
+	enqueueStep(plan, right, CLOCKWISE);
+	enqueueStep(plan, DOWN_FACE, direction);
+	enqueueMultipleStep(plan, front, CLOCKWISE, 2);
+}
+
+void solveFinalLayer(SolverPlan *plan, Rubiks *rubiks) {
 	log_info("%s", "Inside solveFinalLayer()");
 	int solvedList[4] = { 0, 0, 0, 0 };
 	int numSolved = getSolvedForFinalLayer(rubiks, ycnCubePositions, solvedList);
@@ -598,7 +971,7 @@ void solveFinalLayer(Rubiks *rubiks) {
 	if (numSolved == 4) {
 		log_info("%s", "All 4 corners solved! Progress to next step.");
 	} else if (numSolved < 2) {
-		enqueueStep(DOWN_FACE, CLOCKWISE);
+		enqueueStep(plan, DOWN_FACE, CLOCKWISE);
 		return;
 	} else if (solvedList[0] && solvedList[1]) {
 		sequenceFace = FRONT_FACE;
@@ -613,11 +986,11 @@ void solveFinalLayer(Rubiks *rubiks) {
 	} else if (solvedList[0] && solvedList[2]) {
 		sequenceFace = LEFT_FACE;
 	} else {
-		log_fatal("%s", "Unexpected state!");
-		exit(1);
+		failPlan(plan, "unexpected final layer state");
+		return;
 	}
 	if (numSolved < 4 && sequenceFace >= 0) {
-		finalLayerCornerRotationSequence(sequenceFace);
+		finalLayerCornerRotationSequence(plan, sequenceFace);
 		return;
 	}
 
@@ -627,24 +1000,24 @@ void solveFinalLayer(Rubiks *rubiks) {
 	if (numSolved == 4) {
 		log_error("%s", "Nothing to do!");
 	} else if (!numSolved) {
-		finalLayerEdgeRotationSequence(CLOCKWISE, BACK_FACE);
+		finalLayerEdgeRotationSequence(plan, CLOCKWISE, BACK_FACE);
 	} else if (numSolved == 1) {
 		int solvedIndex = indexOf(solvedList, 4, 1);
 		int cubePos = yeCubePositions[solvedIndex];
 		Cube *cube = rc_getCubeAtPos(rubiks, cubePos);
 		log_debug("One edge piece solved: %i at pos %i", cube->id, cube->position);
-		EdgePieceFaces faces = getEdgePieceFaces(cube);
+		EdgePieceFaces faces = getEdgePieceFaces(plan, cube);
 		log_debug("Resides in faces: %c and %c", faceData[faces.primary].name, faceData[faces.secondary].name);
 
 		int oppositeCubePos = yeCubePositions[(solvedIndex+2)%4];
 		Cube *oppositeCube = rc_getCubeAtPos(rubiks, oppositeCubePos);
-		EdgePieceFaces oppositeFaces = getEdgePieceFaces(oppositeCube);
+		EdgePieceFaces oppositeFaces = getEdgePieceFaces(plan, oppositeCube);
 		int oppositeCubeFace = cube_getShownFace(oppositeCube, oppositeFaces.primary);
 		int direction = CLOCKWISE;
 		if (oppositeCubeFace == faceData[faces.primary].neighbors[RIGHT]) {
 			direction = COUNTERCLOCKWISE;
 		}
-		finalLayerEdgeRotationSequence(direction, faces.primary);
+		finalLayerEdgeRotationSequence(plan, direction, faces.primary);
 	}
 }
 
@@ -665,23 +1038,22 @@ RotAndDir shortestDistanceToFace(int faceToRotate, int startSideFace, int destin
 	return ret;
 }
 
-RotAndDir rotateFaceToTarget(int faceToRotate, int fromFace, int toFace) {
+RotAndDir rotateFaceToTarget(SolverPlan *plan, int faceToRotate, int fromFace, int toFace) {
 	RotAndDir rotdir = shortestDistanceToFace(faceToRotate, fromFace, toFace);
 	log_info("Rotating %i%c%s to get from %c to %c",
 		rotdir.num, faceData[faceToRotate].name, rotdir.direction<0?"'":"",
 		faceData[fromFace].name, faceData[toFace].name
 	);
-	enqueueMultipleStep(faceToRotate, rotdir.direction, rotdir.num);
+	enqueueMultipleStep(plan, faceToRotate, rotdir.direction, rotdir.num);
 	return rotdir;
 }
 
-void enqueueStep(int faceToRotate, int direction) {
+void enqueueStep(SolverPlan *plan, int faceToRotate, int direction) {
 	Step s = {faceToRotate, direction};
-	enqueue(&queue, s);
+	enqueue(&plan->queue, s);
 }
 
-void enqueueMultipleStep(int faceToRotate, int direction, int num) {
-	for (int i=0; i<num; i++) {
-		enqueueStep(faceToRotate, direction);
-	}
+void enqueueMultipleStep(SolverPlan *plan, int faceToRotate, int direction, int num) {
+	Step s = {faceToRotate, direction};
+	enqueueMultiple(&plan->queue, s, num);
 }
@@ -0,0 +1,160 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "controller/solverstats.h"
+#include "controller/solvercontroller.h"
+#include "logger.h"
+#include "utils.h"
+
+#define INITIAL_CAPACITY 64
+
+// Ways to pull one number out of a solve for the aggregate
+#define FIELD_QUARTER_TURNS 0
+#define FIELD_HALF_TURNS 1
+#define FIELD_PLANS 2
+#define FIELD_STATES_CHECKED 3
+#define FIELD_MS 4
+
+static double fieldValue(const SolverStats *stats, int stage, int field);
+static void writeDistribution(FILE *fp, const char *name, SolverStatsAggregate *aggregate, int stage, int field, double *values);
+
+void stats_clear(SolverStats *stats) {
+	memset(stats, 0, sizeof(SolverStats));
+	stats->failedStage = -1;
+}
+
+int stats_countHalfTurns(const Step *steps, int count) {
+	int moves = 0;
+	int i = 0;
+	while (i < count) {
+		int face = steps[i].face;
+		int quarters = 0;
+		for ( ; i<count && steps[i].face == face; i++) {
+			quarters += steps[i].direction;
+		}
+		moves += (quarters % 4) != 0;
+	}
+	return moves;
+}
+
+// One JSON object on one line
+void stats_writeJSON(const SolverStats *stats, FILE *fp) {
+	fprintf(fp, "{\"solved\":%s,", stats->solved ? "true" : "false");
+	if (stats->failedStage >= 0) {
+		fprintf(fp, "\"failed_stage\":\"%s\",", solver_stageName(stats->failedStage));
+	}
+	fprintf(fp, "\"quarter_turns\":%i,\"half_turns\":%i,\"states_checked\":%li,\"ms\":%.3f,\"stages\":[",
+		stats->quarterTurns, stats->halfTurns, stats->statesChecked,
+		stats->seconds * 1000);
+	for (int stage=0; stage<SOLVER_NUM_STAGES; stage++) {
+		const SolverStageStats *s = &stats->stages[stage];
+		fprintf(fp, "%s{\"stage\":\"%s\",\"quarter_turns\":%i,\"half_turns\":%i,\"plans\":%i,\"replans\":%i,"
+			"\"states_checked\":%li,\"ms\":%.3f}", stage > 0 ? "," : "", solver_stageName(stage),
+			s->quarterTurns, s->halfTurns, s->plans, s->plans > 1 ? s->plans - 1 : 0, s->statesChecked,
+			s->seconds * 1000);
+	}
+	fprintf(fp, "]}\n");
+}
+
+void stats_initAggregate(SolverStatsAggregate *aggregate) {
+	aggregate->solves = NULL;
+	aggregate->count = 0;
+	aggregate->capacity = 0;
+}
+
+int stats_addSolve(SolverStatsAggregate *aggregate, const SolverStats *stats) {
+	if (aggregate->count == aggregate->capacity) {
+		int capacity = aggregate->capacity > 0 ? aggregate->capacity * 2 : INITIAL_CAPACITY;
+		SolverStats *solves = realloc(aggregate->solves, capacity * sizeof(SolverStats));
+		if (solves == NULL) {
+			log_error("Unable to keep stats for %i solves", capacity);
+			return 0;
+		}
+		aggregate->solves = solves;
+		aggregate->capacity = capacity;
+	}
+	aggregate->solves[aggregate->count++] = *stats;
+	return 1;
+}
+
+// Distributions cover the solves that finished; failures are only counted
+void stats_writeAggregateJSON(SolverStatsAggregate *aggregate, FILE *fp) {
+	int failed = 0;
+	for (int i=0; i<aggregate->count; i++) {
+		failed += !aggregate->solves[i].solved;
+	}
+	double *values = malloc((aggregate->count + 1) * sizeof(double));
+	if (values == NULL) {
+		log_error("%s", "Unable to allocate aggregate values");
+		return;
+	}
+
+	fprintf(fp, "{\"aggregate\":{\"solves\":%i,\"failed\":%i,", aggregate->count, failed);
+	writeDistribution(fp, "quarter_turns", aggregate, -1, FIELD_QUARTER_TURNS, values);
+	fprintf(fp, ",");
+	writeDistribution(fp, "half_turns", aggregate, -1, FIELD_HALF_TURNS, values);
+	fprintf(fp, ",");
+	writeDistribution(fp, "states_checked", aggregate, -1, FIELD_STATES_CHECKED, values);
+	fprintf(fp, ",");
+	writeDistribution(fp, "ms", aggregate, -1, FIELD_MS, values);
+	fprintf(fp, ",\"stages\":[");
+	for (int stage=0; stage<SOLVER_NUM_STAGES; stage++) {
+		fprintf(fp, "%s{\"stage\":\"%s\",", stage > 0 ? "," : "", solver_stageName(stage));
+		writeDistribution(fp, "quarter_turns", aggregate, stage, FIELD_QUARTER_TURNS, values);
+		fprintf(fp, ",");
+		writeDistribution(fp, "half_turns", aggregate, stage, FIELD_HALF_TURNS, values);
+		fprintf(fp, ",");
+		writeDistribution(fp, "plans", aggregate, stage, FIELD_PLANS, values);
+		fprintf(fp, ",");
+		writeDistribution(fp, "states_checked", aggregate, stage, FIELD_STATES_CHECKED, values);
+		fprintf(fp, ",");
+		writeDistribution(fp, "ms", aggregate, stage, FIELD_MS, values);
+		fprintf(fp, "}");
+	}
+	fprintf(fp, "]}}\n");
+	free(values);
+}
+
+void stats_freeAggregate(SolverStatsAggregate *aggregate) {
+	free(aggregate->solves);
+	stats_initAggregate(aggregate);
+}
+
+// A stage of -1 selects the whole solve
+static double fieldValue(const SolverStats *stats, int stage, int field) {
+	if (stage < 0) {
+		switch (field) {
+			case FIELD_QUARTER_TURNS: return stats->quarterTurns;
+			case FIELD_HALF_TURNS: return stats->halfTurns;
+			case FIELD_STATES_CHECKED: return stats->statesChecked;
+			default: return stats->seconds * 1000;
+		}
+	}
+	const SolverStageStats *s = &stats->stages[stage];
+	switch (field) {
+		case FIELD_QUARTER_TURNS: return s->quarterTurns;
+		case FIELD_HALF_TURNS: return s->halfTurns;
+		case FIELD_PLANS: return s->plans;
+		case FIELD_STATES_CHECKED: return s->statesChecked;
+		default: return s->seconds * 1000;
+	}
+}
+
+static void writeDistribution(FILE *fp, const char *name, SolverStatsAggregate *aggregate, int stage, int field, double *values) {
+	int count = 0;
+	double mean = 0;
+	for (int i=0; i<aggregate->count; i++) {
+		if (aggregate->solves[i].solved) {
+			values[count] = fieldValue(&aggregate->solves[i], stage, field);
+			mean += values[count++];
+		}
+	}
+	if (count == 0) {
+		fprintf(fp, "\"%s\":null", name);
+		return;
+	}
+	qsort(values, count, sizeof(double), compareDoubles);
+	fprintf(fp, "\"%s\":{\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}", name,
+		mean / count, percentile(values, count, 0.5), percentile(values, count, 0.9),
+		percentile(values, count, 0.99), values[count-1]);
+}
@@ -21,19 +21,6 @@ void cube_rotate(Cube *cube, const Vec3i degrees) {
 	log_trace("[CUBEID: %i] Cube quaternion after: %f, %f, %f, %f...", cube->id, cube->quat.x, cube->quat.y, cube->quat.z, cube->quat.w);
 }
 
-float* cube_getColorArray(const Cube cube) {
-	static float colors[72];
-
-	for (int i=0; i<NUM_FACES; i++) {
-		for (int v=0; v<4; v++) {
-			colors[i*12 + v*3] = cube.faces[i].color.red;
-			colors[i*12 + v*3 + 1] = cube.faces[i].color.green;
-			colors[i*12 + v*3 + 2] = cube.faces[i].color.blue;
-		}
-	}
-	return colors;
-}
-
 void cube_initialize(Cube *cube, int id, int position) {
 	cube->id = id;
 	cube->position = position;
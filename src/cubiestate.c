@@ -0,0 +1,428 @@
+#include <string.h>
+#include <math.h>
+
+#include "cubiestate.h"
+#include "logger.h"
+
+#define SQRT1_2 0.70710678118654752440f
+#define NUM_FIXED 7
+
+// Centers and core
+static const unsigned char fixedPositions[NUM_FIXED] = {4, 10, 12, 13, 14, 16, 22};
+
+const unsigned char cornerSlots[NUM_CORNERS] = {8, 6, 0, 2, 26, 24, 18, 20};
+const unsigned char edgeSlots[NUM_EDGES] = {5, 7, 3, 1, 23, 25, 21, 19, 17, 15, 9, 11};
+
+// Tables below are indexed by orientation. orientFaces[o][f] is the face
+// direction that the cube's home face f points to under rotation o, and
+// orientPositions[o][p] is where rotation o (about the core) moves position p.
+// Face turns compose with the existing orientation as turn * orientation.
+static const unsigned char orientFaces[NUM_ORIENTATIONS][NUM_FACES] = {
+	{0, 1, 2, 3, 4, 5},
+	{1, 0, 3, 2, 4, 5},
+	{1, 0, 2, 3, 5, 4},
+	{1, 0, 5, 4, 3, 2},
+	{1, 0, 4, 5, 2, 3},
+	{0, 1, 3, 2, 5, 4},
+	{0, 1, 5, 4, 2, 3},
+	{0, 1, 4, 5, 3, 2},
+	{3, 2, 1, 0, 5, 4},
+	{3, 2, 0, 1, 4, 5},
+	{3, 2, 5, 4, 0, 1},
+	{3, 2, 4, 5, 1, 0},
+	{2, 3, 1, 0, 4, 5},
+	{2, 3, 0, 1, 5, 4},
+	{2, 3, 5, 4, 1, 0},
+	{2, 3, 4, 5, 0, 1},
+	{5, 4, 1, 0, 2, 3},
+	{5, 4, 0, 1, 3, 2},
+	{5, 4, 3, 2, 1, 0},
+	{5, 4, 2, 3, 0, 1},
+	{4, 5, 1, 0, 3, 2},
+	{4, 5, 0, 1, 2, 3},
+	{4, 5, 3, 2, 0, 1},
+	{4, 5, 2, 3, 1, 0},
+};
+static const Quaternion orientQuats[NUM_ORIENTATIONS] = {
+	{0, 0, 0, 1},
+	{0, 0, 1, 0},
+	{0, 1, 0, 0},
+	{0, SQRT1_2, -SQRT1_2, 0},
+	{0, SQRT1_2, SQRT1_2, 0},
+	{1, 0, 0, 0},
+	{SQRT1_2, 0, 0, SQRT1_2},
+	{-SQRT1_2, 0, 0, SQRT1_2},
+	{SQRT1_2, -SQRT1_2, 0, 0},
+	{0, 0, SQRT1_2, SQRT1_2},
+	{0.5, -0.5, 0.5, 0.5},
+	{-0.5, 0.5, 0.5, 0.5},
+	{0, 0, -SQRT1_2, SQRT1_2},
+	{SQRT1_2, SQRT1_2, 0, 0},
+	{0.5, 0.5, -0.5, 0.5},
+	{-0.5, -0.5, -0.5, 0.5},
+	{0.5, -0.5, -0.5, 0.5},
+	{-0.5, -0.5, 0.5, 0.5},
+	{SQRT1_2, 0, -SQRT1_2, 0},
+	{0, -SQRT1_2, 0, SQRT1_2},
+	{-0.5, 0.5, -0.5, 0.5},
+	{0.5, 0.5, 0.5, 0.5},
+	{SQRT1_2, 0, SQRT1_2, 0},
+	{0, SQRT1_2, 0, SQRT1_2},
+};
+static const unsigned char orientCompose[NUM_ORIENTATIONS][NUM_ORIENTATIONS] = {
+	{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23},
+	{1, 0, 5, 6, 7, 2, 3, 4, 13, 12, 14, 15, 9, 8, 10, 11, 17, 16, 19, 18, 21, 20, 23, 22},
+	{2, 5, 0, 7, 6, 1, 4, 3, 9, 8, 11, 10, 13, 12, 15, 14, 21, 20, 22, 23, 17, 16, 18, 19},
+	{3, 7, 6, 0, 5, 4, 2, 1, 21, 20, 23, 22, 17, 16, 19, 18, 13, 12, 15, 14, 9, 8, 11, 10},
+	{4, 6, 7, 5, 0, 3, 1, 2, 17, 16, 18, 19, 21, 20, 22, 23, 9, 8, 10, 11, 13, 12, 14, 15},
+	{5, 2, 1, 4, 3, 0, 7, 6, 12, 13, 15, 14, 8, 9, 11, 10, 20, 21, 23, 22, 16, 17, 19, 18},
+	{6, 4, 3, 1, 2, 7, 5, 0, 20, 21, 22, 23, 16, 17, 18, 19, 8, 9, 11, 10, 12, 13, 15, 14},
+	{7, 3, 4, 2, 1, 6, 0, 5, 16, 17, 19, 18, 20, 21, 23, 22, 12, 13, 14, 15, 8, 9, 10, 11},
+	{8, 13, 12, 15, 14, 9, 11, 10, 0, 5, 7, 6, 2, 1, 4, 3, 23, 22, 21, 20, 19, 18, 17, 16},
+	{9, 12, 13, 14, 15, 8, 10, 11, 2, 1, 3, 4, 0, 5, 6, 7, 19, 18, 16, 17, 23, 22, 20, 21},
+	{10, 15, 14, 12, 13, 11, 8, 9, 23, 22, 20, 21, 19, 18, 16, 17, 2, 1, 4, 3, 0, 5, 7, 6},
+	{11, 14, 15, 13, 12, 10, 9, 8, 19, 18, 17, 16, 23, 22, 21, 20, 0, 5, 6, 7, 2, 1, 3, 4},
+	{12, 9, 8, 10, 11, 13, 14, 15, 5, 0, 6, 7, 1, 2, 3, 4, 18, 19, 17, 16, 22, 23, 21, 20},
+	{13, 8, 9, 11, 10, 12, 15, 14, 1, 2, 4, 3, 5, 0, 7, 6, 22, 23, 20, 21, 18, 19, 16, 17},
+	{14, 11, 10, 9, 8, 15, 13, 12, 22, 23, 21, 20, 18, 19, 17, 16, 5, 0, 7, 6, 1, 2, 4, 3},
+	{15, 10, 11, 8, 9, 14, 12, 13, 18, 19, 16, 17, 22, 23, 20, 21, 1, 2, 3, 4, 5, 0, 6, 7},
+	{16, 21, 20, 22, 23, 17, 18, 19, 7, 6, 5, 0, 4, 3, 1, 2, 11, 10, 9, 8, 15, 14, 13, 12},
+	{17, 20, 21, 23, 22, 16, 19, 18, 4, 3, 2, 1, 7, 6, 0, 5, 15, 14, 12, 13, 11, 10, 8, 9},
+	{18, 23, 22, 21, 20, 19, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 0, 5, 4, 3, 2, 1},
+	{19, 22, 23, 20, 21, 18, 16, 17, 11, 10, 8, 9, 15, 14, 12, 13, 4, 3, 1, 2, 7, 6, 5, 0},
+	{20, 17, 16, 19, 18, 21, 23, 22, 6, 7, 0, 5, 3, 4, 2, 1, 14, 15, 13, 12, 10, 11, 9, 8},
+	{21, 16, 17, 18, 19, 20, 22, 23, 3, 4, 1, 2, 6, 7, 5, 0, 10, 11, 8, 9, 14, 15, 12, 13},
+	{22, 19, 18, 16, 17, 23, 20, 21, 14, 15, 12, 13, 10, 11, 8, 9, 3, 4, 2, 1, 6, 7, 0, 5},
+	{23, 18, 19, 17, 16, 22, 21, 20, 10, 11, 9, 8, 14, 15, 13, 12, 6, 7, 5, 0, 3, 4, 1, 2},
+};
+static const unsigned char orientInverse[NUM_ORIENTATIONS] = {
+	0, 1, 2, 3, 4, 5, 7, 6, 8, 12, 20, 16, 9, 13, 17, 21, 11, 14, 18, 23, 10, 15, 22, 19
+};
+// Indexed by the directions of the home right and up faces
+static const signed char orientFromAxes[NUM_FACES][NUM_FACES] = {
+	{-1, -1, 1, 2, 3, 4},
+	{-1, -1, 5, 0, 6, 7},
+	{8, 9, -1, -1, 10, 11},
+	{12, 13, -1, -1, 14, 15},
+	{16, 17, 18, 19, -1, -1},
+	{20, 21, 22, 23, -1, -1},
+};
+static const unsigned char orientPositions[NUM_ORIENTATIONS][NUM_CUBES] = {
+	{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26},
+	{20, 19, 18, 23, 22, 21, 26, 25, 24, 11, 10, 9, 14, 13, 12, 17, 16, 15, 2, 1, 0, 5, 4, 3, 8, 7, 6},
+	{8, 7, 6, 5, 4, 3, 2, 1, 0, 17, 16, 15, 14, 13, 12, 11, 10, 9, 26, 25, 24, 23, 22, 21, 20, 19, 18},
+	{26, 25, 24, 17, 16, 15, 8, 7, 6, 23, 22, 21, 14, 13, 12, 5, 4, 3, 20, 19, 18, 11, 10, 9, 2, 1, 0},
+	{2, 1, 0, 11, 10, 9, 20, 19, 18, 5, 4, 3, 14, 13, 12, 23, 22, 21, 8, 7, 6, 17, 16, 15, 26, 25, 24},
+	{24, 25, 26, 21, 22, 23, 18, 19, 20, 15, 16, 17, 12, 13, 14, 9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2},
+	{6, 7, 8, 15, 16, 17, 24, 25, 26, 3, 4, 5, 12, 13, 14, 21, 22, 23, 0, 1, 2, 9, 10, 11, 18, 19, 20},
+	{18, 19, 20, 9, 10, 11, 0, 1, 2, 21, 22, 23, 12, 13, 14, 3, 4, 5, 24, 25, 26, 15, 16, 17, 6, 7, 8},
+	{6, 15, 24, 3, 12, 21, 0, 9, 18, 7, 16, 25, 4, 13, 22, 1, 10, 19, 8, 17, 26, 5, 14, 23, 2, 11, 20},
+	{2, 11, 20, 5, 14, 23, 8, 17, 26, 1, 10, 19, 4, 13, 22, 7, 16, 25, 0, 9, 18, 3, 12, 21, 6, 15, 24},
+	{8, 17, 26, 7, 16, 25, 6, 15, 24, 5, 14, 23, 4, 13, 22, 3, 12, 21, 2, 11, 20, 1, 10, 19, 0, 9, 18},
+	{0, 9, 18, 1, 10, 19, 2, 11, 20, 3, 12, 21, 4, 13, 22, 5, 14, 23, 6, 15, 24, 7, 16, 25, 8, 17, 26},
+	{18, 9, 0, 21, 12, 3, 24, 15, 6, 19, 10, 1, 22, 13, 4, 25, 16, 7, 20, 11, 2, 23, 14, 5, 26, 17, 8},
+	{26, 17, 8, 23, 14, 5, 20, 11, 2, 25, 16, 7, 22, 13, 4, 19, 10, 1, 24, 15, 6, 21, 12, 3, 18, 9, 0},
+	{24, 15, 6, 25, 16, 7, 26, 17, 8, 21, 12, 3, 22, 13, 4, 23, 14, 5, 18, 9, 0, 19, 10, 1, 20, 11, 2},
+	{20, 11, 2, 19, 10, 1, 18, 9, 0, 23, 14, 5, 22, 13, 4, 21, 12, 3, 26, 17, 8, 25, 16, 7, 24, 15, 6},
+	{0, 3, 6, 9, 12, 15, 18, 21, 24, 1, 4, 7, 10, 13, 16, 19, 22, 25, 2, 5, 8, 11, 14, 17, 20, 23, 26},
+	{20, 23, 26, 11, 14, 17, 2, 5, 8, 19, 22, 25, 10, 13, 16, 1, 4, 7, 18, 21, 24, 9, 12, 15, 0, 3, 6},
+	{18, 21, 24, 19, 22, 25, 20, 23, 26, 9, 12, 15, 10, 13, 16, 11, 14, 17, 0, 3, 6, 1, 4, 7, 2, 5, 8},
+	{2, 5, 8, 1, 4, 7, 0, 3, 6, 11, 14, 17, 10, 13, 16, 9, 12, 15, 20, 23, 26, 19, 22, 25, 18, 21, 24},
+	{24, 21, 18, 15, 12, 9, 6, 3, 0, 25, 22, 19, 16, 13, 10, 7, 4, 1, 26, 23, 20, 17, 14, 11, 8, 5, 2},
+	{8, 5, 2, 17, 14, 11, 26, 23, 20, 7, 4, 1, 16, 13, 10, 25, 22, 19, 6, 3, 0, 15, 12, 9, 24, 21, 18},
+	{26, 23, 20, 25, 22, 19, 24, 21, 18, 17, 14, 11, 16, 13, 10, 15, 12, 9, 8, 5, 2, 7, 4, 1, 6, 3, 0},
+	{6, 3, 0, 7, 4, 1, 8, 5, 2, 15, 12, 9, 16, 13, 10, 17, 14, 11, 24, 21, 18, 25, 22, 19, 26, 23, 20},
+};
+// Positions in each face, same layout as the faces table in rubiks.c
+static const unsigned char facePositions[NUM_FACES][FACE_SIZE] = {
+	{0, 3, 6, 9, 12, 15, 18, 21, 24},
+	{8, 5, 2, 17, 14, 11, 26, 23, 20},
+	{24, 25, 26, 21, 22, 23, 18, 19, 20},
+	{0, 1, 2, 3, 4, 5, 6, 7, 8},
+	{6, 7, 8, 15, 16, 17, 24, 25, 26},
+	{2, 1, 0, 11, 10, 9, 20, 19, 18}
+};
+// Clockwise and counterclockwise quarter turn of each face
+static const unsigned char faceTurns[NUM_FACES][2] = {
+	{6, 7},
+	{7, 6},
+	{23, 19},
+	{19, 23},
+	{9, 12},
+	{12, 9},
+};
+// Corner or edge index (in slot order) of the piece whose home is each position
+static const unsigned char pieceIndex[NUM_CUBES] = {2, 3, 3, 2, 255, 0, 1, 1, 0, 10, 255, 11, 255, 255, 255, 9, 255, 8, 6, 7, 7, 6, 255, 4, 5, 5, 4};
+// Twist of a corner in each slot for each orientation, counted clockwise
+// from the slot's U/D facelet to the facelet showing the piece's U/D color
+static const unsigned char cornerTwists[NUM_CORNERS][NUM_ORIENTATIONS] = {
+	{0, 0, 0, 2, 2, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 0, 1, 1, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 0, 0},
+	{0, 0, 0, 2, 2, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 0, 1, 1, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 0, 0},
+	{0, 0, 0, 1, 1, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 0, 0},
+	{0, 0, 0, 2, 2, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 0, 1, 1, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 0, 0},
+	{0, 0, 0, 2, 2, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 0, 0, 1, 1, 0, 0},
+};
+// Flip of an edge in each slot for each orientation
+static const unsigned char edgeFlips[NUM_EDGES][NUM_ORIENTATIONS] = {
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0},
+	{0, 0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1},
+	{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1},
+};
+// Orientation of a corner cubie placed in a slot with a given twist
+static const unsigned char cornerOrientations[NUM_CORNERS][NUM_CORNERS][3] = {
+	{{0, 17, 14}, {19, 3, 12}, {2, 20, 15}, {23, 7, 13}, {18, 6, 9}, {1, 16, 10}, {22, 4, 8}, {5, 21, 11}},
+	{{23, 9, 3}, {0, 10, 20}, {19, 8, 7}, {2, 11, 17}, {1, 14, 21}, {22, 12, 6}, {5, 15, 16}, {18, 13, 4}},
+	{{2, 21, 10}, {23, 6, 8}, {0, 16, 11}, {19, 4, 9}, {22, 3, 13}, {5, 20, 14}, {18, 7, 12}, {1, 17, 15}},
+	{{19, 13, 6}, {2, 14, 16}, {23, 12, 4}, {0, 15, 21}, {5, 10, 17}, {18, 8, 3}, {1, 11, 20}, {22, 9, 7}},
+	{{18, 12, 7}, {1, 15, 17}, {22, 13, 3}, {5, 14, 20}, {0, 11, 16}, {19, 9, 4}, {2, 10, 21}, {23, 8, 6}},
+	{{1, 20, 11}, {22, 7, 9}, {5, 17, 10}, {18, 3, 8}, {23, 4, 12}, {0, 21, 15}, {19, 6, 13}, {2, 16, 14}},
+	{{22, 8, 4}, {5, 11, 21}, {18, 9, 6}, {1, 10, 16}, {2, 15, 20}, {23, 13, 7}, {0, 14, 17}, {19, 12, 3}},
+	{{5, 16, 15}, {18, 4, 13}, {1, 21, 14}, {22, 6, 12}, {19, 7, 8}, {2, 17, 11}, {23, 3, 9}, {0, 20, 10}},
+};
+// Orientation of an edge cubie placed in a slot with a given flip
+static const unsigned char edgeOrientations[NUM_EDGES][NUM_EDGES][2] = {
+	{{0, 13}, {19, 14}, {2, 12}, {23, 15}, {5, 9}, {18, 10}, {1, 8}, {22, 11}, {6, 17}, {3, 16}, {4, 20}, {7, 21}},
+	{{23, 17}, {0, 3}, {19, 20}, {2, 7}, {18, 21}, {1, 6}, {22, 16}, {5, 4}, {14, 9}, {10, 12}, {15, 8}, {11, 13}},
+	{{2, 9}, {23, 10}, {0, 8}, {19, 11}, {1, 13}, {22, 14}, {5, 12}, {18, 15}, {3, 21}, {6, 20}, {7, 16}, {4, 17}},
+	{{19, 21}, {2, 6}, {23, 16}, {0, 4}, {22, 17}, {5, 3}, {18, 20}, {1, 7}, {10, 13}, {14, 8}, {11, 12}, {15, 9}},
+	{{5, 12}, {18, 15}, {1, 13}, {22, 14}, {0, 8}, {19, 11}, {2, 9}, {23, 10}, {7, 16}, {4, 17}, {3, 21}, {6, 20}},
+	{{18, 20}, {1, 7}, {22, 17}, {5, 3}, {23, 16}, {0, 4}, {19, 21}, {2, 6}, {11, 12}, {15, 9}, {10, 13}, {14, 8}},
+	{{1, 8}, {22, 11}, {5, 9}, {18, 10}, {2, 12}, {23, 15}, {0, 13}, {19, 14}, {4, 20}, {7, 21}, {6, 17}, {3, 16}},
+	{{22, 16}, {5, 4}, {18, 21}, {1, 6}, {19, 20}, {2, 7}, {23, 17}, {0, 3}, {15, 8}, {11, 13}, {14, 9}, {10, 12}},
+	{{7, 14}, {17, 12}, {3, 15}, {20, 13}, {6, 11}, {16, 9}, {4, 10}, {21, 8}, {0, 18}, {1, 19}, {2, 22}, {5, 23}},
+	{{3, 11}, {20, 9}, {7, 10}, {17, 8}, {4, 14}, {21, 12}, {6, 15}, {16, 13}, {1, 23}, {0, 22}, {5, 19}, {2, 18}},
+	{{4, 10}, {21, 8}, {6, 11}, {16, 9}, {3, 15}, {20, 13}, {7, 14}, {17, 12}, {2, 22}, {5, 23}, {0, 18}, {1, 19}},
+	{{6, 15}, {16, 13}, {4, 14}, {21, 12}, {7, 10}, {17, 8}, {3, 11}, {20, 9}, {5, 19}, {2, 18}, {1, 23}, {0, 22}},
+};
+
+static int directionFromVector(Vec3f v);
+static int bitParity(unsigned int bits);
+
+void cs_initSolved(CubieState *state) {
+	for (int i=0; i<NUM_CUBES; i++) {
+		state->cubeAt[i] = i;
+		state->orientation[i] = ORIENTATION_IDENTITY;
+	}
+}
+
+void cs_fromRubiks(CubieState *state, Rubiks *rubiks) {
+	for (int i=0; i<NUM_CUBES; i++) {
+		Cube *cube = &rubiks->cubes[i];
+		state->cubeAt[cube->position] = cube->id;
+		state->orientation[cube->position] = cs_orientationFromQuat(&cube->quat);
+	}
+}
+
+void cs_toRubiks(const CubieState *state, Rubiks *rubiks) {
+	for (int pos=0; pos<NUM_CUBES; pos++) {
+		Cube *cube = &rubiks->cubes[state->cubeAt[pos]];
+		cube->position = pos;
+		cube->quat = orientQuats[state->orientation[pos]];
+	}
+}
+
+void cs_rotateFace(CubieState *state, int face, int direction) {
+	int turn = cs_faceTurn(face, direction);
+	const unsigned char *moved = orientPositions[turn];
+	unsigned char cubeAt[NUM_CUBES];
+	unsigned char orientation[NUM_CUBES];
+	memcpy(cubeAt, state->cubeAt, NUM_CUBES);
+	memcpy(orientation, state->orientation, NUM_CUBES);
+	for (int i=0; i<FACE_SIZE; i++) {
+		int pos = facePositions[face][i];
+		state->cubeAt[moved[pos]] = cubeAt[pos];
+		state->orientation[moved[pos]] = orientCompose[turn][orientation[pos]];
+	}
+}
+
+// Every cube at home, with corners and edges unturned. Center orientation
+// can't be seen, so it is left out.
+int cs_checkSolved(const CubieState *state) {
+	for (int i=0; i<NUM_CUBES; i++) {
+		if (state->cubeAt[i] != i) {
+			return 0;
+		}
+	}
+	for (int slot=0; slot<NUM_CORNERS; slot++) {
+		if (state->orientation[cornerSlots[slot]] != ORIENTATION_IDENTITY) {
+			return 0;
+		}
+	}
+	for (int slot=0; slot<NUM_EDGES; slot++) {
+		if (state->orientation[edgeSlots[slot]] != ORIENTATION_IDENTITY) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+void cs_toCoords(const CubieState *state, CubieCoords *coords) {
+	for (int slot=0; slot<NUM_CORNERS; slot++) {
+		int pos = cornerSlots[slot];
+		coords->cornerPerm[slot] = pieceIndex[state->cubeAt[pos]];
+		coords->cornerTwist[slot] = cornerTwists[slot][state->orientation[pos]];
+	}
+	for (int slot=0; slot<NUM_EDGES; slot++) {
+		int pos = edgeSlots[slot];
+		coords->edgePerm[slot] = pieceIndex[state->cubeAt[pos]];
+		coords->edgeFlip[slot] = edgeFlips[slot][state->orientation[pos]];
+	}
+}
+
+void cs_fromCoords(CubieState *state, const CubieCoords *coords) {
+	for (int i=0; i<NUM_FIXED; i++) {
+		state->cubeAt[fixedPositions[i]] = fixedPositions[i];
+		state->orientation[fixedPositions[i]] = ORIENTATION_IDENTITY;
+	}
+	for (int slot=0; slot<NUM_CORNERS; slot++) {
+		int pos = cornerSlots[slot];
+		int cubie = coords->cornerPerm[slot];
+		state->cubeAt[pos] = cornerSlots[cubie];
+		state->orientation[pos] = cornerOrientations[cubie][slot][coords->cornerTwist[slot]];
+	}
+	for (int slot=0; slot<NUM_EDGES; slot++) {
+		int pos = edgeSlots[slot];
+		int cubie = coords->edgePerm[slot];
+		state->cubeAt[pos] = edgeSlots[cubie];
+		state->orientation[pos] = edgeOrientations[cubie][slot][coords->edgeFlip[slot]];
+	}
+}
+
+// Permutation parity is accumulated from the inversions: for each slot,
+// the pieces already seen that are greater than this one
+int cs_checkCoords(const CubieCoords *coords) {
+	int twist = 0, flip = 0, parity = 0;
+	unsigned int seen = 0;
+	for (int slot=0; slot<NUM_CORNERS; slot++) {
+		twist += coords->cornerTwist[slot];
+		parity ^= bitParity(seen >> coords->cornerPerm[slot]);
+		seen |= 1u << coords->cornerPerm[slot];
+	}
+	seen = 0;
+	for (int slot=0; slot<NUM_EDGES; slot++) {
+		flip += coords->edgeFlip[slot];
+		parity ^= bitParity(seen >> coords->edgePerm[slot]);
+		seen |= 1u << coords->edgePerm[slot];
+	}
+	if (twist % 3) {
+		return CS_COORDS_TWIST;
+	}
+	if (flip % 2) {
+		return CS_COORDS_FLIP;
+	}
+	return parity ? CS_COORDS_PARITY : CS_COORDS_OK;
+}
+
+// Shuffle both permutations, then swap the last two edges if their parity
+// differs from the corners'. Seven twists and eleven flips are free; the
+// last of each is fixed by the others.
+void cs_randomCoords(CubieCoords *coords, Random *random) {
+	int parity = 0;
+	for (int i=0; i<NUM_CORNERS; i++) {
+		int j = random_below(random, i + 1);
+		coords->cornerPerm[i] = coords->cornerPerm[j];
+		coords->cornerPerm[j] = i;
+		parity ^= j != i;
+	}
+	for (int i=0; i<NUM_EDGES; i++) {
+		int j = random_below(random, i + 1);
+		coords->edgePerm[i] = coords->edgePerm[j];
+		coords->edgePerm[j] = i;
+		parity ^= j != i;
+	}
+	if (parity) {
+		unsigned char edge = coords->edgePerm[NUM_EDGES-2];
+		coords->edgePerm[NUM_EDGES-2] = coords->edgePerm[NUM_EDGES-1];
+		coords->edgePerm[NUM_EDGES-1] = edge;
+	}
+
+	uint32_t twist = random_below(random, 2187); // 3^7
+	int twistSum = 0;
+	for (int i=0; i<NUM_CORNERS-1; i++) {
+		coords->cornerTwist[i] = twist % 3;
+		twistSum += twist % 3;
+		twist /= 3;
+	}
+	coords->cornerTwist[NUM_CORNERS-1] = (3 - twistSum % 3) % 3;
+
+	uint64_t flip = random_next(random);
+	int flipSum = 0;
+	for (int i=0; i<NUM_EDGES-1; i++) {
+		coords->edgeFlip[i] = flip & 1;
+		flipSum += flip & 1;
+		flip >>= 1;
+	}
+	coords->edgeFlip[NUM_EDGES-1] = flipSum & 1;
+}
+
+void cs_randomize(CubieState *state, Random *random) {
+	CubieCoords coords;
+	cs_randomCoords(&coords, random);
+	cs_fromCoords(state, &coords);
+}
+
+static int bitParity(unsigned int bits) {
+	bits ^= bits >> 8;
+	bits ^= bits >> 4;
+	bits ^= bits >> 2;
+	bits ^= bits >> 1;
+	return bits & 1;
+}
+
+static int directionFromVector(Vec3f v) {
+	float ax = fabsf(v.x), ay = fabsf(v.y), az = fabsf(v.z);
+	if (ax >= ay && ax >= az) {
+		return v.x < 0 ? LEFT_FACE : RIGHT_FACE;
+	} else if (ay >= az) {
+		return v.y < 0 ? DOWN_FACE : UP_FACE;
+	}
+	return v.z < 0 ? FRONT_FACE : BACK_FACE;
+}
+
+// Snap a (possibly drifted) quaternion to the nearest of the 24 rotations
+int cs_orientationFromQuat(Quaternion *quat) {
+	int right = directionFromVector(quat_vecMultiply(quat, faceData[RIGHT_FACE].normal));
+	int up = directionFromVector(quat_vecMultiply(quat, faceData[UP_FACE].normal));
+	int orientation = orientFromAxes[right][up];
+	if (orientation < 0) {
+		log_error("Quaternion {%f, %f, %f, %f} is not a cube rotation", quat->x, quat->y, quat->z, quat->w);
+		return ORIENTATION_IDENTITY;
+	}
+	return orientation;
+}
+
+Quaternion cs_orientationQuat(int orientation) {
+	return orientQuats[orientation];
+}
+
+int cs_orientationCompose(int outer, int inner) {
+	return orientCompose[outer][inner];
+}
+
+int cs_orientationInverse(int orientation) {
+	return orientInverse[orientation];
+}
+
+int cs_orientationFace(int orientation, int face) {
+	return orientFaces[orientation][face];
+}
+
+int cs_orientationPosition(int orientation, int position) {
+	return orientPositions[orientation][position];
+}
+
+int cs_faceTurn(int face, int direction) {
+	return faceTurns[face][direction == CLOCKWISE ? 0 : 1];
+}
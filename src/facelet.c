@@ -0,0 +1,216 @@
+#include "facelet.h"
+
+#define INVALID 0xFF
+
+// Facelet positions follow the same per-face order as the faces table in
+// rubiks.c, so a facelet string reads each face the way rc_getFaceColors does.
+// Position and face direction of each facelet, in URFDLB order
+static const unsigned char faceletPositions[FACELET_COUNT] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8,
+	8, 5, 2, 17, 14, 11, 26, 23, 20,
+	6, 7, 8, 15, 16, 17, 24, 25, 26,
+	24, 25, 26, 21, 22, 23, 18, 19, 20,
+	0, 3, 6, 9, 12, 15, 18, 21, 24,
+	2, 1, 0, 11, 10, 9, 20, 19, 18,
+};
+static const unsigned char faceletDirections[FACELET_COUNT] = {
+	3, 3, 3, 3, 3, 3, 3, 3, 3,
+	1, 1, 1, 1, 1, 1, 1, 1, 1,
+	4, 4, 4, 4, 4, 4, 4, 4, 4,
+	2, 2, 2, 2, 2, 2, 2, 2, 2,
+	0, 0, 0, 0, 0, 0, 0, 0, 0,
+	5, 5, 5, 5, 5, 5, 5, 5, 5,
+};
+// Facelet letter shown in each face direction by a cube with a given orientation
+static const char shownLetter[NUM_ORIENTATIONS][NUM_FACES] = {
+	{'L', 'R', 'D', 'U', 'F', 'B'},
+	{'R', 'L', 'U', 'D', 'F', 'B'},
+	{'R', 'L', 'D', 'U', 'B', 'F'},
+	{'R', 'L', 'B', 'F', 'U', 'D'},
+	{'R', 'L', 'F', 'B', 'D', 'U'},
+	{'L', 'R', 'U', 'D', 'B', 'F'},
+	{'L', 'R', 'F', 'B', 'U', 'D'},
+	{'L', 'R', 'B', 'F', 'D', 'U'},
+	{'U', 'D', 'R', 'L', 'B', 'F'},
+	{'D', 'U', 'R', 'L', 'F', 'B'},
+	{'F', 'B', 'R', 'L', 'U', 'D'},
+	{'B', 'F', 'R', 'L', 'D', 'U'},
+	{'U', 'D', 'L', 'R', 'F', 'B'},
+	{'D', 'U', 'L', 'R', 'B', 'F'},
+	{'B', 'F', 'L', 'R', 'U', 'D'},
+	{'F', 'B', 'L', 'R', 'D', 'U'},
+	{'U', 'D', 'F', 'B', 'R', 'L'},
+	{'D', 'U', 'B', 'F', 'R', 'L'},
+	{'B', 'F', 'U', 'D', 'R', 'L'},
+	{'F', 'B', 'D', 'U', 'R', 'L'},
+	{'U', 'D', 'B', 'F', 'L', 'R'},
+	{'D', 'U', 'F', 'B', 'L', 'R'},
+	{'F', 'B', 'U', 'D', 'L', 'R'},
+	{'B', 'F', 'D', 'U', 'L', 'R'},
+};
+// Facelets of each corner and edge slot; U/D (or F/B) facelet first, corners clockwise
+static const unsigned char cornerFacelets[NUM_CORNERS][3] = {
+	{8, 9, 20},
+	{6, 18, 38},
+	{0, 36, 47},
+	{2, 45, 11},
+	{29, 26, 15},
+	{27, 44, 24},
+	{33, 53, 42},
+	{35, 17, 51},
+};
+static const unsigned char edgeFacelets[NUM_EDGES][2] = {
+	{5, 10},
+	{7, 19},
+	{3, 37},
+	{1, 46},
+	{32, 16},
+	{28, 25},
+	{30, 43},
+	{34, 52},
+	{23, 12},
+	{21, 41},
+	{50, 39},
+	{48, 14},
+};
+// Cubie and twist (cubie << 2 | twist) for each corner letter triple, indexed
+// by the letter codes below in base 7, 0xFF if invalid
+static const unsigned char cornerFromLetters[7*7*7] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x04, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x08, 0xFF, 0xFF, 0x0C, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x0D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x02, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x11, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x1E, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x12, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x15, 0xFF, 0xFF, 0x06, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x1C, 0xFF, 0xFF, 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x14, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x18, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x05, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x16, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x0A, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x09, 0xFF, 0xFF, 0x0E, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x1D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x1A, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+// Cubie and flip (cubie << 1 | flip) for each edge letter pair, 0xFF if invalid
+static const unsigned char edgeFromLetters[7*7] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0x00, 0x02, 0xFF, 0x04, 0x06,
+	0xFF, 0x01, 0xFF, 0x11, 0x09, 0xFF, 0x17,
+	0xFF, 0x03, 0x10, 0xFF, 0x0B, 0x12, 0xFF,
+	0xFF, 0xFF, 0x08, 0x0A, 0xFF, 0x0C, 0x0E,
+	0xFF, 0x05, 0xFF, 0x13, 0x0D, 0xFF, 0x15,
+	0xFF, 0x07, 0x16, 0xFF, 0x0F, 0x14, 0xFF,
+};
+
+// Letter codes: one plus the URFDLB index of each face letter, zero for any other byte
+static const unsigned char letterIndex[256] = {
+	['U'] = 1, ['R'] = 2, ['F'] = 3, ['D'] = 4, ['L'] = 5, ['B'] = 6
+};
+
+static const char *errorStrings[] = {
+	"ok",
+	"facelet string must be 54 characters",
+	"invalid facelet character",
+	"each color must appear exactly 9 times",
+	"center facelets must be URFDLB",
+	"invalid corner colors",
+	"invalid edge colors",
+	"corner used more than once",
+	"edge used more than once",
+	"corner twist is not solvable",
+	"edge flip is not solvable",
+	"corner and edge parity do not match"
+};
+
+static int checkLetters(const unsigned char *chars);
+
+void facelet_encode(const CubieState *state, char *out) {
+	for (int i=0; i<FACELET_COUNT; i++) {
+		int pos = faceletPositions[i];
+		out[i] = shownLetter[state->orientation[pos]][faceletDirections[i]];
+	}
+}
+
+int facelet_decode(CubieState *state, const char *in, int length) {
+	if (length != FACELET_COUNT) {
+		return FACELET_ERROR_LENGTH;
+	}
+	const unsigned char *chars = (const unsigned char *)in;
+	for (int face=0; face<6; face++) {
+		if (letterIndex[chars[face*FACE_SIZE + 4]] != face + 1) {
+			return checkLetters(chars);
+		}
+	}
+
+	CubieCoords coords;
+	int used = 0;
+	for (int slot=0; slot<NUM_CORNERS; slot++) {
+		const unsigned char *f = cornerFacelets[slot];
+		int entry = cornerFromLetters[(letterIndex[chars[f[0]]]*7
+			+ letterIndex[chars[f[1]]])*7 + letterIndex[chars[f[2]]]];
+		if (entry == INVALID) {
+			int error = checkLetters(chars);
+			return error ? error : FACELET_ERROR_CORNER;
+		}
+		int cubie = entry >> 2;
+		if (used & (1 << cubie)) {
+			return FACELET_ERROR_DUPLICATE_CORNER;
+		}
+		used |= 1 << cubie;
+		coords.cornerPerm[slot] = cubie;
+		coords.cornerTwist[slot] = entry & 3;
+	}
+
+	used = 0;
+	for (int slot=0; slot<NUM_EDGES; slot++) {
+		const unsigned char *f = edgeFacelets[slot];
+		int entry = edgeFromLetters[letterIndex[chars[f[0]]]*7 + letterIndex[chars[f[1]]]];
+		if (entry == INVALID) {
+			int error = checkLetters(chars);
+			return error ? error : FACELET_ERROR_EDGE;
+		}
+		int cubie = entry >> 1;
+		if (used & (1 << cubie)) {
+			return FACELET_ERROR_DUPLICATE_EDGE;
+		}
+		used |= 1 << cubie;
+		coords.edgePerm[slot] = cubie;
+		coords.edgeFlip[slot] = entry & 1;
+	}
+
+	// Unique valid corners and edges imply every color appears nine times
+	switch (cs_checkCoords(&coords)) {
+		case CS_COORDS_TWIST:
+			return FACELET_ERROR_TWIST;
+		case CS_COORDS_FLIP:
+			return FACELET_ERROR_FLIP;
+		case CS_COORDS_PARITY:
+			return FACELET_ERROR_PARITY;
+	}
+	// Center twist is not representable in a facelet string and decodes as unrotated
+	cs_fromCoords(state, &coords);
+	return FACELET_OK;
+}
+
+// Slow path used only to explain a failed decode: character, count and
+// center errors take precedence over piece errors
+static int checkLetters(const unsigned char *chars) {
+	int counts[7] = {0, 0, 0, 0, 0, 0, 0};
+	for (int i=0; i<FACELET_COUNT; i++) {
+		counts[letterIndex[chars[i]]]++;
+	}
+	if (counts[0]) {
+		return FACELET_ERROR_CHARACTER;
+	}
+	for (int l=1; l<7; l++) {
+		if (counts[l] != FACE_SIZE) {
+			return FACELET_ERROR_COUNT;
+		}
+	}
+	for (int face=0; face<6; face++) {
+		if (letterIndex[chars[face*FACE_SIZE + 4]] != face + 1) {
+			return FACELET_ERROR_CENTERS;
+		}
+	}
+	return FACELET_OK;
+}
+
+const char* facelet_errorString(int error) {
+	if (error > 0 || error < FACELET_ERROR_PARITY) {
+		return "unknown error";
+	}
+	return errorStrings[-error];
+}
@@ -0,0 +1,386 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "logger.h"
+
+// Callers only format their message into a slot of a bounded lock-free
+// ring (Vyukov's, each slot carrying a sequence number). A background
+// thread adds the prefix and writes batches to stderr. When the ring is
+// full records are dropped and counted rather than blocking the caller.
+
+#define RING_SIZE 4096 // power of two
+#define MESSAGE_SIZE 240 // longer records are truncated when queued
+#define PREFIX_SIZE 256 // room for the level, location and function name
+#define MAX_MODULES 16
+#define MODULE_NAME_SIZE 32
+#define WRITE_BUFFER_SIZE 65536
+#define IDLE_SLEEP_NS 250000
+#define CACHE_LINE 64
+
+typedef struct {
+	unsigned int sequence;
+	int level;
+	int line;
+	const char *file;
+	const char *func;
+	char message[MESSAGE_SIZE];
+} LogRecord;
+
+typedef struct {
+	char name[MODULE_NAME_SIZE];
+	int level;
+} ModuleLevel;
+
+int logger_threshold = LOG_DEFAULT_LEVEL;
+
+static int defaultLevel = LOG_DEFAULT_LEVEL;
+static ModuleLevel modules[MAX_MODULES];
+static int moduleCount = 0;
+
+static LogRecord ring[RING_SIZE];
+static struct {
+	char pad0[CACHE_LINE];
+	unsigned int enqueue;
+	char pad1[CACHE_LINE];
+	unsigned int dequeue;
+	char pad2[CACHE_LINE];
+} position;
+static unsigned long dropped = 0;
+
+static pthread_t writer;
+static int running = 0;
+static int stopping = 0;
+
+static void *writerMain(void *arg);
+static int push(int level, const char *file, int line, const char *func, const char *fmt, va_list args);
+static int pop(LogRecord *record);
+static int drain(FILE *out);
+static void reportDropped(FILE *out);
+static int formatRecord(char *out, int size, int level, const char *file, int line, const char *func, const char *message);
+static int parseLevel(const char *name, int length);
+static int moduleLength(const char *file, const char **start);
+static void updateThreshold();
+
+int logger_init() {
+	if (running) {
+		return 1;
+	}
+	const char *spec = getenv("RUBIKS_LOG");
+	if (spec != NULL && !logger_configure(spec)) {
+		fprintf(stderr, "Ignoring invalid RUBIKS_LOG: %s\n", spec);
+	}
+	for (unsigned int i=0; i<RING_SIZE; i++) {
+		ring[i].sequence = i;
+	}
+	position.enqueue = 0;
+	position.dequeue = 0;
+	stopping = 0;
+	if (pthread_create(&writer, NULL, writerMain, NULL) != 0) {
+		fprintf(stderr, "Unable to start log writer, logging synchronously\n");
+		return 0;
+	}
+	__atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+	atexit(logger_shutdown);
+	return 1;
+}
+
+// Stop the writer once everything queued so far is written
+void logger_shutdown() {
+	if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+	__atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+	pthread_join(writer, NULL);
+	__atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+	drain(stderr);
+	reportDropped(stderr);
+	fflush(stderr);
+}
+
+// Write out everything queued on the calling thread
+void logger_flush() {
+	if (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+		drain(stderr);
+	}
+	fflush(stderr);
+}
+
+// A comma separated list of a default level and module=level overrides,
+// e.g. "warn,solvercontroller=debug". Levels are names or numbers.
+int logger_configure(const char *spec) {
+	const char *token = spec;
+	while (*token) {
+		int length = strcspn(token, ",");
+		const char *equals = memchr(token, '=', length);
+		if (equals == NULL) {
+			int level = parseLevel(token, length);
+			if (level < 0) {
+				return 0;
+			}
+			logger_setLevel(level);
+		} else {
+			int level = parseLevel(equals + 1, length - (equals + 1 - token));
+			char name[MODULE_NAME_SIZE];
+			int nameLength = equals - token;
+			if (level < 0 || nameLength == 0 || nameLength >= MODULE_NAME_SIZE) {
+				return 0;
+			}
+			memcpy(name, token, nameLength);
+			name[nameLength] = '\0';
+			if (!logger_setModuleLevel(name, level)) {
+				return 0;
+			}
+		}
+		token += length;
+		if (*token == ',') {
+			token++;
+		}
+	}
+	return 1;
+}
+
+void logger_setLevel(int level) {
+	defaultLevel = level;
+	updateThreshold();
+}
+
+// Modules are source file names without directory or extension
+int logger_setModuleLevel(const char *module, int level) {
+	for (int i=0; i<moduleCount; i++) {
+		if (strcmp(modules[i].name, module) == 0) {
+			modules[i].level = level;
+			updateThreshold();
+			return 1;
+		}
+	}
+	if (moduleCount == MAX_MODULES || strlen(module) >= MODULE_NAME_SIZE) {
+		return 0;
+	}
+	strcpy(modules[moduleCount].name, module);
+	modules[moduleCount].level = level;
+	moduleCount++;
+	updateThreshold();
+	return 1;
+}
+
+int logger_enabled(int level, const char *file) {
+	if (moduleCount > 0) {
+		const char *name;
+		int length = moduleLength(file, &name);
+		for (int i=0; i<moduleCount; i++) {
+			if (strncmp(modules[i].name, name, length) == 0 && modules[i].name[length] == '\0') {
+				return level <= modules[i].level;
+			}
+		}
+	}
+	return level <= defaultLevel;
+}
+
+void logger_write(int level, const char *file, int line, const char *func, const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	if (level != LOG_FATAL && __atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+		if (!push(level, file, line, func, fmt, args)) {
+			__atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+		}
+		va_end(args);
+		return;
+	}
+
+	// Fatal records usually precede exit, so they go out at once, after
+	// anything still queued
+	if (level == LOG_FATAL) {
+		logger_flush();
+	}
+	// Only ring slots are bounded, so a long line is formatted on the heap
+	// rather than truncated
+	va_list retry;
+	va_copy(retry, args);
+	char stackMessage[MESSAGE_SIZE];
+	char *message = stackMessage;
+	int messageLength = vsnprintf(stackMessage, sizeof(stackMessage), fmt, args);
+	va_end(args);
+	if (messageLength >= MESSAGE_SIZE) {
+		char *heapMessage = malloc(messageLength + 1);
+		if (heapMessage != NULL) {
+			vsnprintf(heapMessage, messageLength + 1, fmt, retry);
+			message = heapMessage;
+		}
+	}
+	va_end(retry);
+
+	char stackText[MESSAGE_SIZE + PREFIX_SIZE];
+	char *text = stackText;
+	int size = sizeof(stackText);
+	if (message != stackMessage) {
+		size = messageLength + PREFIX_SIZE;
+		text = malloc(size);
+		if (text == NULL) {
+			text = stackText;
+			size = sizeof(stackText);
+		}
+	}
+	int length = formatRecord(text, size, level, file, line, func, message);
+	fwrite(text, 1, length, stderr);
+	fflush(stderr);
+	if (text != stackText) {
+		free(text);
+	}
+	if (message != stackMessage) {
+		free(message);
+	}
+}
+
+static void *writerMain(void *arg) {
+	struct timespec idle = {0, IDLE_SLEEP_NS};
+	while (!__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+		if (drain(stderr) == 0) {
+			reportDropped(stderr);
+			nanosleep(&idle, NULL);
+		}
+	}
+	return NULL;
+}
+
+static int push(int level, const char *file, int line, const char *func, const char *fmt, va_list args) {
+	unsigned int pos = __atomic_load_n(&position.enqueue, __ATOMIC_RELAXED);
+	LogRecord *record;
+	for (;;) {
+		record = &ring[pos & (RING_SIZE - 1)];
+		unsigned int sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+		int difference = (int)(sequence - pos);
+		if (difference == 0) {
+			if (__atomic_compare_exchange_n(&position.enqueue, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (difference < 0) {
+			return 0;
+		} else {
+			pos = __atomic_load_n(&position.enqueue, __ATOMIC_RELAXED);
+		}
+	}
+	record->level = level;
+	record->line = line;
+	record->file = file;
+	record->func = func;
+	vsnprintf(record->message, MESSAGE_SIZE, fmt, args);
+	__atomic_store_n(&record->sequence, pos + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+static int pop(LogRecord *out) {
+	unsigned int pos = __atomic_load_n(&position.dequeue, __ATOMIC_RELAXED);
+	LogRecord *record;
+	for (;;) {
+		record = &ring[pos & (RING_SIZE - 1)];
+		unsigned int sequence = __atomic_load_n(&record->sequence, __ATOMIC_ACQUIRE);
+		int difference = (int)(sequence - (pos + 1));
+		if (difference == 0) {
+			if (__atomic_compare_exchange_n(&position.dequeue, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (difference < 0) {
+			return 0;
+		} else {
+			pos = __atomic_load_n(&position.dequeue, __ATOMIC_RELAXED);
+		}
+	}
+	*out = *record;
+	__atomic_store_n(&record->sequence, pos + RING_SIZE, __ATOMIC_RELEASE);
+	return 1;
+}
+
+// Format and write every queued record, returns how many there were
+static int drain(FILE *out) {
+	static char buffer[WRITE_BUFFER_SIZE];
+	static pthread_mutex_t bufferLock = PTHREAD_MUTEX_INITIALIZER;
+	pthread_mutex_lock(&bufferLock);
+	int count = 0;
+	int used = 0;
+	LogRecord record;
+	while (pop(&record)) {
+		if (used > WRITE_BUFFER_SIZE - MESSAGE_SIZE - PREFIX_SIZE) {
+			fwrite(buffer, 1, used, out);
+			used = 0;
+		}
+		used += formatRecord(buffer + used, WRITE_BUFFER_SIZE - used, record.level, record.file,
+			record.line, record.func, record.message);
+		count++;
+	}
+	if (used > 0) {
+		fwrite(buffer, 1, used, out);
+		fflush(out);
+	}
+	pthread_mutex_unlock(&bufferLock);
+	return count;
+}
+
+static void reportDropped(FILE *out) {
+	unsigned long count = __atomic_exchange_n(&dropped, 0, __ATOMIC_RELAXED);
+	if (count > 0) {
+		fprintf(out, YEL "[WARN]" RESET " logger: %lu records dropped, log ring full\n", count);
+		fflush(out);
+	}
+}
+
+// Same layout per level as the original synchronous macros
+static int formatRecord(char *out, int size, int level, const char *file, int line, const char *func, const char *message) {
+	int length;
+	switch (level) {
+		case LOG_TRACE:
+			length = snprintf(out, size, "[TRACE] %s:%d:%s(): %s\n", file, line, func, message);
+			break;
+		case LOG_DEBUG:
+			length = snprintf(out, size, BLU "[DEBUG]" RESET " %s:%d:%s(): %s\n", file, line, func, message);
+			break;
+		case LOG_INFO:
+			length = snprintf(out, size, CYN "[INFO]" RESET " %s(): %s\n", func, message);
+			break;
+		case LOG_WARN:
+			length = snprintf(out, size, YEL "[WARN]" RESET " %s:%d:%s(): %s\n", file, line, func, message);
+			break;
+		case LOG_ERROR:
+			length = snprintf(out, size, RED "[ERROR]" RESET " %s:%d:%s(): %s\n", file, line, func, message);
+			break;
+		default:
+			length = snprintf(out, size, BLD RED "[FATAL] %s:%d:%s(): %s" RESET "\n", file, line, func, message);
+			break;
+	}
+	return length < size ? length : size - 1;
+}
+
+static int parseLevel(const char *name, int length) {
+	static const char *names[] = {"fatal", "error", "warn", "info", "debug", "trace"};
+	if (length == 1 && name[0] >= '0' + LOG_FATAL && name[0] <= '0' + LOG_TRACE) {
+		return name[0] - '0';
+	}
+	for (int level=LOG_FATAL; level<=LOG_TRACE; level++) {
+		if ((int)strlen(names[level]) == length && strncasecmp(names[level], name, length) == 0) {
+			return level;
+		}
+	}
+	return -1;
+}
+
+// The file name between the last slash and the first dot after it
+static int moduleLength(const char *file, const char **start) {
+	const char *slash = strrchr(file, '/');
+	*start = slash != NULL ? slash + 1 : file;
+	return strcspn(*start, ".");
+}
+
+static void updateThreshold() {
+	int threshold = defaultLevel;
+	for (int i=0; i<moduleCount; i++) {
+		if (modules[i].level > threshold) {
+			threshold = modules[i].level;
+		}
+	}
+	logger_threshold = threshold;
+}
@@ -1,12 +1,48 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include "view/gl_applicationview.h"
 
 #include "logger.h"
+#include "trace.h"
 
 int main( int argc, char* argv[] ){
-	glapp_init();
-	if (argc >= 2) {
-		glapp_loadState(argv[1]);
+	int columns = 0, rows = 0;
+	const char *traceFile = NULL;
+	int invalid = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "w:L:T:")) != -1) {
+		switch (opt) {
+			case 'w':
+				invalid |= sscanf(optarg, "%dx%d", &columns, &rows) != 2 || columns <= 0 || rows <= 0;
+				break;
+			case 'L':
+				invalid |= !logger_configure(optarg);
+				break;
+			case 'T':
+				traceFile = optarg;
+				break;
+			default:
+				invalid = 1;
+		}
+	}
+	if (invalid) {
+		fprintf(stderr, "Usage: %s [-w COLUMNSxROWS] [-L level[,module=level...]] [-T trace.json] [statefile]\n", argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	logger_init();
+	if (!(traceFile != NULL ? trace_open(traceFile) : trace_init())) {
+		exit(EXIT_FAILURE);
+	}
+	if (!glapp_init()) {
+		exit(EXIT_FAILURE);
+	}
+	if (optind < argc && !glapp_loadState(argv[optind])) {
+		exit(EXIT_FAILURE);
+	}
+	if (columns > 0 && !glapp_showWall(columns, rows)) {
+		exit(EXIT_FAILURE);
 	}
 	int code = glapp_run();
 	exit(code);
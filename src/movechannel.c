@@ -0,0 +1,75 @@
+#include "movechannel.h"
+#include "logger.h"
+
+// Indices increase monotonically and wrap naturally as unsigned ints;
+// each side only ever writes its own index and reads the other's with
+// acquire ordering, so no locks are needed.
+int mc_init(MoveChannel *channel, int capacity) {
+	unsigned int size = 1;
+	while (size < (unsigned int)capacity) {
+		size <<= 1;
+	}
+	channel->items = malloc(size * sizeof(Step));
+	if (channel->items == NULL) {
+		log_error("Unable to allocate move channel of %u items", size);
+		return 0;
+	}
+	channel->mask = size - 1;
+	channel->head = 0;
+	channel->tail = 0;
+	return 1;
+}
+
+void mc_free(MoveChannel *channel) {
+	free(channel->items);
+	channel->items = NULL;
+	channel->mask = 0;
+	channel->head = 0;
+	channel->tail = 0;
+}
+
+int mc_push(MoveChannel *channel, Step step) {
+	return mc_pushMultiple(channel, &step, 1);
+}
+
+// Push as many of steps as fit, returns the number pushed
+int mc_pushMultiple(MoveChannel *channel, const Step *steps, int count) {
+	if (count <= 0) {
+		return 0;
+	}
+	unsigned int tail = channel->tail;
+	unsigned int head = __atomic_load_n(&channel->head, __ATOMIC_ACQUIRE);
+	unsigned int space = channel->mask + 1 - (tail - head);
+	unsigned int n = (unsigned int)count < space ? (unsigned int)count : space;
+	for (unsigned int i=0; i<n; i++) {
+		channel->items[(tail + i) & channel->mask] = steps[i];
+	}
+	__atomic_store_n(&channel->tail, tail + n, __ATOMIC_RELEASE);
+	return n;
+}
+
+int mc_pop(MoveChannel *channel, Step *step) {
+	unsigned int head = channel->head;
+	unsigned int tail = __atomic_load_n(&channel->tail, __ATOMIC_ACQUIRE);
+	if (head == tail) {
+		return 0;
+	}
+	*step = channel->items[head & channel->mask];
+	__atomic_store_n(&channel->head, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+void mc_drain(MoveChannel *channel) {
+	unsigned int tail = __atomic_load_n(&channel->tail, __ATOMIC_ACQUIRE);
+	__atomic_store_n(&channel->head, tail, __ATOMIC_RELEASE);
+}
+
+int mc_size(MoveChannel *channel) {
+	unsigned int tail = __atomic_load_n(&channel->tail, __ATOMIC_ACQUIRE);
+	unsigned int head = __atomic_load_n(&channel->head, __ATOMIC_ACQUIRE);
+	return tail - head;
+}
+
+int mc_isEmpty(MoveChannel *channel) {
+	return mc_size(channel) == 0;
+}
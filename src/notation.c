@@ -0,0 +1,115 @@
+#include "notation.h"
+#include "rubiks.h"
+
+#define NO_MOVE -1
+
+static int moveForLetter(char letter);
+static int isSpace(char c);
+
+// Parses into the caller's step array without allocating. Returns the number
+// of steps, or a NOTATION_ERROR_* code with errorOffset set to the offending
+// character.
+int notation_parse(const char *text, int length, Step *steps, int maxSteps, int *errorOffset) {
+	int count = 0;
+	int i = 0;
+	while (i < length) {
+		if (isSpace(text[i])) {
+			i++;
+			continue;
+		}
+		int start = i;
+		int move = moveForLetter(text[i++]);
+		if (move == NO_MOVE) {
+			if (errorOffset) {
+				*errorOffset = start;
+			}
+			return NOTATION_ERROR_SYNTAX;
+		}
+		int turns = 1;
+		int direction = CLOCKWISE;
+		if (move < NUM_FACES && i < length && text[i] == 'w') {
+			move += WIDE_MOVES;
+			i++;
+		}
+		if (i < length && text[i] == '2') {
+			turns = 2;
+			i++;
+		}
+		if (i < length && text[i] == '\'') {
+			direction = COUNTERCLOCKWISE;
+			i++;
+		}
+		if (count + turns > maxSteps) {
+			if (errorOffset) {
+				*errorOffset = start;
+			}
+			return NOTATION_ERROR_OVERFLOW;
+		}
+		for (int t=0; t<turns; t++) {
+			steps[count].face = move;
+			steps[count].direction = direction;
+			count++;
+		}
+	}
+	return count;
+}
+
+// Writes steps as notation, merging repeated quarter turns of a move into a
+// half turn or a single inverse turn. Returns the length written, excluding
+// the terminating NUL, or -1 if out is too small.
+int notation_format(const Step *steps, int count, char *out, int size) {
+	int length = 0;
+	int i = 0;
+	while (i < count) {
+		int move = steps[i].face;
+		int quarterTurns = 0;
+		while (i < count && steps[i].face == move) {
+			quarterTurns += steps[i].direction;
+			i++;
+		}
+		quarterTurns = ((quarterTurns % 4) + 4) % 4;
+		if (quarterTurns == 0) {
+			continue;
+		}
+		if (length + 4 > size) {
+			return -1;
+		}
+		if (length > 0) {
+			out[length++] = ' ';
+		}
+		out[length++] = moveData[move].name[0];
+		if (quarterTurns == 2) {
+			out[length++] = '2';
+		} else if (quarterTurns == 3) {
+			out[length++] = '\'';
+		}
+	}
+	if (length >= size) {
+		return -1;
+	}
+	out[length] = '\0';
+	return length;
+}
+
+const char* notation_errorString(int error) {
+	switch (error) {
+		case NOTATION_ERROR_SYNTAX:
+			return "unrecognized move";
+		case NOTATION_ERROR_OVERFLOW:
+			return "too many moves";
+	}
+	return "unknown error";
+}
+
+static int moveForLetter(char letter) {
+	for (int move=0; move<NUM_MOVES; move++) {
+		if (moveData[move].name[0] == letter) {
+			return move;
+		}
+	}
+	return NO_MOVE;
+}
+
+static int isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',';
+}
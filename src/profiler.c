@@ -0,0 +1,147 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profiler.h"
+#include "timer.h"
+#include "trace.h"
+#include "utils.h"
+
+#define HISTOGRAM_BUCKETS 400
+#define HISTOGRAM_BASE 1.05 // bucket b holds samples near 1.05^b microseconds
+#define MOVE_RATE_WINDOW 1.0 // seconds
+
+typedef struct {
+	double recent[PROF_WINDOW];
+	int next;
+	long count;
+	double total;
+	double max;
+	long histogram[HISTOGRAM_BUCKETS];
+} Section;
+
+static const char *sectionNames[PROF_NUM_SECTIONS] = {"frame", "play", "update", "draw", "swap", "plan"};
+
+static Section sections[PROF_NUM_SECTIONS];
+static double startTime;
+static long totalMoves;
+static long windowMoves;
+static double windowStart;
+static double moveRate;
+
+static double histogramPercentile(Section *section, double fraction);
+
+void prof_init() {
+	memset(sections, 0, sizeof(sections));
+	startTime = timer_now();
+	windowStart = startTime;
+	totalMoves = 0;
+	windowMoves = 0;
+	moveRate = 0;
+}
+
+double prof_begin() {
+	return timer_now();
+}
+
+// Each sample is also a trace event while tracing
+void prof_end(int section, double start) {
+	double end = timer_now();
+	trace_complete(sectionNames[section], "frame", start, end);
+	prof_addSample(section, (end - start) * 1000);
+}
+
+void prof_addSample(int section, double ms) {
+	Section *s = &sections[section];
+	s->recent[s->next] = ms;
+	s->next = (s->next + 1) % PROF_WINDOW;
+	s->count++;
+	s->total += ms;
+	if (ms > s->max) {
+		s->max = ms;
+	}
+	int bucket = ms * 1000 > 1 ? (int)(log(ms * 1000) / log(HISTOGRAM_BASE)) : 0;
+	s->histogram[bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1]++;
+}
+
+void prof_addMoves(int count) {
+	totalMoves += count;
+	windowMoves += count;
+}
+
+const char* prof_sectionName(int section) {
+	return sectionNames[section];
+}
+
+// Exact statistics over the last PROF_WINDOW samples
+void prof_recentStats(int section, ProfStats *stats) {
+	Section *s = &sections[section];
+	int n = s->count < PROF_WINDOW ? s->count : PROF_WINDOW;
+	double sorted[PROF_WINDOW];
+	memset(stats, 0, sizeof(ProfStats));
+	if (n == 0) {
+		return;
+	}
+	memcpy(sorted, s->recent, n * sizeof(double));
+	qsort(sorted, n, sizeof(double), compareDoubles);
+	double sum = 0;
+	for (int i=0; i<n; i++) {
+		sum += sorted[i];
+	}
+	stats->last = s->recent[(s->next + PROF_WINDOW - 1) % PROF_WINDOW];
+	stats->mean = sum / n;
+	stats->p50 = percentile(sorted, n, 0.50);
+	stats->p99 = percentile(sorted, n, 0.99);
+	stats->max = sorted[n - 1];
+	stats->count = n;
+}
+
+// Statistics over every sample, percentiles to within the bucket width
+void prof_totalStats(int section, ProfStats *stats) {
+	Section *s = &sections[section];
+	memset(stats, 0, sizeof(ProfStats));
+	if (s->count == 0) {
+		return;
+	}
+	stats->last = s->recent[(s->next + PROF_WINDOW - 1) % PROF_WINDOW];
+	stats->mean = s->total / s->count;
+	stats->p50 = histogramPercentile(s, 0.50);
+	stats->p99 = histogramPercentile(s, 0.99);
+	stats->max = s->max;
+	stats->count = s->count;
+}
+
+double prof_movesPerSecond() {
+	double now = timer_now();
+	if (now - windowStart >= MOVE_RATE_WINDOW) {
+		moveRate = windowMoves / (now - windowStart);
+		windowMoves = 0;
+		windowStart = now;
+	}
+	return moveRate;
+}
+
+void prof_printSummary(FILE *fp) {
+	double seconds = timer_now() - startTime;
+	fprintf(fp, "Profile summary over %.1fs:\n", seconds);
+	fprintf(fp, "  %-8s %8s %9s %9s %9s %9s\n", "section", "count", "mean ms", "p50 ms", "p99 ms", "max ms");
+	for (int i=0; i<PROF_NUM_SECTIONS; i++) {
+		ProfStats stats;
+		prof_totalStats(i, &stats);
+		fprintf(fp, "  %-8s %8li %9.3f %9.3f %9.3f %9.3f\n",
+			sectionNames[i], stats.count, stats.mean, stats.p50, stats.p99, stats.max);
+	}
+	fprintf(fp, "  %li moves, %.1f moves/s\n", totalMoves, seconds > 0 ? totalMoves / seconds : 0);
+}
+
+static double histogramPercentile(Section *section, double fraction) {
+	long target = (long)((section->count - 1) * fraction);
+	long seen = 0;
+	for (int b=0; b<HISTOGRAM_BUCKETS; b++) {
+		seen += section->histogram[b];
+		if (seen > target) {
+			return fmin(pow(HISTOGRAM_BASE, b + 0.5) / 1000, section->max);
+		}
+	}
+	return section->max;
+}
@@ -14,9 +14,6 @@ static Quaternion identityQuat = {
 	QUAT_IDENTITY_Z, QUAT_IDENTITY_W
 };
 
-// util methods
-float degToRad(float deg);
-
 void quat_init(Quaternion *quat, float x, float y, float z, float w);
 Quaternion quat_conjugate(Quaternion *quat);
 Quaternion quat_inverse(Quaternion *quat);
@@ -106,8 +103,7 @@ float quat_magnitude(Quaternion *quat) {
 	return sqrt(l);
 }
 
-float* quat_toMatrix(Quaternion *quat) {
-	static float mat[16];
+void quat_writeMatrix(Quaternion *quat, float mat[16]) {
 	// initialize identity matrix
 	for (int i=0; i<16; i++) {
 		mat[i] = (i%5==0) ? 1: 0;
@@ -125,8 +121,34 @@ float* quat_toMatrix(Quaternion *quat) {
 	mat[8] = 2*quat->x*quat->z - 2*quat->y*quat->w;
 	mat[9] = 2*quat->y*quat->z + 2*quat->x*quat->w;
 	mat[10] =  1 - 2*quat->x*quat->x - 2*quat->y*quat->y;
+}
 
-	return mat;
+// One branch-free pass with no aliasing, so an optimizing compiler can
+// vectorize it across quaternions
+void quat_writeMatrices(const float *restrict x, const float *restrict y, const float *restrict z,
+	const float *restrict w, int count, float *restrict matrices) {
+	for (int i=0; i<count; i++) {
+		float xx = x[i]*x[i], yy = y[i]*y[i], zz = z[i]*z[i];
+		float xy = x[i]*y[i], xz = x[i]*z[i], yz = y[i]*z[i];
+		float xw = x[i]*w[i], yw = y[i]*w[i], zw = z[i]*w[i];
+		float *mat = matrices + i*16;
+		mat[0] = 1 - 2*(yy + zz);
+		mat[1] = 2*(xy - zw);
+		mat[2] = 2*(xz + yw);
+		mat[3] = 0;
+		mat[4] = 2*(xy + zw);
+		mat[5] = 1 - 2*(xx + zz);
+		mat[6] = 2*(yz - xw);
+		mat[7] = 0;
+		mat[8] = 2*(xz - yw);
+		mat[9] = 2*(yz + xw);
+		mat[10] = 1 - 2*(xx + yy);
+		mat[11] = 0;
+		mat[12] = 0;
+		mat[13] = 0;
+		mat[14] = 0;
+		mat[15] = 1;
+	}
 }
 
 void quat_setEqual(Quaternion *q1, Quaternion *q2) {
@@ -0,0 +1,71 @@
+#include "random.h"
+
+static uint64_t rotl(uint64_t x, int k);
+
+// The seed is expanded with splitmix64 so nearby seeds give unrelated
+// streams and the state is never all zero
+void random_seed(Random *random, uint64_t seed) {
+	for (int i=0; i<4; i++) {
+		seed += 0x9E3779B97F4A7C15ull;
+		uint64_t z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		random->s[i] = z ^ (z >> 31);
+	}
+}
+
+uint64_t random_next(Random *random) {
+	uint64_t *s = random->s;
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+// Multiply and shift, rejecting the few low products that would bias the
+// result toward small values
+uint32_t random_below(Random *random, uint32_t bound) {
+	uint64_t product = (random_next(random) >> 32) * bound;
+	uint32_t low = (uint32_t)product;
+	if (low < bound) {
+		uint32_t threshold = -bound % bound;
+		while (low < threshold) {
+			product = (random_next(random) >> 32) * bound;
+			low = (uint32_t)product;
+		}
+	}
+	return product >> 32;
+}
+
+double random_unit(Random *random) {
+	return (random_next(random) >> 11) * 0x1.0p-53;
+}
+
+void random_jump(Random *random) {
+	static const uint64_t jump[4] = {
+		0x180EC6D33CFD0ABAull, 0xD5A61266F0C9392Cull, 0xA9582618E03FC9AAull, 0x39ABDC4529B1661Cull
+	};
+	uint64_t s[4] = {0, 0, 0, 0};
+	for (int i=0; i<4; i++) {
+		for (int bit=0; bit<64; bit++) {
+			if (jump[i] & (1ull << bit)) {
+				for (int j=0; j<4; j++) {
+					s[j] ^= random->s[j];
+				}
+			}
+			random_next(random);
+		}
+	}
+	for (int j=0; j<4; j++) {
+		random->s[j] = s[j];
+	}
+}
+
+static uint64_t rotl(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
@@ -1,8 +1,11 @@
 #include "rubiks.h"
+#include "cubiestate.h"
 #include "utils.h"
 #include "logger.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // Array positions of cubes after a 90-degree clockwise rotation
 static const int rotation[FACE_SIZE] = {6, 3, 0, 7, 4, 1, 8, 5, 2}; // to rotate ccw flip face and rotation values
@@ -20,9 +23,11 @@ static const int faces[NUM_FACES][FACE_SIZE] =
 
 static void rc_translateFace(Rubiks *rubiks, const int face[], const int translation[]);
 static int rc_getFace(Rubiks *rubiks, int face, Cube* cubes[]);
+static void rotateFrame(int frame[NUM_FACES], int face, int direction);
+static void resetFrame(Rubiks *rubiks);
 
 void rc_rotateFace(Rubiks *rubiks, int face, int direction) {
-	if (face > NUM_FACES || face < 0) {
+	if (face >= NUM_FACES || face < 0) {
 		log_fatal("Attempted to rotate invalid face #%i", face);
 		exit(1);
 	}
@@ -31,6 +36,7 @@ void rc_rotateFace(Rubiks *rubiks, int face, int direction) {
 		faces[face][6], faces[face][7], faces[face][8], faceData[face].rotation.x, faceData[face].rotation.y,
 		faceData[face].rotation.z, direction==CLOCKWISE ? "":"counter"
 	);
+	trace_begin("rc_rotateFace", "engine");
 	Cube* cubes[FACE_SIZE];
 	rc_getFace(rubiks, face, cubes);
 	int newPositions[FACE_SIZE];
@@ -53,6 +59,69 @@ void rc_rotateFace(Rubiks *rubiks, int face, int direction) {
 	for (int i=0; i<FACE_SIZE; i++) {
 		cube_rotate(cubes[i], deg);
 	}
+	trace_end("rc_rotateFace", "engine");
+}
+
+// Apply any move as seen through the frame
+void rc_applyMove(Rubiks *rubiks, int move, int direction) {
+	Step turns[2];
+	int count = rc_resolveMove(rubiks->frame, move, direction, turns);
+	for (int i=0; i<count; i++) {
+		rc_rotateFace(rubiks, turns[i].face, turns[i].direction);
+	}
+}
+
+// Reduce a move to at most two physical outer turns, written to turns, plus
+// a relabeling of frame. A slice turns the two faces around it and rotates
+// the frame back (M = R L' x'); a wide move turns the opposite face and
+// rotates the frame (r = L x). Returns the number of turns.
+int rc_resolveMove(int frame[NUM_FACES], int move, int direction, Step turns[2]) {
+	if (move < 0 || move >= NUM_MOVES) {
+		log_fatal("Attempted to apply invalid move #%i", move);
+		exit(1);
+	}
+	int axis = moveData[move].axis;
+	int opposite = axis ^ 1;
+	int count = 0;
+	if (move < NUM_FACES) {
+		turns[count++] = (Step){frame[move], direction};
+		return count;
+	}
+	if (move < WIDE_MOVES) {
+		turns[count++] = (Step){frame[opposite], direction};
+		turns[count++] = (Step){frame[axis], -direction};
+	} else if (move < ROTATE_X) {
+		turns[count++] = (Step){frame[opposite], direction};
+	}
+	rotateFrame(frame, axis, direction);
+	return count;
+}
+
+// The face currently seen in place of physical face
+int rc_frameFace(Rubiks *rubiks, int face) {
+	for (int i=0; i<NUM_FACES; i++) {
+		if (rubiks->frame[i] == face) {
+			return i;
+		}
+	}
+	return face;
+}
+
+// Turning the whole cube clockwise moves what was seen on each neighbor of
+// face onto the next neighbor around it
+static void rotateFrame(int frame[NUM_FACES], int face, int direction) {
+	const int *neighbors = faceData[face].neighbors;
+	int previous[NUM_FACES];
+	memcpy(previous, frame, sizeof(previous));
+	for (int i=0; i<4; i++) {
+		frame[neighbors[(i + direction + 4) % 4]] = previous[neighbors[i]];
+	}
+}
+
+static void resetFrame(Rubiks *rubiks) {
+	for (int i=0; i<NUM_FACES; i++) {
+		rubiks->frame[i] = i;
+	}
 }
 
 void rc_translateFace(Rubiks *rubiks, const int face[], const int translation[]) {
@@ -98,12 +167,14 @@ void rc_initialize(Rubiks *rubiks) {
 		cube_initialize(&rubiks->cubes[i], i, i);
 	}
 	rubiks->cubeInProgress = -1;
+	resetFrame(rubiks);
 }
 
 void rc_reset(Rubiks *rubiks) {
 	for (int i = 0; i<NUM_CUBES; i++) {
 		cube_reset(&rubiks->cubes[i]);
 	}
+	resetFrame(rubiks);
 }
 
 int rc_getFace(Rubiks *rubiks, int face, Cube* cubes[]) {
@@ -141,11 +212,15 @@ int rc_serialize(Rubiks *rubiks, char* out) {
 }
 
 void rc_serializeState(Rubiks *rubiks) {
+	rc_writeState(rubiks, stdout);
+}
+
+void rc_writeState(Rubiks *rubiks, FILE *fp) {
 	for (int i=0; i<NUM_CUBES; i++) {
 		Cube *cube = &rubiks->cubes[i];
-		printf("%i:%.10f:%.10f:%.10f:%.10f;", cube->position, cube->quat.x, cube->quat.y, cube->quat.z, cube->quat.w);
+		fprintf(fp, "%i:%.10f:%.10f:%.10f:%.10f;", cube->position, cube->quat.x, cube->quat.y, cube->quat.z, cube->quat.w);
 	}
-	printf("\n");
+	fprintf(fp, "\n");
 }
 
 void rc_deserializeState(Rubiks *rubiks, char* statestr) {
@@ -154,7 +229,7 @@ void rc_deserializeState(Rubiks *rubiks, char* statestr) {
 		int pos;
 		float x, y, z, w;
 		sscanf(statestr, "%i:%f:%f:%f:%f;%n", &pos, &x, &y, &z, &w, &posn);
-		log_info("Loading cube %i: pos: %i", i, pos);
+		log_debug("Loading cube %i: pos: %i", i, pos);
 		rubiks->cubes[i].position = pos;
 		rubiks->cubes[i].quat = (Quaternion) {x, y, z, w};
 		statestr += posn;
@@ -181,12 +256,22 @@ int rc_getFaceColors(Rubiks *rubiks, int face, char* colors) {
 	return 1;
 }
 
-void rc_shuffle(Rubiks *rubiks, int times) {
+// Random quarter turns. Short shuffles stay close to solved; use
+// rc_randomize for a state drawn evenly from every reachable one.
+void rc_shuffle(Rubiks *rubiks, int times, Random *random) {
 	for (int i=0; i<times; i++) {
-		rc_rotateFace(rubiks, rand()%NUM_FACES, rand()%2==0 ? 1:-1);
+		uint32_t turn = random_below(random, NUM_FACES * 2);
+		rc_rotateFace(rubiks, turn >> 1, turn & 1 ? COUNTERCLOCKWISE : CLOCKWISE);
 	}
 }
 
+void rc_randomize(Rubiks *rubiks, Random *random) {
+	CubieState state;
+	cs_randomize(&state, random);
+	cs_toRubiks(&state, rubiks);
+	rubiks->cubeInProgress = -1;
+}
+
 int rc_checkSolved(Rubiks *rubiks) {
 	for (int i=0; i<NUM_CUBES; i++) {
 		Cube *cube = &rubiks->cubes[i];
@@ -0,0 +1,141 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "statecodec.h"
+#include "logger.h"
+
+#define CORE_ID 13
+#define NUM_PACKED (NUM_CUBES - 1)
+#define BITS_PER_CUBE 5
+#define PAYLOAD_SIZE (STATE_BINARY_SIZE - STATE_BINARY_HEADER_SIZE)
+#define PAYLOAD_BITS (NUM_PACKED * BITS_PER_CUBE)
+
+static const unsigned char centerPositions[NUM_FACES] = {4, 10, 12, 14, 16, 22};
+
+static void packOrientations(const unsigned char values[NUM_PACKED], unsigned char *out);
+static int unpackOrientations(const unsigned char *in, unsigned char values[NUM_PACKED]);
+
+int codec_isBinary(const unsigned char *in, int length) {
+	return length >= STATE_BINARY_SIZE
+		&& in[0] == STATE_BINARY_MAGIC0
+		&& in[1] == STATE_BINARY_MAGIC1;
+}
+
+// Orientations are recorded per cube id, skipping the core (which never moves);
+// a cube's position is implied by its orientation, since every rotation
+// moves the cube's home position to where it currently sits.
+void codec_encodeBinary(const CubieState *state, unsigned char *out) {
+	unsigned char byId[NUM_CUBES];
+	for (int pos=0; pos<NUM_CUBES; pos++) {
+		byId[state->cubeAt[pos]] = state->orientation[pos];
+	}
+	unsigned char values[NUM_PACKED];
+	for (int i=0; i<NUM_PACKED; i++) {
+		values[i] = byId[i < CORE_ID ? i : i+1];
+	}
+
+	out[0] = STATE_BINARY_MAGIC0;
+	out[1] = STATE_BINARY_MAGIC1;
+	out[2] = STATE_BINARY_VERSION;
+	packOrientations(values, out + STATE_BINARY_HEADER_SIZE);
+}
+
+int codec_decodeBinary(CubieState *state, const unsigned char *in) {
+	if (in[0] != STATE_BINARY_MAGIC0 || in[1] != STATE_BINARY_MAGIC1) {
+		log_error("%s", "Binary state has bad magic number");
+		return 0;
+	}
+	if (in[2] != STATE_BINARY_VERSION) {
+		log_error("Unsupported binary state version %i", in[2]);
+		return 0;
+	}
+	unsigned char values[NUM_PACKED];
+	if (!unpackOrientations(in + STATE_BINARY_HEADER_SIZE, values)) {
+		log_error("%s", "Binary state has invalid orientation data");
+		return 0;
+	}
+
+	unsigned int occupied = 1u << CORE_ID;
+	state->cubeAt[CORE_ID] = CORE_ID;
+	state->orientation[CORE_ID] = ORIENTATION_IDENTITY;
+	for (int i=0; i<NUM_PACKED; i++) {
+		int id = i < CORE_ID ? i : i+1;
+		int pos = cs_orientationPosition(values[i], id);
+		if (occupied & (1u << pos)) {
+			log_error("Binary state places two cubes at position %i", pos);
+			return 0;
+		}
+		occupied |= 1u << pos;
+		state->cubeAt[pos] = id;
+		state->orientation[pos] = values[i];
+	}
+
+	// Same checks as a facelet string: centers at home (their twist is
+	// ignored), then twist, flip and parity
+	for (int i=0; i<NUM_FACES; i++) {
+		if (state->cubeAt[centerPositions[i]] != centerPositions[i]) {
+			log_error("%s", "Binary state has a center out of place");
+			return 0;
+		}
+	}
+	CubieCoords coords;
+	cs_toCoords(state, &coords);
+	int error = cs_checkCoords(&coords);
+	if (error != CS_COORDS_OK) {
+		log_error("Binary state is not solvable: %s", error == CS_COORDS_TWIST ? "corner twist"
+			: error == CS_COORDS_FLIP ? "edge flip" : "corner and edge parity");
+		return 0;
+	}
+	return 1;
+}
+
+void codec_encodeBinaryBulk(const CubieState *states, int count, unsigned char *out) {
+	for (int i=0; i<count; i++) {
+		codec_encodeBinary(&states[i], out + i*STATE_BINARY_SIZE);
+	}
+}
+
+// Returns the number of records decoded before the first invalid one
+int codec_decodeBinaryBulk(CubieState *states, int count, const unsigned char *in) {
+	for (int i=0; i<count; i++) {
+		if (!codec_decodeBinary(&states[i], in + i*STATE_BINARY_SIZE)) {
+			return i;
+		}
+	}
+	return count;
+}
+
+// Fixed-size, branch-free bit packing through three 64-bit words so the
+// compiler can fully unroll it
+static void packOrientations(const unsigned char values[NUM_PACKED], unsigned char *out) {
+	uint64_t words[3] = {0, 0, 0};
+	for (int i=0; i<NUM_PACKED; i++) {
+		int bit = i * BITS_PER_CUBE;
+		uint64_t value = values[i];
+		words[bit / 64] |= value << (bit % 64);
+		if (bit % 64 > 64 - BITS_PER_CUBE) {
+			words[bit / 64 + 1] |= value >> (64 - bit % 64);
+		}
+	}
+	for (int i=0; i<PAYLOAD_SIZE; i++) {
+		out[i] = (unsigned char)(words[i / 8] >> (8 * (i % 8)));
+	}
+}
+
+static int unpackOrientations(const unsigned char *in, unsigned char values[NUM_PACKED]) {
+	uint64_t words[3] = {0, 0, 0};
+	for (int i=0; i<PAYLOAD_SIZE; i++) {
+		words[i / 8] |= (uint64_t)in[i] << (8 * (i % 8));
+	}
+	int invalid = (words[PAYLOAD_BITS / 64] >> (PAYLOAD_BITS % 64)) != 0;
+	for (int i=0; i<NUM_PACKED; i++) {
+		int bit = i * BITS_PER_CUBE;
+		uint64_t value = words[bit / 64] >> (bit % 64);
+		if (bit % 64 > 64 - BITS_PER_CUBE) {
+			value |= words[bit / 64 + 1] << (64 - bit % 64);
+		}
+		values[i] = value & ((1 << BITS_PER_CUBE) - 1);
+		invalid |= values[i] >= NUM_ORIENTATIONS;
+	}
+	return !invalid;
+}
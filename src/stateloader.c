@@ -0,0 +1,236 @@
+#define _POSIX_C_SOURCE 200112L
+#define _DEFAULT_SOURCE // madvise
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "stateloader.h"
+#include "statecodec.h"
+#include "facelet.h"
+#include "logger.h"
+
+// Consumed pages are handed back to the kernel in windows of this size so
+// streaming a large corpus doesn't grow the resident set
+#define RELEASE_WINDOW (64 << 20)
+
+static const unsigned char centerPositions[NUM_FACES] = {4, 10, 12, 14, 16, 22};
+
+static int checkQuaternionState(const CubieState *state);
+static void releaseConsumed(StateLoader *loader);
+static const char* parseInt(const char *p, const char *end, int *out);
+static const char* parseFloat(const char *p, const char *end, float *out);
+
+int loader_open(StateLoader *loader, const char *fileName) {
+	memset(loader, 0, sizeof(StateLoader));
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) {
+		log_error("Unable to open state file: %s", fileName);
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		log_error("Unable to stat state file: %s", fileName);
+		close(fd);
+		return 0;
+	}
+	loader->size = st.st_size;
+	if (loader->size > 0) {
+		void *data = mmap(NULL, loader->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			log_error("Unable to map state file: %s", fileName);
+			close(fd);
+			return 0;
+		}
+		loader->data = data;
+		posix_madvise(data, loader->size, POSIX_MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	loader->binary = codec_isBinary((const unsigned char *)loader->data, loader->size);
+	return 1;
+}
+
+void loader_close(StateLoader *loader) {
+	if (loader->data) {
+		munmap((void *)loader->data, loader->size);
+	}
+	memset(loader, 0, sizeof(StateLoader));
+}
+
+void loader_rewind(StateLoader *loader) {
+	loader->offset = 0;
+	loader->released = 0;
+	loader->line = 0;
+}
+
+// Returns 1 when a state was read, 0 at end of file and -1 on a malformed state
+int loader_next(StateLoader *loader, CubieState *state) {
+	releaseConsumed(loader);
+	if (loader->binary) {
+		size_t left = loader->size - loader->offset;
+		if (left < STATE_BINARY_SIZE) {
+			if (left > 0) {
+				log_error("Ignoring %zu trailing bytes, less than a binary state record", left);
+				loader->offset = loader->size;
+			}
+			return 0;
+		}
+		const unsigned char *record = (const unsigned char *)loader->data + loader->offset;
+		loader->offset += STATE_BINARY_SIZE;
+		return codec_decodeBinary(state, record) ? 1 : -1;
+	}
+
+	while (loader->offset < loader->size) {
+		const char *start = loader->data + loader->offset;
+		const char *newline = memchr(start, '\n', loader->size - loader->offset);
+		const char *end = newline ? newline : loader->data + loader->size;
+		loader->offset = end - loader->data + (newline != NULL);
+		loader->line++;
+
+		while (end > start && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+			end--;
+		}
+		if (end == start || *start == '#') {
+			continue;
+		}
+
+		size_t length = end - start;
+		if (memchr(start, ':', length)) {
+			if (loader_parseQuaternionState(state, start, length)) {
+				return 1;
+			}
+			log_error("Invalid quaternion state on line %i", loader->line);
+			return -1;
+		}
+		int error = facelet_decode(state, start, length);
+		if (error == FACELET_OK) {
+			return 1;
+		}
+		log_error("Invalid facelet state on line %i: %s", loader->line, facelet_errorString(error));
+		return -1;
+	}
+	return 0;
+}
+
+// Parses the rc_serializeState format in place: for each cube id in order,
+// "position:x:y:z:w;". The text need not be NUL terminated.
+// States no sequence of turns reaches are rejected like a binary record.
+int loader_parseQuaternionState(CubieState *state, const char *text, size_t length) {
+	const char *p = text;
+	const char *end = text + length;
+	unsigned int occupied = 0;
+	for (int id=0; id<NUM_CUBES; id++) {
+		int pos;
+		Quaternion quat;
+		p = parseInt(p, end, &pos);
+		if (p == NULL || p == end || *p++ != ':' || pos < 0 || pos >= NUM_CUBES) {
+			return 0;
+		}
+		float *components[4] = {&quat.x, &quat.y, &quat.z, &quat.w};
+		for (int i=0; i<4; i++) {
+			p = parseFloat(p, end, components[i]);
+			char separator = i < 3 ? ':' : ';';
+			if (p == NULL || p == end || *p++ != separator) {
+				return 0;
+			}
+		}
+		if (occupied & (1u << pos)) {
+			return 0;
+		}
+		occupied |= 1u << pos;
+		state->cubeAt[pos] = id;
+		state->orientation[pos] = cs_orientationFromQuat(&quat);
+	}
+	return checkQuaternionState(state);
+}
+
+// A dump carries each cube's position and rotation separately, so check
+// they agree before the same checks the binary codec makes: centers at
+// home (their twist is ignored), then twist, flip and parity
+static int checkQuaternionState(const CubieState *state) {
+	for (int pos=0; pos<NUM_CUBES; pos++) {
+		if (cs_orientationPosition(state->orientation[pos], state->cubeAt[pos]) != pos) {
+			log_error("Quaternion state rotation does not carry cube %i to position %i",
+				state->cubeAt[pos], pos);
+			return 0;
+		}
+	}
+	for (int i=0; i<NUM_FACES; i++) {
+		if (state->cubeAt[centerPositions[i]] != centerPositions[i]) {
+			log_error("%s", "Quaternion state has a center out of place");
+			return 0;
+		}
+	}
+	CubieCoords coords;
+	cs_toCoords(state, &coords);
+	int error = cs_checkCoords(&coords);
+	if (error != CS_COORDS_OK) {
+		log_error("Quaternion state is not solvable: %s", error == CS_COORDS_TWIST ? "corner twist"
+			: error == CS_COORDS_FLIP ? "edge flip" : "corner and edge parity");
+		return 0;
+	}
+	return 1;
+}
+
+static void releaseConsumed(StateLoader *loader) {
+	if (loader->offset - loader->released < 2*RELEASE_WINDOW) {
+		return;
+	}
+	long pageSize = sysconf(_SC_PAGESIZE);
+	size_t start = loader->released;
+	size_t length = (loader->offset - RELEASE_WINDOW - start) / pageSize * pageSize;
+	// posix_madvise ignores DONTNEED on glibc. madvise really drops the
+	// pages, which is safe on a read-only private file mapping: touching
+	// them again reads them back from the file.
+	madvise((void *)(loader->data + start), length, MADV_DONTNEED);
+	loader->released = start + length;
+}
+
+static const char* parseInt(const char *p, const char *end, int *out) {
+	int sign = 1;
+	if (p < end && *p == '-') {
+		sign = -1;
+		p++;
+	}
+	if (p == end || *p < '0' || *p > '9') {
+		return NULL;
+	}
+	int value = 0;
+	while (p < end && *p >= '0' && *p <= '9' && value < 100000) {
+		value = value*10 + (*p++ - '0');
+	}
+	*out = sign * value;
+	return p;
+}
+
+// Plain decimal notation only, which is all rc_serializeState produces
+static const char* parseFloat(const char *p, const char *end, float *out) {
+	float sign = 1;
+	if (p < end && (*p == '-' || *p == '+')) {
+		sign = *p == '-' ? -1 : 1;
+		p++;
+	}
+	int digits = 0;
+	double value = 0;
+	while (p < end && *p >= '0' && *p <= '9') {
+		value = value*10 + (*p++ - '0');
+		digits++;
+	}
+	if (p < end && *p == '.') {
+		p++;
+		double scale = 0.1;
+		while (p < end && *p >= '0' && *p <= '9') {
+			value += (*p++ - '0') * scale;
+			scale *= 0.1;
+			digits++;
+		}
+	}
+	if (!digits) {
+		return NULL;
+	}
+	*out = sign * value;
+	return p;
+}
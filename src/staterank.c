@@ -0,0 +1,180 @@
+#include "staterank.h"
+
+#define TWIST_COUNT 2187       // 3^7, the last twist is implied
+#define FLIP_COUNT 2048        // 2^11, the last flip is implied
+#define EDGE_PERM_COUNT 239500800ull // 12!/2, edge parity follows the corners
+#define FLIP_BITS 11
+
+// rank = ((cornerPerm * 3^7 + twist) * 12!/2 + edgePerm) * 2^11 + flip
+// The part above the flip bits stays below 2^55, so the whole rank is that
+// value shifted left by 11 with the flip in the low bits.
+
+static uint64_t lehmerRank(const unsigned char *perm, int size, int digits);
+static void lehmerUnrank(unsigned char *perm, int size, const int *digits);
+
+StateRank rank_fromState(const CubieState *state) {
+	CubieCoords coords;
+	cs_toCoords(state, &coords);
+	return rank_fromCoords(&coords);
+}
+
+int rank_toState(CubieState *state, StateRank rank) {
+	CubieCoords coords;
+	if (!rank_toCoords(&coords, rank)) {
+		return 0;
+	}
+	cs_fromCoords(state, &coords);
+	return 1;
+}
+
+StateRank rank_fromCoords(const CubieCoords *coords) {
+	uint64_t cornerPerm = lehmerRank(coords->cornerPerm, NUM_CORNERS, NUM_CORNERS);
+	uint64_t twist = 0;
+	for (int i=0; i<NUM_CORNERS-1; i++) {
+		twist = twist*3 + coords->cornerTwist[i];
+	}
+
+	// Only the first ten edge Lehmer digits are stored: the eleventh is
+	// fixed by parity and the twelfth is always zero
+	uint64_t edgePerm = lehmerRank(coords->edgePerm, NUM_EDGES, NUM_EDGES-2);
+	uint64_t flip = 0;
+	for (int i=0; i<NUM_EDGES-1; i++) {
+		flip = (flip << 1) | coords->edgeFlip[i];
+	}
+
+	uint64_t upper = (cornerPerm*TWIST_COUNT + twist)*EDGE_PERM_COUNT + edgePerm;
+	StateRank rank = {upper >> (64 - FLIP_BITS), (upper << FLIP_BITS) | flip};
+	return rank;
+}
+
+int rank_toCoords(CubieCoords *coords, StateRank rank) {
+	if (!rank_isValid(rank)) {
+		return 0;
+	}
+	uint64_t flip = rank.low & (FLIP_COUNT - 1);
+	uint64_t upper = (rank.high << (64 - FLIP_BITS)) | (rank.low >> FLIP_BITS);
+	uint64_t edgePerm = upper % EDGE_PERM_COUNT;
+	upper /= EDGE_PERM_COUNT;
+	uint64_t twist = upper % TWIST_COUNT;
+	uint64_t cornerPerm = upper / TWIST_COUNT;
+
+	int flipSum = 0;
+	for (int i=NUM_EDGES-2; i>=0; i--) {
+		coords->edgeFlip[i] = flip & 1;
+		flipSum += flip & 1;
+		flip >>= 1;
+	}
+	coords->edgeFlip[NUM_EDGES-1] = flipSum & 1;
+
+	int twistSum = 0;
+	for (int i=NUM_CORNERS-2; i>=0; i--) {
+		coords->cornerTwist[i] = twist % 3;
+		twistSum += twist % 3;
+		twist /= 3;
+	}
+	coords->cornerTwist[NUM_CORNERS-1] = (3 - twistSum % 3) % 3;
+
+	int digits[NUM_EDGES];
+	int parity = 0;
+	for (int i=NUM_CORNERS-1; i>=0; i--) {
+		digits[i] = cornerPerm % (NUM_CORNERS - i);
+		parity += digits[i];
+		cornerPerm /= NUM_CORNERS - i;
+	}
+	lehmerUnrank(coords->cornerPerm, NUM_CORNERS, digits);
+
+	int edgeParity = 0;
+	digits[NUM_EDGES-1] = 0;
+	for (int i=NUM_EDGES-3; i>=0; i--) {
+		digits[i] = edgePerm % (NUM_EDGES - i);
+		edgeParity += digits[i];
+		edgePerm /= NUM_EDGES - i;
+	}
+	digits[NUM_EDGES-2] = (parity + edgeParity) & 1;
+	lehmerUnrank(coords->edgePerm, NUM_EDGES, digits);
+	return 1;
+}
+
+int rank_compare(StateRank a, StateRank b) {
+	if (a.high != b.high) {
+		return a.high < b.high ? -1 : 1;
+	}
+	if (a.low != b.low) {
+		return a.low < b.low ? -1 : 1;
+	}
+	return 0;
+}
+
+int rank_isValid(StateRank rank) {
+	return rank.high < RANK_COUNT_HIGH
+		|| (rank.high == RANK_COUNT_HIGH && rank.low < RANK_COUNT_LOW);
+}
+
+// Decimal digits by long division of the 66 bit value in 32 bit limbs
+void rank_toString(StateRank rank, char *out) {
+	uint32_t limbs[3] = {(uint32_t)rank.high, (uint32_t)(rank.low >> 32), (uint32_t)rank.low};
+	char digits[RANK_STRING_SIZE];
+	int count = 0;
+	do {
+		uint64_t remainder = 0;
+		for (int i=0; i<3; i++) {
+			uint64_t value = (remainder << 32) | limbs[i];
+			limbs[i] = value / 10;
+			remainder = value % 10;
+		}
+		digits[count++] = '0' + remainder;
+	} while (limbs[0] || limbs[1] || limbs[2]);
+	for (int i=0; i<count; i++) {
+		out[i] = digits[count - 1 - i];
+	}
+	out[count] = '\0';
+}
+
+int rank_fromString(StateRank *rank, const char *text, int length) {
+	if (length <= 0 || length >= RANK_STRING_SIZE) {
+		return 0;
+	}
+	uint64_t high = 0, low = 0;
+	for (int i=0; i<length; i++) {
+		if (text[i] < '0' || text[i] > '9') {
+			return 0;
+		}
+		// value = value*10 + digit over the two words
+		uint64_t lowHigh = low >> 32;
+		uint64_t lowLow = low & 0xFFFFFFFFull;
+		lowLow = lowLow*10 + (text[i] - '0');
+		lowHigh = lowHigh*10 + (lowLow >> 32);
+		high = high*10 + (lowHigh >> 32);
+		low = (lowHigh << 32) | (lowLow & 0xFFFFFFFFull);
+	}
+	rank->high = high;
+	rank->low = low;
+	return rank_isValid(*rank);
+}
+
+// Mixed radix value of the first digits of the Lehmer code of perm
+static uint64_t lehmerRank(const unsigned char *perm, int size, int digits) {
+	uint64_t rank = 0;
+	for (int i=0; i<digits; i++) {
+		int digit = 0;
+		for (int j=i+1; j<size; j++) {
+			digit += perm[j] < perm[i];
+		}
+		rank = rank*(size - i) + digit;
+	}
+	return rank;
+}
+
+static void lehmerUnrank(unsigned char *perm, int size, const int *digits) {
+	unsigned char remaining[NUM_EDGES];
+	for (int i=0; i<size; i++) {
+		remaining[i] = i;
+	}
+	for (int i=0; i<size; i++) {
+		int d = digits[i];
+		perm[i] = remaining[d];
+		for (int j=d; j<size-i-1; j++) {
+			remaining[j] = remaining[j+1];
+		}
+	}
+}
@@ -1,46 +1,100 @@
+#include <string.h>
+
 #include "stepqueue.h"
+#include "logger.h"
+
+#define QUEUE_INITIAL_CAPACITY 64
+
+static void reserve(StepQueue *queue, int count);
 
 void initQueue(StepQueue *queue) {
-	queue->first = NULL;
+	queue->items = NULL;
+	queue->capacity = 0;
+	queue->head = 0;
 	queue->size = 0;
 }
 
-void enqueue(StepQueue *queue, Step item) {
-	Step *new_node = malloc(sizeof(Step));
+void freeQueue(StepQueue *queue) {
+	free(queue->items);
+	initQueue(queue);
+}
 
-	*new_node = item;
-	new_node->next = NULL;
+void clearQueue(StepQueue *queue) {
+	queue->head = 0;
+	queue->size = 0;
+}
 
-	Step *head = queue->first;
-	if (head == NULL) {
-		queue->first = new_node;
+// Make room for count more items, unwrapping the ring into the new buffer
+static void reserve(StepQueue *queue, int count) {
+	int needed = queue->size + count;
+	if (needed <= queue->capacity) {
+		return;
+	}
+	int capacity = queue->capacity ? queue->capacity : QUEUE_INITIAL_CAPACITY;
+	while (capacity < needed) {
+		capacity *= 2;
+	}
+	Step *items = malloc(capacity * sizeof(Step));
+	if (items == NULL) {
+		log_fatal("Unable to grow step queue to %i items", capacity);
+		exit(1);
+	}
+	int tail = queue->capacity - queue->head;
+	if (queue->size <= tail) {
+		memcpy(items, queue->items + queue->head, queue->size * sizeof(Step));
 	} else {
-		while (head->next) {
-			head = head->next;
-		}
-		head->next = new_node;
+		memcpy(items, queue->items + queue->head, tail * sizeof(Step));
+		memcpy(items + tail, queue->items, (queue->size - tail) * sizeof(Step));
 	}
+	free(queue->items);
+	queue->items = items;
+	queue->capacity = capacity;
+	queue->head = 0;
+}
+
+void enqueue(StepQueue *queue, Step item) {
+	reserve(queue, 1);
+	queue->items[(queue->head + queue->size) & (queue->capacity - 1)] = item;
 	queue->size++;
 }
 
 void enqueueMultiple(StepQueue *queue, Step item, int count) {
+	if (count <= 0) {
+		return;
+	}
+	reserve(queue, count);
+	int mask = queue->capacity - 1;
 	for (int i=0; i<count; i++) {
-		enqueue(queue, item);
+		queue->items[(queue->head + queue->size + i) & mask] = item;
+	}
+	queue->size += count;
+}
+
+void enqueueSequence(StepQueue *queue, const Step *items, int count) {
+	if (count <= 0) {
+		return;
+	}
+	reserve(queue, count);
+	int start = (queue->head + queue->size) & (queue->capacity - 1);
+	int first = queue->capacity - start;
+	if (count <= first) {
+		memcpy(queue->items + start, items, count * sizeof(Step));
+	} else {
+		memcpy(queue->items + start, items, first * sizeof(Step));
+		memcpy(queue->items, items + first, (count - first) * sizeof(Step));
 	}
+	queue->size += count;
 }
 
 Step dequeue(StepQueue *queue) {
-	Step *tmp = queue->first;
-	// TODO what to do if empty?
 	Step ret;
-	if( tmp == NULL) {
+	if (queue->size == 0) {
 		ret.face = -1;
 		ret.direction = 0;
 		return ret;
 	}
-	queue->first = tmp->next;
-	ret = *tmp;
-	free(tmp);
+	ret = queue->items[queue->head];
+	queue->head = (queue->head + 1) & (queue->capacity - 1);
 	queue->size--;
 	return ret;
 }
@@ -0,0 +1,10 @@
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+
+#include "timer.h"
+
+double timer_now() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
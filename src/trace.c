@@ -0,0 +1,230 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+#include "timer.h"
+#include "logger.h"
+
+#define BUFFER_EVENTS 4096
+#define MAX_THREADS 64
+#define PROCESS_ID 1
+
+typedef struct {
+	const char *name;
+	const char *category;
+	double time; // seconds on the timer clock
+	double duration; // complete events only
+	char phase;
+} TraceEvent;
+
+// A thread's buffer goes back to the pool when the thread exits, so short
+// lived workers reuse ids and MAX_THREADS only limits concurrent threads.
+// Its lock is only contended while another thread flushes it. Where both
+// are held, the file lock is taken first.
+typedef struct {
+	pthread_mutex_t lock;
+	int id;
+	int count;
+	int inUse;
+	TraceEvent events[BUFFER_EVENTS];
+} ThreadBuffer;
+
+int trace_enabled = 0;
+
+static FILE *traceFile = NULL;
+static double origin;
+static int eventsWritten;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadBuffer *buffers[MAX_THREADS];
+static int bufferCount = 0;
+static pthread_key_t bufferKey;
+static pthread_once_t keyOnce = PTHREAD_ONCE_INIT;
+static int exitHandler = 0;
+
+static void createKey();
+static void releaseBuffer(void *buffer);
+static ThreadBuffer *getBuffer();
+static void record(char phase, const char *name, const char *category, double time, double duration);
+static void flush(ThreadBuffer *buffer);
+static void discardAll();
+
+int trace_init() {
+	const char *fileName = getenv("RUBIKS_TRACE");
+	if (fileName == NULL || *fileName == '\0') {
+		return 1;
+	}
+	return trace_open(fileName);
+}
+
+int trace_open(const char *fileName) {
+	if (__atomic_load_n(&trace_enabled, __ATOMIC_ACQUIRE)) {
+		trace_close();
+	}
+	FILE *file = fopen(fileName, "w");
+	if (file == NULL) {
+		log_error("Unable to open trace file: %s", fileName);
+		return 0;
+	}
+	pthread_mutex_lock(&lock);
+	// Drop anything recorded while the last trace was closing
+	discardAll();
+	traceFile = file;
+	fprintf(traceFile, "{\"traceEvents\":[\n");
+	eventsWritten = 0;
+	origin = timer_now();
+	pthread_mutex_unlock(&lock);
+	if (!exitHandler) {
+		atexit(trace_close);
+		exitHandler = 1;
+	}
+	__atomic_store_n(&trace_enabled, 1, __ATOMIC_RELEASE);
+	trace_nameThread("main");
+	return 1;
+}
+
+// Write out every thread's events and finish the file. Other threads may
+// still be recording, as when this runs from atexit: each buffer is flushed
+// under its lock, and their later events are dropped.
+void trace_close() {
+	if (!__atomic_load_n(&trace_enabled, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+	__atomic_store_n(&trace_enabled, 0, __ATOMIC_RELEASE);
+	pthread_mutex_lock(&lock);
+	for (int i=0; i<bufferCount; i++) {
+		pthread_mutex_lock(&buffers[i]->lock);
+		flush(buffers[i]);
+		pthread_mutex_unlock(&buffers[i]->lock);
+	}
+	fprintf(traceFile, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	if (fclose(traceFile) != 0) {
+		log_error("%s", "Unable to finish trace file");
+	}
+	traceFile = NULL;
+	pthread_mutex_unlock(&lock);
+}
+
+// Shown as the thread's track name
+void trace_nameThread(const char *name) {
+	if (__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)) {
+		record('M', name, NULL, 0, 0);
+	}
+}
+
+void trace_event(char phase, const char *name, const char *category) {
+	record(phase, name, category, timer_now(), 0);
+}
+
+// One event for a span timed by the caller
+void trace_complete(const char *name, const char *category, double start, double end) {
+	if (__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)) {
+		record('X', name, category, start, end - start);
+	}
+}
+
+static void createKey() {
+	pthread_key_create(&bufferKey, releaseBuffer);
+}
+
+// Runs as a thread exits
+static void releaseBuffer(void *arg) {
+	ThreadBuffer *buffer = arg;
+	pthread_mutex_lock(&lock);
+	pthread_mutex_lock(&buffer->lock);
+	if (traceFile != NULL) {
+		flush(buffer);
+	}
+	buffer->count = 0;
+	buffer->inUse = 0;
+	pthread_mutex_unlock(&buffer->lock);
+	pthread_mutex_unlock(&lock);
+}
+
+// Buffers are kept for the life of the process. Threads beyond
+// MAX_THREADS running at once go untraced.
+static ThreadBuffer *getBuffer() {
+	pthread_once(&keyOnce, createKey);
+	ThreadBuffer *buffer = pthread_getspecific(bufferKey);
+	if (buffer != NULL) {
+		return buffer;
+	}
+	pthread_mutex_lock(&lock);
+	for (int i=0; i<bufferCount && buffer == NULL; i++) {
+		if (!buffers[i]->inUse) {
+			buffer = buffers[i];
+		}
+	}
+	if (buffer == NULL && bufferCount < MAX_THREADS) {
+		buffer = malloc(sizeof(ThreadBuffer));
+		if (buffer != NULL) {
+			pthread_mutex_init(&buffer->lock, NULL);
+			buffer->id = bufferCount + 1;
+			buffer->count = 0;
+			buffers[bufferCount++] = buffer;
+		}
+	}
+	if (buffer != NULL) {
+		buffer->inUse = 1;
+		pthread_setspecific(bufferKey, buffer);
+	}
+	pthread_mutex_unlock(&lock);
+	return buffer;
+}
+
+static void record(char phase, const char *name, const char *category, double time, double duration) {
+	ThreadBuffer *buffer = getBuffer();
+	if (buffer == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&buffer->lock);
+	if (buffer->count == BUFFER_EVENTS) {
+		pthread_mutex_unlock(&buffer->lock);
+		pthread_mutex_lock(&lock);
+		pthread_mutex_lock(&buffer->lock);
+		if (traceFile != NULL) {
+			flush(buffer);
+		}
+		buffer->count = 0;
+		pthread_mutex_unlock(&lock);
+	}
+	TraceEvent *event = &buffer->events[buffer->count++];
+	event->name = name;
+	event->category = category;
+	event->time = time;
+	event->duration = duration;
+	event->phase = phase;
+	pthread_mutex_unlock(&buffer->lock);
+}
+
+// Called with both locks and a trace file open. Timestamps are microseconds
+// since trace_open.
+static void flush(ThreadBuffer *buffer) {
+	for (int i=0; i<buffer->count; i++) {
+		TraceEvent *event = &buffer->events[i];
+		fprintf(traceFile, "%s", eventsWritten++ > 0 ? ",\n" : "");
+		if (event->phase == 'M') {
+			fprintf(traceFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%i,\"tid\":%i,\"args\":{\"name\":\"%s\"}}",
+				PROCESS_ID, buffer->id, event->name);
+			continue;
+		}
+		fprintf(traceFile, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,", event->name,
+			event->category, event->phase, (event->time - origin) * 1e6);
+		if (event->phase == 'X') {
+			fprintf(traceFile, "\"dur\":%.3f,", event->duration * 1e6);
+		}
+		fprintf(traceFile, "\"pid\":%i,\"tid\":%i}", PROCESS_ID, buffer->id);
+	}
+	buffer->count = 0;
+}
+
+// Called with the file lock
+static void discardAll() {
+	for (int i=0; i<bufferCount; i++) {
+		pthread_mutex_lock(&buffers[i]->lock);
+		buffers[i]->count = 0;
+		pthread_mutex_unlock(&buffers[i]->lock);
+	}
+}
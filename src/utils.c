@@ -41,3 +41,14 @@ int nearlyEqualF(float a, float b) {
 		return diff / fminf((absA + absB), FLT_MAX) < FLT_EPSILON;
 	}
 }
+
+int compareDoubles(const void *a, const void *b) {
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+double percentile(const double *sorted, int count, double p) {
+	int rank = (int)ceil(p * count);
+	return sorted[rank > 0 ? rank-1 : 0];
+}
@@ -0,0 +1,34 @@
+#include "view/bigcubemesh.h"
+#include "view/constants.h"
+
+// Quad corners in sticker units from its center, along right and up
+static const int corners[4][2] = {{-1, 1}, {1, 1}, {1, -1}, {-1, -1}};
+
+void bc_buildMesh(BigCube *cube, float *positions, float *colors) {
+	int size = cube->size;
+	float unit = 1.5 * cubeWidth / size; // half a sticker
+	for (int face=0; face<NUM_FACES; face++) {
+		Vec3f normal = faceData[face].normal;
+		Vec3f up = faceData[faceData[face].neighbors[ABOVE]].normal;
+		Vec3f right = faceData[faceData[face].neighbors[RIGHT]].normal;
+		for (int row=0; row<size; row++) {
+			for (int col=0; col<size; col++) {
+				RGB3f rgb = faceData[bc_getSticker(cube, face, row, col)].rgb;
+				float u = size - 1 - 2*row;
+				float r = 2*col - (size - 1);
+				for (int v=0; v<4; v++) {
+					float cu = u + corners[v][1];
+					float cr = r + corners[v][0];
+					positions[0] = (size*normal.x + cu*up.x + cr*right.x) * unit;
+					positions[1] = (size*normal.y + cu*up.y + cr*right.y) * unit;
+					positions[2] = (size*normal.z + cu*up.z + cr*right.z) * unit;
+					colors[0] = rgb.red;
+					colors[1] = rgb.green;
+					colors[2] = rgb.blue;
+					positions += 3;
+					colors += 3;
+				}
+			}
+		}
+	}
+}
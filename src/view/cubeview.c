@@ -1,67 +1,55 @@
 #include "view/cubeview.h"
-#include "view/constants.h"
-#ifdef __APPLE__
-#define GL_SILENCE_DEPRECATION
-#include <OpenGl/gl.h>
-#else
-#include <GL/gl.h>
-#endif
 
-static GLfloat vertices[] =
-{
-	-0.5, -0.5, -0.5,		-0.5, -0.5, 0.5,		-0.5, 0.5, 0.5,		-0.5, 0.5, -0.5, // left
-	0.5, -0.5, -0.5,		0.5, -0.5,  0.5,		0.5,  0.5, 0.5,		0.5,  0.5, -0.5, // right
-	-0.5, -0.5, -0.5,		-0.5, -0.5,  0.5,		0.5, -0.5, 0.5,		0.5, -0.5, -0.5, // bottom
-	-0.5,  0.5, -0.5,		-0.5,  0.5,  0.5,		0.5, 0.5, 0.5,		0.5,  0.5, -0.5, // top
-	-0.5, -0.5, -0.5,		-0.5,  0.5, -0.5,		0.5, 0.5, -0.5,		0.5, -0.5, -0.5, // front
-	-0.5, -0.5,  0.5,		-0.5,  0.5,  0.5,		0.5, 0.5, 0.5,		0.5, -0.5,  0.5  // back
+// Unit cube corners of each quad (left, right, bottom, top, front, back),
+// numbered x<<2 | y<<1 | z with 1 for the +0.5 side
+static const unsigned char vertexCorners[CUBE_VERTEX_COUNT] = {
+	0, 1, 3, 2,	4, 5, 7, 6,	0, 1, 5, 4,	2, 3, 7, 6,	0, 2, 6, 4,	1, 3, 7, 5
 };
 
-static void cube_drawNormalized(const Cube cube, int useColor);
-
-static const float scale = 0.95;
-static const float lineWidth = 5.0; // this should be proportional to cube size
-void cube_draw(Cube cube, Vec3f coords, RGB3f lineColor, double cubeWidth) {
-	glPushMatrix();
-
-	glTranslatef(coords.x, coords.y, coords.z);
-	glScalef(cubeWidth*scale, cubeWidth*scale, cubeWidth*scale);
-	glMultMatrixf(quat_toMatrix(&cube.quat));
-
-	// Draw outline
-	glEnable(GL_POLYGON_OFFSET_LINE);
-	glPolygonOffset(0,-1);
-	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	glLineWidth((GLfloat)lineWidth);
-	glColor3f(lineColor.red, lineColor.green, lineColor.blue); // line color
-	cube_drawNormalized(cube, 0);
-	glDisable(GL_POLYGON_OFFSET_LINE);
-
-	// Draw solid polygons
-	glEnable(GL_POLYGON_OFFSET_FILL);
-	glPolygonOffset(1,1); // just guessing on these values
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	cube_drawNormalized(cube, 1);
-	glDisable(GL_POLYGON_OFFSET_FILL);
-
-	glPopMatrix();
+void cube_writeVertices(const float rotation[16], const float transform[16], float *positions) {
+	// Fold the cube's own rotation into the placement, as glMultMatrixf would
+	float m[12];
+	for (int col=0; col<3; col++) {
+		for (int row=0; row<3; row++) {
+			m[col*3 + row] = transform[row]*rotation[col*4]
+				+ transform[4 + row]*rotation[col*4 + 1]
+				+ transform[8 + row]*rotation[col*4 + 2];
+		}
+	}
+	m[9] = transform[12];
+	m[10] = transform[13];
+	m[11] = transform[14];
+
+	// Only the 8 corners need transforming, the quads share them
+	float corners[8][3];
+	for (int c=0; c<8; c++) {
+		float x = c & 4 ? 0.5 : -0.5;
+		float y = c & 2 ? 0.5 : -0.5;
+		float z = c & 1 ? 0.5 : -0.5;
+		corners[c][0] = m[0]*x + m[3]*y + m[6]*z + m[9];
+		corners[c][1] = m[1]*x + m[4]*y + m[7]*z + m[10];
+		corners[c][2] = m[2]*x + m[5]*y + m[8]*z + m[11];
+	}
+	for (int v=0; v<CUBE_VERTEX_COUNT; v++) {
+		const float *corner = corners[vertexCorners[v]];
+		positions[v*3] = corner[0];
+		positions[v*3 + 1] = corner[1];
+		positions[v*3 + 2] = corner[2];
+	}
 }
 
-static void cube_drawNormalized(const Cube cube, int useColor) {
-	glEnableClientState(GL_VERTEX_ARRAY);
-	if (useColor)
-		glEnableClientState(GL_COLOR_ARRAY);
-
-	glVertexPointer(3, GL_FLOAT, 0, vertices);
-
-	if (useColor) {
-		float *colors = cube_getColorArray(cube);
-		glColorPointer(3, GL_FLOAT, 0, colors);
+void cube_writeColors(const Cube *cube, RGB3f lineColor, float *fillColors, float *lineColors) {
+	for (int i=0; i<NUM_FACES; i++) {
+		RGB3f color = cube->faces[i].color;
+		for (int v=0; v<4; v++) {
+			float *fill = fillColors + (i*4 + v)*3;
+			float *line = lineColors + (i*4 + v)*3;
+			fill[0] = color.red;
+			fill[1] = color.green;
+			fill[2] = color.blue;
+			line[0] = lineColor.red;
+			line[1] = lineColor.green;
+			line[2] = lineColor.blue;
+		}
 	}
-
-	glDrawArrays(GL_QUADS, 0, 24);
-
-	glDisableClientState(GL_VERTEX_ARRAY);
-	if (useColor)
-		glDisableClientState(GL_COLOR_ARRAY);
 }
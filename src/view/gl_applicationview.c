@@ -1,32 +1,57 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <time.h>
 #ifdef __APPLE__
 #define GL_SILENCE_DEPRECATION
 #endif
 #include <GLFW/glfw3.h>
 
 #include "rubiks.h"
+#include "view/gl_applicationview.h"
 #include "view/rubiksview.h"
+#include "view/wallview.h"
+#include "view/profilerview.h"
 #include "controller/rubikscontroller.h"
 #include "controller/solvercontroller.h"
 #include "cube.h"
+#include "cubiestate.h"
+#include "facelet.h"
+#include "stateloader.h"
+#include "wall.h"
 #include "view/cubeview.h"
+#include "view/constants.h"
 #include "vector.h"
+#include "timer.h"
+#include "profiler.h"
 #include "logger.h"
 
-#define ROTATION_SPEED_DEFAULT 18
-#define ROTATION_SPEED_MAX 25
+// Face turn speeds in quarter turns per second
+#define ROTATION_SPEED_DEFAULT 12
+#define ROTATION_SPEED_MAX 16
 #define ROTATION_SPEED_MIN 0.1
 #define ROTATION_SPEED_INCREMENT 1
 
+#define WALL_DEFAULT_COLUMNS 10
+#define WALL_DEFAULT_ROWS 10
+
 int animationsOn = 1;
 
+// The cube on screen with its own animation and solver, handed to every
+// function that touches it
+typedef struct {
+	Rubiks rubiks;
+	FaceAnimation animation;
+	Solver solver;
+	Random random; // shuffles
+} AppCube;
+
 // OpenGL/GLFW functions
 void keyboardHandler(GLFWwindow* window, int key, int scancode, int action, int mods);
-void display();
+void display(AppCube *cube);
 
 // Control functions
+int loadNextState(AppCube *cube);
 void resetCameraRotation();
 void printHelpText();
 void increaseRotationSpeed();
@@ -35,23 +60,32 @@ void resetRotationSpeed();
 void rc_toggleAnimations();
 void toggleDemoMode();
 void toggleAutorotate();
+void toggleWallMode();
+void toggleProfilerOverlay();
+void beginKeyMove(AppCube *cube, int move, int action, int mods);
 
 // Drawing functions
 void drawAxisLines();
 
 // Debug functions
-void resetDebugInfo();
+void resetDebugInfo(Rubiks *rubiks);
 
 Vec2d rotate = {-30, 30};
 
 GLFWwindow *window;
 
-Rubiks rubiksCube;
+AppCube appCube;
+Wall wall;
+int wallMode = 0;
+StateLoader stateLoader;
+int stateFileOpen = 0;
 int solverEnabled = 0;
 int debug = 0;
 int demoMode = 0;
 int autorotate = 0;
+int profilerOverlay = 0;
 double rotationSpeed = ROTATION_SPEED_DEFAULT;
+double lastFrameTime = 0;
 
 void rc_toggleAnimations() {
 	animationsOn = !animationsOn;
@@ -68,7 +102,21 @@ void toggleAutorotate() {
 	log_info("Autorotate %s", autorotate ? "ON" : "OFF");
 }
 
-void display(){
+void toggleWallMode() {
+	if (wall.cubes == NULL) {
+		glapp_showWall(WALL_DEFAULT_COLUMNS, WALL_DEFAULT_ROWS);
+	} else {
+		wallMode = !wallMode;
+	}
+	log_info("Wall mode %s", wallMode ? "ON" : "OFF");
+}
+
+void toggleProfilerOverlay() {
+	profilerOverlay = !profilerOverlay;
+	log_info("Profiler overlay %s", profilerOverlay ? "ON" : "OFF");
+}
+
+void display(AppCube *cube){
 
 	//  Clear screen and Z-buffer
 	glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
@@ -80,8 +128,23 @@ void display(){
 	glRotatef( rotate.x, 1.0, 0.0, 0.0 );
 	glRotatef( rotate.y, 0.0, 1.0, 0.0 );
 
-	rc_updateFaceRotations(&rubiksCube, rotationSpeed);
-	rc_draw(&rubiksCube);
+	double now = timer_now();
+	double start = prof_begin();
+	if (wallMode) {
+		prof_addMoves(wall_update(&wall, rotationSpeed, now - lastFrameTime));
+	} else {
+		rc_updateAnimation(&cube->animation, &cube->rubiks, rotationSpeed, now - lastFrameTime);
+	}
+	prof_end(PROF_UPDATE, start);
+	lastFrameTime = now;
+
+	start = prof_begin();
+	if (wallMode) {
+		wall_draw(&wall, rotate);
+	} else {
+		rc_draw(&cube->rubiks, &cube->animation);
+	}
+	prof_end(PROF_DRAW, start);
 	if (debug) {
 		drawAxisLines();
 	}
@@ -95,12 +158,12 @@ void resetRotationSpeed() {
 
 void increaseRotationSpeed() {
 	rotationSpeed = mind(rotationSpeed + ROTATION_SPEED_INCREMENT, ROTATION_SPEED_MAX);
-	printf("Increasing rotation speed: %f\n", rotationSpeed);
+	printf("Increasing rotation speed: %f turns/s\n", rotationSpeed);
 }
 
 void decreaseRotationSpeed() {
 	rotationSpeed = maxd(rotationSpeed - ROTATION_SPEED_INCREMENT, ROTATION_SPEED_MIN);
-	printf("Decreasing rotation speed: %f\n", rotationSpeed);
+	printf("Decreasing rotation speed: %f turns/s\n", rotationSpeed);
 }
 
 void drawAxisLines() {
@@ -120,28 +183,36 @@ void drawAxisLines() {
 	glEnd();
 }
 
-void resetDebugInfo() {
+void resetDebugInfo(Rubiks *rubiks) {
 	for (int i=0; i<NUM_CUBES; i++) {
-		Cube* cube = &rubiksCube.cubes[i];
+		Cube* cube = &rubiks->cubes[i];
 		log_info("Cube #%i at position: %i, quaternion: {%f, %f, %f, %f}",
 			i, cube->position, cube->quat.x, cube->quat.y, cube->quat.z, cube->quat.w);
 	}
 	for (int i=0; i<NUM_FACES; i++) {
 		char faceStr[FACE_SIZE+1];
 		faceStr[FACE_SIZE] = '\0';
-		rc_getFaceColors(&rubiksCube, i, faceStr);
+		rc_getFaceColors(rubiks, i, faceStr);
 		printf("FACE: %c: %s\n", faceData[i].name, faceStr);
 	}
 	char rubiksStr[FACE_SIZE*NUM_FACES+1];
 	rubiksStr[FACE_SIZE*NUM_FACES] = '\0';
-	rc_serialize(&rubiksCube, rubiksStr);
+	rc_serialize(rubiks, rubiksStr);
 	printf("RUBIKS: %s\n", rubiksStr);
+
+	CubieState state;
+	char facelets[FACELET_COUNT+1];
+	facelets[FACELET_COUNT] = '\0';
+	cs_fromRubiks(&state, rubiks);
+	facelet_encode(&state, facelets);
+	printf("FACELETS: %s\n", facelets);
 }
 
 void keyboardHandler(GLFWwindow* window, int key, int scancode, int action, int mods) {
 	if (action != GLFW_PRESS && action != GLFW_REPEAT) {
 		return;
 	}
+	AppCube *cube = glfwGetWindowUserPointer(window);
 
 	log_debug("Key pressed: %i", key);
 	switch (key)
@@ -154,16 +225,29 @@ void keyboardHandler(GLFWwindow* window, int key, int scancode, int action, int
 			solverEnabled = !solverEnabled;
 			break;
 		case GLFW_KEY_S:
-			rc_shuffle(&rubiksCube, 20);
+			rc_randomize(&cube->rubiks, &cube->random);
+			solver_cancel(&cube->solver);
 			break;
 		case GLFW_KEY_I:
-			rc_reset(&rubiksCube);
+			rc_reset(&cube->rubiks);
+			solver_cancel(&cube->solver);
 			break;
 		case GLFW_KEY_H:
 			printHelpText();
 			break;
 		case GLFW_KEY_P:
-			resetDebugInfo();
+			resetDebugInfo(&cube->rubiks);
+			break;
+		case GLFW_KEY_W:
+			toggleWallMode();
+			break;
+		case GLFW_KEY_O:
+			toggleProfilerOverlay();
+			break;
+		case GLFW_KEY_N:
+			if (stateFileOpen) {
+				loadNextState(cube);
+			}
 			break;
 		case GLFW_KEY_C:
 			if (mods==0) {
@@ -206,67 +290,72 @@ void keyboardHandler(GLFWwindow* window, int key, int scancode, int action, int
 			break;
 		case GLFW_KEY_1:
 		case GLFW_KEY_L:
-			if (action == GLFW_PRESS) {
-				if (mods==0) {
-					rc_beginFaceRotation(&rubiksCube, LEFT_FACE, CLOCKWISE, !animationsOn);
-				} else if (mods == GLFW_MOD_SHIFT) {
-					rc_beginFaceRotation(&rubiksCube, LEFT_FACE, COUNTERCLOCKWISE, !animationsOn);
-				}
-			}
+			beginKeyMove(cube, LEFT_FACE, action, mods);
 			break;
 		case GLFW_KEY_2:
 		case GLFW_KEY_R:
-			if (action == GLFW_PRESS) {
-				if (mods==0) {
-					rc_beginFaceRotation(&rubiksCube, RIGHT_FACE, CLOCKWISE, !animationsOn);
-				} else if (mods == GLFW_MOD_SHIFT) {
-					rc_beginFaceRotation(&rubiksCube, RIGHT_FACE, COUNTERCLOCKWISE, !animationsOn);
-				}
-			}
+			beginKeyMove(cube, RIGHT_FACE, action, mods);
 			break;
 		case GLFW_KEY_3:
 		case GLFW_KEY_D:
-			if (action == GLFW_PRESS) {
-				if (mods==0) {
-					rc_beginFaceRotation(&rubiksCube, DOWN_FACE, CLOCKWISE, !animationsOn);
-				} else if (mods == GLFW_MOD_SHIFT) {
-					rc_beginFaceRotation(&rubiksCube, DOWN_FACE, COUNTERCLOCKWISE, !animationsOn);
-				}
-			}
+			beginKeyMove(cube, DOWN_FACE, action, mods);
 			break;
 		case GLFW_KEY_4:
 		case GLFW_KEY_U:
-			if (action == GLFW_PRESS) {
-				if (mods==0) {
-					rc_beginFaceRotation(&rubiksCube, UP_FACE, CLOCKWISE, !animationsOn);
-				} else if (mods == GLFW_MOD_SHIFT) {
-					rc_beginFaceRotation(&rubiksCube, UP_FACE, COUNTERCLOCKWISE, !animationsOn);
-				}
-			}
+			beginKeyMove(cube, UP_FACE, action, mods);
 			break;
 		case GLFW_KEY_5:
 		case GLFW_KEY_F:
-			if (action == GLFW_PRESS) {
-				if (mods==0) {
-					rc_beginFaceRotation(&rubiksCube, FRONT_FACE, CLOCKWISE, !animationsOn);
-				} else if (mods == GLFW_MOD_SHIFT) {
-					rc_beginFaceRotation(&rubiksCube, FRONT_FACE, COUNTERCLOCKWISE, !animationsOn);
-				}
-			}
+			beginKeyMove(cube, FRONT_FACE, action, mods);
 			break;
 		case GLFW_KEY_6:
 		case GLFW_KEY_B:
-			if (action == GLFW_PRESS) {
-				if (mods==0) {
-					rc_beginFaceRotation(&rubiksCube, BACK_FACE, CLOCKWISE, !animationsOn);
-				} else if (mods == GLFW_MOD_SHIFT) {
-					rc_beginFaceRotation(&rubiksCube, BACK_FACE, COUNTERCLOCKWISE, !animationsOn);
-				}
-			}
+			beginKeyMove(cube, BACK_FACE, action, mods);
+			break;
+		case GLFW_KEY_7:
+		case GLFW_KEY_M:
+			beginKeyMove(cube, SLICE_M, action, mods);
+			break;
+		case GLFW_KEY_8:
+		case GLFW_KEY_E:
+			beginKeyMove(cube, SLICE_E, action, mods);
+			break;
+		case GLFW_KEY_9:
+			beginKeyMove(cube, SLICE_S, action, mods);
+			break;
+		case GLFW_KEY_X:
+			beginKeyMove(cube, ROTATE_X, action, mods);
+			break;
+		case GLFW_KEY_Y:
+			beginKeyMove(cube, ROTATE_Y, action, mods);
+			break;
+		case GLFW_KEY_Z:
+			beginKeyMove(cube, ROTATE_Z, action, mods);
 			break;
 	}
 }
 
+// Key turns clockwise and shift+key counterclockwise; ctrl makes a face key
+// turn the wide layer
+void beginKeyMove(AppCube *cube, int move, int action, int mods) {
+	if (action != GLFW_PRESS) {
+		return;
+	}
+	if (move < NUM_FACES && (mods & GLFW_MOD_CONTROL)) {
+		move += WIDE_MOVES;
+		mods &= ~GLFW_MOD_CONTROL;
+	}
+	if (mods == 0) {
+		rc_beginAnimation(&cube->animation, &cube->rubiks, move, CLOCKWISE, !animationsOn);
+	} else if (mods == GLFW_MOD_SHIFT) {
+		rc_beginAnimation(&cube->animation, &cube->rubiks, move, COUNTERCLOCKWISE, !animationsOn);
+	} else {
+		return;
+	}
+	// any solve under way was for the state before this move
+	solver_cancel(&cube->solver);
+}
+
 void resetCameraRotation() {
 	rotate.x = 0;
 	rotate.y = 0;
@@ -286,6 +375,9 @@ void printHelpText() {
 	printf("\t\t-: decrease rotation speed\n");
 	printf("\t\t=: reset rotation speed\n");
 	printf("\t\tp: print debug info\n");
+	printf("\t\tn: load next state from state file\n");
+	printf("\t\tw: enable/disable wall of independently solving cubes\n");
+	printf("\t\to: show/hide frame timing overlay\n");
 
 	printf("\tCamera controls:\n");
 
@@ -293,7 +385,7 @@ void printHelpText() {
 	printf("\t\tleft/right: rotate camera y-axis\n");
 	printf("\t\tup/down: rotate camera x-axis\n");
 
-	printf("\tRotation keys (key rotates clockwise, shift+key rotates ccw):\n");
+	printf("\tRotation keys (key rotates clockwise, shift+key rotates ccw, ctrl+face key turns wide):\n");
 	printf("\t\ts: shuffle\n");
 	printf("\t\ti: initialize\n");
 	printf("\t\tl/1: left face\n");
@@ -302,27 +394,57 @@ void printHelpText() {
 	printf("\t\tu/4: up face\n");
 	printf("\t\tf/5: front face\n");
 	printf("\t\tb/6: back face\n");
+	printf("\t\tm/7: middle slice (like l)\n");
+	printf("\t\te/8: equator slice (like d)\n");
+	printf("\t\t9: standing slice (like f)\n");
+	printf("\t\tx/y/z: whole cube (like r/u/f)\n");
 }
 
-void glapp_init() {
+int glapp_init() {
 	// TODO move application initialization here
-	rc_initialize(&rubiksCube);
+	rc_initialize(&appCube.rubiks);
+	rc_initAnimation(&appCube.animation);
+	random_seed(&appCube.random, time(NULL));
+	return solver_init(&appCube.solver);
 }
 
-void glapp_loadState(char *fileName) {
-	rc_initialize(&rubiksCube);
+int glapp_loadState(char *fileName) {
 	printf("Loading state from file: %s\n", fileName);
-	FILE *fp;
-	fp = fopen(fileName, "r");
-	int c;
-	char state[2000];
-	int index = 0;
-	while ((c = getc(fp)) != EOF) {
-		state[index] = c;
-		index++;
+	if (!loader_open(&stateLoader, fileName)) {
+		return 0;
+	}
+	stateFileOpen = 1;
+	return loadNextState(&appCube);
+}
+
+// Switch to a wall of columns x rows cubes, each shuffling and solving on its own
+int glapp_showWall(int columns, int rows) {
+	if (wall.cubes != NULL) {
+		wall_free(&wall);
+	}
+	if (!wall_init(&wall, columns, rows, random_next(&appCube.random))) {
+		return 0;
 	}
-	state[index] = '\0';
-	rc_deserializeState(&rubiksCube, state);
+	wallMode = 1;
+	return 1;
+}
+
+// Load the next state from the open state file, wrapping around at the end
+int loadNextState(AppCube *cube) {
+	CubieState state;
+	int result = loader_next(&stateLoader, &state);
+	if (result == 0 && stateLoader.offset > 0) {
+		loader_rewind(&stateLoader);
+		result = loader_next(&stateLoader, &state);
+	}
+	if (result != 1) {
+		log_error("%s", "No valid state found in state file");
+		return 0;
+	}
+	rc_initialize(&cube->rubiks);
+	cs_toRubiks(&state, &cube->rubiks);
+	solver_cancel(&cube->solver);
+	return 1;
 }
 
 int glapp_run(){
@@ -339,34 +461,60 @@ int glapp_run(){
 	glfwSwapInterval(1);
 
 	glEnable(GL_DEPTH_TEST);
+	glfwSetWindowUserPointer(window, &appCube);
 	glfwSetKeyCallback(window, keyboardHandler);
-	glClearColor(0.85, 0.85, 0.85, 0.0);
+	glClearColor(backgroundColor.red, backgroundColor.green, backgroundColor.blue, 0.0);
 
 	printHelpText();
 
-	solver_init();
+	AppCube *cube = &appCube;
+	solver_startWorker(&cube->solver);
 
+	prof_init();
+	lastFrameTime = timer_now();
 	while (!glfwWindowShouldClose(window)) {
+		double frameStart = prof_begin();
 		int width, height;
 		glfwGetFramebufferSize(window, &width, &height);
-		if (solverEnabled) {
-			int solved = solver_checkSolved(&rubiksCube);
+		double start = prof_begin();
+		if (solverEnabled && !wallMode) {
+			int solved = solver_checkSolved(&cube->rubiks);
 			if (solved && demoMode) {
-				rc_shuffle(&rubiksCube, 20);
+				rc_randomize(&cube->rubiks, &cube->random);
+				solver_cancel(&cube->solver);
 			} else if (solved && !demoMode) {
 				solverEnabled = 0;
 			} else if (!solved) {
-				solver_solve(&rubiksCube, animationsOn);
+				prof_addMoves(solver_solve(&cube->solver, &cube->rubiks, &cube->animation, animationsOn));
 			}
 		}
+		prof_end(PROF_PLAYBACK, start);
+		double planSeconds;
+		if (solver_takePlanTime(&cube->solver, &planSeconds)) {
+			prof_addSample(PROF_PLAN, planSeconds * 1000);
+		}
 		if (autorotate) {
 			rotate.y += 1;
 		}
-		display();
+		display(cube);
+		if (profilerOverlay) {
+			prof_draw(width, height);
+		}
+		start = prof_begin();
 		glfwSwapBuffers(window);
+		prof_end(PROF_SWAP, start);
 		glfwPollEvents();
+		prof_end(PROF_FRAME, frameStart);
 	}
+	solver_free(&cube->solver);
+	prof_printSummary(stdout);
 
+	if (stateFileOpen) {
+		loader_close(&stateLoader);
+	}
+	if (wall.cubes != NULL) {
+		wall_free(&wall);
+	}
 	glfwDestroyWindow(window);
 	glfwTerminate();
 	return EXIT_SUCCESS;
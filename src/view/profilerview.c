@@ -0,0 +1,114 @@
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#include <OpenGl/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "view/profilerview.h"
+#include "profiler.h"
+
+#define GLYPH_WIDTH 5
+#define GLYPH_HEIGHT 7
+#define FONT_SCALE 2 // framebuffer pixels per glyph pixel
+#define LINE_LENGTH 64
+#define MARGIN 8
+
+// 5x7 glyphs, one byte per column with the top row in bit 0
+static const char glyphChars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:/-%";
+static const unsigned char glyphs[][GLYPH_WIDTH] = {
+	{0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x42, 0x61, 0x51, 0x49, 0x46},
+	{0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39},
+	{0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03}, {0x36, 0x49, 0x49, 0x49, 0x36},
+	{0x06, 0x49, 0x49, 0x29, 0x1E}, {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36},
+	{0x3E, 0x41, 0x41, 0x41, 0x22}, {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41},
+	{0x7F, 0x09, 0x09, 0x09, 0x01}, {0x3E, 0x41, 0x49, 0x49, 0x7A}, {0x7F, 0x08, 0x08, 0x08, 0x7F},
+	{0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41},
+	{0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F},
+	{0x3E, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E},
+	{0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01},
+	{0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F},
+	{0x63, 0x14, 0x08, 0x14, 0x63}, {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43},
+	{0x00, 0x60, 0x60, 0x00, 0x00}, {0x00, 0x36, 0x36, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+	{0x08, 0x08, 0x08, 0x08, 0x08}, {0x23, 0x13, 0x08, 0x64, 0x62}
+};
+
+static void drawText(const char *text, float x, float y);
+
+void prof_draw(int width, int height) {
+	char lines[PROF_NUM_SECTIONS + 1][LINE_LENGTH];
+	int numLines = 0;
+	int longest = 0;
+	for (int i=0; i<PROF_NUM_SECTIONS; i++) {
+		ProfStats stats;
+		prof_recentStats(i, &stats);
+		snprintf(lines[numLines++], LINE_LENGTH, "%-6s LAST %6.2f  P50 %6.2f  P99 %6.2f MS",
+			prof_sectionName(i), stats.last, stats.p50, stats.p99);
+	}
+	snprintf(lines[numLines++], LINE_LENGTH, "MOVES/S %.1f", prof_movesPerSecond());
+	for (int i=0; i<numLines; i++) {
+		int length = strlen(lines[i]);
+		longest = length > longest ? length : longest;
+	}
+
+	float advance = (GLYPH_WIDTH + 1) * FONT_SCALE;
+	float lineHeight = (GLYPH_HEIGHT + 3) * FONT_SCALE;
+
+	// Pixel coordinates with the origin at the top left, drawn over the scene
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, width, height, 0, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glDisable(GL_DEPTH_TEST);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	glColor3f(0.1, 0.1, 0.1);
+	glBegin(GL_QUADS);
+	glVertex2f(0, 0);
+	glVertex2f(longest * advance + 2 * MARGIN, 0);
+	glVertex2f(longest * advance + 2 * MARGIN, numLines * lineHeight + 2 * MARGIN);
+	glVertex2f(0, numLines * lineHeight + 2 * MARGIN);
+	glEnd();
+
+	glColor3f(0.9, 0.9, 0.9);
+	for (int i=0; i<numLines; i++) {
+		drawText(lines[i], MARGIN, MARGIN + i * lineHeight);
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+// One quad per lit glyph pixel; characters without a glyph draw as blanks
+static void drawText(const char *text, float x, float y) {
+	glBegin(GL_QUADS);
+	for (const char *c=text; *c; c++, x+=(GLYPH_WIDTH + 1) * FONT_SCALE) {
+		const char *found = *c == ' ' ? NULL : strchr(glyphChars, toupper((unsigned char)*c));
+		if (found == NULL) {
+			continue;
+		}
+		const unsigned char *glyph = glyphs[found - glyphChars];
+		for (int col=0; col<GLYPH_WIDTH; col++) {
+			for (int row=0; row<GLYPH_HEIGHT; row++) {
+				if (glyph[col] >> row & 1) {
+					float left = x + col * FONT_SCALE;
+					float top = y + row * FONT_SCALE;
+					glVertex2f(left, top);
+					glVertex2f(left + FONT_SCALE, top);
+					glVertex2f(left + FONT_SCALE, top + FONT_SCALE);
+					glVertex2f(left, top + FONT_SCALE);
+				}
+			}
+		}
+	}
+	glEnd();
+}
@@ -0,0 +1,109 @@
+#include <math.h>
+
+#include "view/rubiksmesh.h"
+#include "view/constants.h"
+#include "controller/rubikscontroller.h"
+#include "quaternion.h"
+#include "vector.h"
+
+static const float scale = 0.95;
+
+static void getRotationMatrices(Rubiks *rubiks, float rotations[NUM_CUBES*16]);
+static void getFrameMatrix(Rubiks *rubiks, float frame[9]);
+static void getCubeTransform(Cube *cube, const float frame[9], int move, float degrees, float transform[16]);
+
+void rc_buildMesh(Rubiks *rubiks, int move, float degrees,
+	float *positions, float *fillColors, float *lineColors) {
+	float frame[9];
+	getFrameMatrix(rubiks, frame);
+	float rotations[NUM_CUBES*16];
+	getRotationMatrices(rubiks, rotations);
+	for (int i=0; i<NUM_CUBES; i++) {
+		Cube *cube = &rubiks->cubes[i];
+		float transform[16];
+		getCubeTransform(cube, frame, move, degrees, transform);
+		RGB3f color = cube->id == rubiks->cubeInProgress ? inProgressLineColor : lineColor;
+
+		int offset = i * CUBE_VERTEX_COUNT * 3;
+		cube_writeVertices(rotations + i*16, transform, positions + offset);
+		if (fillColors != NULL) {
+			cube_writeColors(cube, color, fillColors + offset, lineColors + offset);
+		}
+	}
+}
+
+// Every cubie's quaternion converted in one batch
+static void getRotationMatrices(Rubiks *rubiks, float rotations[NUM_CUBES*16]) {
+	float x[NUM_CUBES], y[NUM_CUBES], z[NUM_CUBES], w[NUM_CUBES];
+	for (int i=0; i<NUM_CUBES; i++) {
+		Quaternion *quat = &rubiks->cubes[i].quat;
+		x[i] = quat->x;
+		y[i] = quat->y;
+		z[i] = quat->z;
+		w[i] = quat->w;
+	}
+	quat_writeMatrices(x, y, z, w, NUM_CUBES, rotations);
+}
+
+// Column-major rotation taking each physical face normal to the normal of
+// the face it is seen as
+static void getFrameMatrix(Rubiks *rubiks, float frame[9]) {
+	for (int i=0; i<9; i++) {
+		frame[i] = 0;
+	}
+	for (int face=0; face<NUM_FACES; face++) {
+		Vec3f seen = faceData[face].normal;
+		Vec3f physical = faceData[rubiks->frame[face]].normal;
+		float to[3] = {seen.x, seen.y, seen.z};
+		float from[3] = {physical.x, physical.y, physical.z};
+		for (int col=0; col<3; col++) {
+			for (int row=0; row<3; row++) {
+				// every axis is counted once from each of its two faces
+				frame[col*3 + row] += 0.5 * to[row] * from[col];
+			}
+		}
+	}
+}
+
+// Column-major equivalent of glRotatef(move) * frame * glTranslatef(coord) * glScalef(size)
+static void getCubeTransform(Cube *cube, const float frame[9], int move, float degrees, float transform[16]) {
+	Vec3f coord = rc_determineCubeCoord(cube);
+	float size = cubeWidth * scale;
+
+	float r[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+	if (move != -1) {
+		Vec3f n = faceData[moveData[move].axis].normal;
+		float seenX = frame[0]*coord.x + frame[3]*coord.y + frame[6]*coord.z;
+		float seenY = frame[1]*coord.x + frame[4]*coord.y + frame[7]*coord.z;
+		float seenZ = frame[2]*coord.x + frame[5]*coord.y + frame[8]*coord.z;
+		int layer = (int)roundf(seenX*n.x + seenY*n.y + seenZ*n.z);
+		if (layer >= moveData[move].firstLayer && layer <= moveData[move].lastLayer) {
+			float radians = degToRad(degrees);
+			float c = cosf(radians);
+			float s = sinf(radians);
+			float t = 1 - c;
+			r[0] = t*n.x*n.x + c;		r[3] = t*n.x*n.y - s*n.z;	r[6] = t*n.x*n.z + s*n.y;
+			r[1] = t*n.x*n.y + s*n.z;	r[4] = t*n.y*n.y + c;		r[7] = t*n.y*n.z - s*n.x;
+			r[2] = t*n.x*n.z - s*n.y;	r[5] = t*n.y*n.z + s*n.x;	r[8] = t*n.z*n.z + c;
+		}
+	}
+
+	float m[9];
+	for (int col=0; col<3; col++) {
+		for (int row=0; row<3; row++) {
+			m[col*3 + row] = r[row]*frame[col*3] + r[3 + row]*frame[col*3 + 1] + r[6 + row]*frame[col*3 + 2];
+		}
+	}
+
+	for (int col=0; col<3; col++) {
+		for (int row=0; row<3; row++) {
+			transform[col*4 + row] = m[col*3 + row] * size;
+		}
+		transform[col*4 + 3] = 0;
+	}
+	coord = vec3fMultiplyScalar(coord, cubeWidth);
+	transform[12] = m[0]*coord.x + m[3]*coord.y + m[6]*coord.z;
+	transform[13] = m[1]*coord.x + m[4]*coord.y + m[7]*coord.z;
+	transform[14] = m[2]*coord.x + m[5]*coord.y + m[8]*coord.z;
+	transform[15] = 1;
+}
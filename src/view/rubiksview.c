@@ -2,41 +2,109 @@
 #define GL_SILENCE_DEPRECATION
 #include <OpenGl/gl.h>
 #else
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
 #endif
+#include <string.h>
 
 #include "view/rubiksview.h"
-#include "view/cubeview.h"
-#include "view/constants.h"
+#include "view/rubiksmesh.h"
 #include "controller/rubikscontroller.h"
 #include "vector.h"
 #include "logger.h"
 
-void rc_getFaceRotation(Cube *cube);
-
-void rc_draw(Rubiks *rubiks){
-	for(int i=0; i<NUM_CUBES; i++){
-		Cube *cube = rc_getCubeAtPos(rubiks, i);
-		Vec3f cubeCoord = vec3fMultiplyScalar(rc_determineCubeCoord(cube), cubeWidth);
-		glPushMatrix();
-		rc_getFaceRotation(cube);
-		if (cube->id == rubiks->cubeInProgress) {
-			cube_draw(*cube, cubeCoord, inProgressLineColor, cubeWidth);
-		} else {
-			cube_draw(*cube, cubeCoord, lineColor, cubeWidth);
-		}
-		glPopMatrix();
+#define POSITION_BUFFER 0
+#define FILL_COLOR_BUFFER 1
+#define LINE_COLOR_BUFFER 2
+#define NUM_BUFFERS 3
+
+static const float lineWidth = 5.0; // this should be proportional to cube size
+
+// Every cubie is baked into one vertex buffer, which is only rebuilt when
+// the cube state or the animation changes since the last frame
+typedef struct {
+	GLuint buffers[NUM_BUFFERS];
+	int initialized;
+	int valid;
+	Rubiks rubiks;
+	int rotatingMove;
+	float rotationDegrees;
+	float positions[RUBIKS_MESH_FLOATS];
+	float fillColors[RUBIKS_MESH_FLOATS];
+	float lineColors[RUBIKS_MESH_FLOATS];
+} RubiksMesh;
+
+static RubiksMesh mesh;
+
+static int meshIsCurrent(Rubiks *rubiks, int rotatingMove, float degrees);
+static void buildMesh(Rubiks *rubiks, int rotatingMove, float degrees);
+static void drawMesh();
+
+void rc_draw(Rubiks *rubiks, FaceAnimation *animation){
+	if (!mesh.initialized) {
+		glGenBuffers(NUM_BUFFERS, mesh.buffers);
+		mesh.initialized = 1;
+		mesh.valid = 0;
 	}
-}
 
-void rc_getFaceRotation(Cube *cube) {
-	// assuming that only one face at a time will rotate
-	for (int i=0; i<NUM_FACES; i++) {
-		if (rc_faceIsRotating(i)) {
-			if (rc_checkCubeInFace(cube, i)) {
-				glRotatef( rc_getFaceRotationDegrees(i), faceData[i].normal.x, faceData[i].normal.y, faceData[i].normal.z );
-				break;
-			}
-		}
+	int rotatingMove = rc_animationMove(animation);
+	float degrees = rotatingMove == -1 ? 0 : rc_animationDegrees(animation);
+	if (!meshIsCurrent(rubiks, rotatingMove, degrees)) {
+		buildMesh(rubiks, rotatingMove, degrees);
 	}
+	drawMesh();
+}
+
+static int meshIsCurrent(Rubiks *rubiks, int rotatingMove, float degrees) {
+	return mesh.valid
+		&& mesh.rotatingMove == rotatingMove
+		&& mesh.rotationDegrees == degrees
+		&& memcmp(&mesh.rubiks, rubiks, sizeof(mesh.rubiks)) == 0;
+}
+
+static void buildMesh(Rubiks *rubiks, int rotatingMove, float degrees) {
+	rc_buildMesh(rubiks, rotatingMove, degrees, mesh.positions, mesh.fillColors, mesh.lineColors);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[POSITION_BUFFER]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(mesh.positions), mesh.positions, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[FILL_COLOR_BUFFER]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(mesh.fillColors), mesh.fillColors, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[LINE_COLOR_BUFFER]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(mesh.lineColors), mesh.lineColors, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	mesh.rubiks = *rubiks;
+	mesh.rotatingMove = rotatingMove;
+	mesh.rotationDegrees = degrees;
+	mesh.valid = 1;
+}
+
+static void drawMesh() {
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[POSITION_BUFFER]);
+	glVertexPointer(3, GL_FLOAT, 0, 0);
+
+	// Draw outline
+	glEnable(GL_POLYGON_OFFSET_LINE);
+	glPolygonOffset(0,-1);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	glLineWidth((GLfloat)lineWidth);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[LINE_COLOR_BUFFER]);
+	glColorPointer(3, GL_FLOAT, 0, 0);
+	glDrawArrays(GL_QUADS, 0, RUBIKS_MESH_VERTEX_COUNT);
+	glDisable(GL_POLYGON_OFFSET_LINE);
+
+	// Draw solid polygons
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1,1); // just guessing on these values
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[FILL_COLOR_BUFFER]);
+	glColorPointer(3, GL_FLOAT, 0, 0);
+	glDrawArrays(GL_QUADS, 0, RUBIKS_MESH_VERTEX_COUNT);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
 }
@@ -0,0 +1,371 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "view/softrender.h"
+#include "view/rubiksmesh.h"
+#include "view/bigcubemesh.h"
+#include "view/constants.h"
+#include "quaternion.h"
+#include "logger.h"
+
+// Matches glLineWidth in rubiksview.c for an 800 pixel window
+#define LINE_WIDTH 5.0
+#define REFERENCE_SIZE 800.0
+
+// Stand-ins for the glPolygonOffset calls, in normalized depth units
+#define LINE_DEPTH_OFFSET -1e-4
+#define FILL_DEPTH_OFFSET 1e-4
+
+#define PNG_MAX_STORED_BLOCK 65535
+
+static void projectVertices(Framebuffer *fb, float *positions, int count, Vec2d rotation);
+static void drawQuad(Framebuffer *fb, const float *v, const float *fill, const float *line, float halfWidth);
+static unsigned char toByte(float value);
+
+int sr_initFramebuffer(Framebuffer *fb, int width, int height) {
+	fb->width = width;
+	fb->height = height;
+	fb->pixels = malloc((size_t)width * height * 3);
+	fb->depth = malloc((size_t)width * height * sizeof(float));
+	if (fb->pixels == NULL || fb->depth == NULL) {
+		log_error("Unable to allocate %ix%i framebuffer", width, height);
+		sr_freeFramebuffer(fb);
+		return 0;
+	}
+	sr_clear(fb);
+	return 1;
+}
+
+void sr_freeFramebuffer(Framebuffer *fb) {
+	free(fb->pixels);
+	free(fb->depth);
+	fb->pixels = NULL;
+	fb->depth = NULL;
+}
+
+void sr_clear(Framebuffer *fb) {
+	unsigned char rgb[3] = {toByte(backgroundColor.red), toByte(backgroundColor.green), toByte(backgroundColor.blue)};
+	int count = fb->width * fb->height;
+	for (int i=0; i<count; i++) {
+		memcpy(fb->pixels + i*3, rgb, 3);
+		fb->depth[i] = 1.0;
+	}
+}
+
+void sr_drawRubiks(Framebuffer *fb, Rubiks *rubiks, int move, float degrees, Vec2d rotation) {
+	float positions[RUBIKS_MESH_FLOATS];
+	float fillColors[RUBIKS_MESH_FLOATS];
+	float lineColors[RUBIKS_MESH_FLOATS];
+	rc_buildMesh(rubiks, move, degrees, positions, fillColors, lineColors);
+	projectVertices(fb, positions, RUBIKS_MESH_VERTEX_COUNT, rotation);
+
+	float size = fb->width < fb->height ? fb->width : fb->height;
+	float halfWidth = LINE_WIDTH * size / REFERENCE_SIZE / 2;
+	for (int c=0; c<NUM_CUBES; c++) {
+		const float *cube = positions + c*CUBE_VERTEX_COUNT*3;
+		float center = 0;
+		for (int i=0; i<CUBE_VERTEX_COUNT; i++) {
+			center += cube[i*3 + 2];
+		}
+		center /= CUBE_VERTEX_COUNT;
+		for (int q=0; q<CUBE_VERTEX_COUNT; q+=4) {
+			// Faces turned away from the viewer are hidden behind the rest
+			// of their own cube, edges included, so they can be skipped
+			const float *quad = cube + q*3;
+			float faceCenter = (quad[2] + quad[5] + quad[8] + quad[11]) / 4;
+			if (faceCenter - center > 1e-6) {
+				continue;
+			}
+			int offset = (c*CUBE_VERTEX_COUNT + q) * 3;
+			drawQuad(fb, positions + offset, fillColors + offset, lineColors + offset, halfWidth);
+		}
+	}
+}
+
+// Stickers are outlined like the 3x3 cube's, with the line width scaled to
+// the sticker size
+int sr_drawBigCube(Framebuffer *fb, BigCube *cube, Vec2d rotation) {
+	int vertexCount = BIGCUBE_MESH_VERTEX_COUNT(cube->size);
+	float *positions = malloc((size_t)vertexCount * 3 * sizeof(float));
+	float *colors = malloc((size_t)vertexCount * 3 * sizeof(float));
+	if (positions == NULL || colors == NULL) {
+		log_error("Unable to allocate mesh for %ix%i cube", cube->size, cube->size);
+		free(positions);
+		free(colors);
+		return 0;
+	}
+	bc_buildMesh(cube, positions, colors);
+	projectVertices(fb, positions, vertexCount, rotation);
+
+	float size = fb->width < fb->height ? fb->width : fb->height;
+	float halfWidth = LINE_WIDTH * size / REFERENCE_SIZE / 2 * 3 / cube->size;
+	float line[3] = {lineColor.red, lineColor.green, lineColor.blue};
+	int faceVertices = vertexCount / NUM_FACES;
+	for (int face=0; face<NUM_FACES; face++) {
+		// Only faces whose normal points toward the viewer can be seen
+		Vec3f n = faceData[face].normal;
+		Vec3f o = {0, 0, 0};
+		float towards[6] = {n.x, n.y, n.z, o.x, o.y, o.z};
+		projectVertices(fb, towards, 2, rotation);
+		if (towards[2] - towards[5] > 1e-6) {
+			continue;
+		}
+		for (int q=0; q<faceVertices; q+=4) {
+			int offset = (face*faceVertices + q) * 3;
+			drawQuad(fb, positions + offset, colors + offset, line, halfWidth);
+		}
+	}
+	free(positions);
+	free(colors);
+	return 1;
+}
+
+// Camera is glRotatef(x, 1, 0, 0) * glRotatef(y, 0, 1, 0) with an identity
+// projection, then the viewport maps [-1, 1] onto the framebuffer
+static void projectVertices(Framebuffer *fb, float *positions, int count, Vec2d rotation) {
+	float cx = cosf(degToRad(rotation.x)), sx = sinf(degToRad(rotation.x));
+	float cy = cosf(degToRad(rotation.y)), sy = sinf(degToRad(rotation.y));
+	for (int i=0; i<count; i++) {
+		float *p = positions + i*3;
+		float x = cy*p[0] + sy*p[2];
+		float z = -sy*p[0] + cy*p[2];
+		float y = cx*p[1] - sx*z;
+		z = sx*p[1] + cx*z;
+		p[0] = (x + 1) * fb->width / 2;
+		p[1] = (1 - y) * fb->height / 2;
+		p[2] = z;
+	}
+}
+
+// Fill a convex screen-space quad and stroke its edges, depth tested.
+// Edge-on quads still get their outline, as GL_LINE polygon mode does.
+static void drawQuad(Framebuffer *fb, const float *v, const float *fill, const float *line, float halfWidth) {
+	float minX = v[0], maxX = v[0], minY = v[1], maxY = v[1];
+	for (int i=1; i<4; i++) {
+		minX = fminf(minX, v[i*3]);
+		maxX = fmaxf(maxX, v[i*3]);
+		minY = fminf(minY, v[i*3 + 1]);
+		maxY = fmaxf(maxY, v[i*3 + 1]);
+	}
+	int x0 = maxd(floorf(minX - halfWidth), 0);
+	int x1 = mind(ceilf(maxX + halfWidth), fb->width - 1);
+	int y0 = maxd(floorf(minY - halfWidth), 0);
+	int y1 = mind(ceilf(maxY + halfWidth), fb->height - 1);
+
+	float area = 0;
+	for (int i=0; i<4; i++) {
+		const float *a = v + i*3;
+		const float *b = v + ((i+1)&3)*3;
+		area += a[0]*b[1] - b[0]*a[1];
+	}
+	int filled = fabsf(area) > 1e-3;
+
+	// Depth plane through the larger of the two triangles
+	float dzdx = 0, dzdy = 0;
+	if (filled) {
+		const float *a = v, *b = v + 3, *c = v + 6;
+		float e1x = b[0]-a[0], e1y = b[1]-a[1], e2x = c[0]-a[0], e2y = c[1]-a[1];
+		float det = e1x*e2y - e2x*e1y;
+		float e3x = v[9]-a[0], e3y = v[10]-a[1];
+		float det2 = e2x*e3y - e3x*e2y;
+		if (fabsf(det2) > fabsf(det)) {
+			b = c;
+			c = v + 9;
+			e1x = e2x; e1y = e2y;
+			e2x = e3x; e2y = e3y;
+			det = det2;
+		}
+		dzdx = ((b[2]-a[2])*e2y - (c[2]-a[2])*e1y) / det;
+		dzdy = ((c[2]-a[2])*e1x - (b[2]-a[2])*e2x) / det;
+	}
+
+	// Edge directions and inverse lengths, oriented so inside is positive
+	float orientation = area < 0 ? -1 : 1;
+	float ex[4], ey[4], inverseLength[4];
+	for (int i=0; i<4; i++) {
+		const float *a = v + i*3;
+		const float *b = v + ((i+1)&3)*3;
+		ex[i] = b[0]-a[0];
+		ey[i] = b[1]-a[1];
+		float length = sqrtf(ex[i]*ex[i] + ey[i]*ey[i]);
+		inverseLength[i] = length > 0 ? orientation / length : 0;
+	}
+
+	unsigned char fillRGB[3] = {toByte(fill[0]), toByte(fill[1]), toByte(fill[2])};
+	unsigned char lineRGB[3] = {toByte(line[0]), toByte(line[1]), toByte(line[2])};
+
+	for (int py=y0; py<=y1; py++) {
+		float y = py + 0.5;
+		for (int px=x0; px<=x1; px++) {
+			float x = px + 0.5;
+
+			// Signed distance to each edge line settles most pixels cheaply
+			float nearestLine = halfWidth * 2;
+			int farOutside = 0;
+			for (int i=0; i<4; i++) {
+				float distance = (ex[i]*(y-v[i*3 + 1]) - ey[i]*(x-v[i*3])) * inverseLength[i];
+				farOutside |= distance < -halfWidth;
+				nearestLine = fminf(nearestLine, distance);
+			}
+			if (farOutside && filled) {
+				continue;
+			}
+
+			float depth = 0;
+			const unsigned char *rgb;
+			if (filled && nearestLine > halfWidth) {
+				depth = v[2] + (x-v[0])*dzdx + (y-v[1])*dzdy + FILL_DEPTH_OFFSET;
+				rgb = fillRGB;
+			} else {
+				// Near the outline, find the closest edge segment
+				float nearest = halfWidth * halfWidth;
+				int onLine = 0;
+				for (int i=0; i<4; i++) {
+					const float *a = v + i*3;
+					float dx = x-a[0], dy = y-a[1];
+					float lengthSquared = ex[i]*ex[i] + ey[i]*ey[i];
+					float t = lengthSquared > 0 ? (dx*ex[i] + dy*ey[i]) / lengthSquared : 0;
+					t = fminf(fmaxf(t, 0), 1);
+					float ox = dx - t*ex[i], oy = dy - t*ey[i];
+					float distanceSquared = ox*ox + oy*oy;
+					if (distanceSquared <= nearest) {
+						nearest = distanceSquared;
+						depth = a[2] + t*(v[((i+1)&3)*3 + 2]-a[2]) + LINE_DEPTH_OFFSET;
+						onLine = 1;
+					}
+				}
+				if (onLine) {
+					rgb = lineRGB;
+				} else if (filled && nearestLine >= 0) {
+					depth = v[2] + (x-v[0])*dzdx + (y-v[1])*dzdy + FILL_DEPTH_OFFSET;
+					rgb = fillRGB;
+				} else {
+					continue;
+				}
+			}
+			int index = py*fb->width + px;
+			if (depth >= -1 && depth < fb->depth[index]) {
+				fb->depth[index] = depth;
+				memcpy(fb->pixels + index*3, rgb, 3);
+			}
+		}
+	}
+}
+
+static unsigned char toByte(float value) {
+	return (unsigned char)(fminf(fmaxf(value, 0), 1) * 255 + 0.5);
+}
+
+int sr_writePPM(Framebuffer *fb, FILE *fp) {
+	fprintf(fp, "P6\n%i %i\n255\n", fb->width, fb->height);
+	size_t size = (size_t)fb->width * fb->height * 3;
+	return fwrite(fb->pixels, 1, size, fp) == size;
+}
+
+// PNG output using uncompressed deflate blocks, so no zlib is needed
+
+static const unsigned int crcNibbles[16] = {
+	0x00000000u, 0x1db71064u, 0x3b6e20c8u, 0x26d930acu, 0x76dc4190u, 0x6b6b51f4u, 0x4db26158u, 0x5005713cu,
+	0xedb88320u, 0xf00f9344u, 0xd6d6a3e8u, 0xcb61b38cu, 0x9b64c2b0u, 0x86d3d2d4u, 0xa00ae278u, 0xbdbdf21cu
+};
+
+typedef struct {
+	FILE *fp;
+	unsigned int crc;
+	unsigned int adlerA;
+	unsigned int adlerB;
+	unsigned int blockLeft; // bytes left in the current stored block
+	size_t dataLeft; // image bytes not yet written
+} PngWriter;
+
+static void pngWrite(PngWriter *writer, const unsigned char *data, size_t length) {
+	unsigned int crc = writer->crc;
+	for (size_t i=0; i<length; i++) {
+		crc ^= data[i];
+		crc = (crc >> 4) ^ crcNibbles[crc & 15];
+		crc = (crc >> 4) ^ crcNibbles[crc & 15];
+	}
+	writer->crc = crc;
+	fwrite(data, 1, length, writer->fp);
+}
+
+static void pngWriteInt(PngWriter *writer, unsigned int value) {
+	unsigned char bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+	pngWrite(writer, bytes, 4);
+}
+
+static void pngBeginChunk(PngWriter *writer, const char *type, unsigned int length) {
+	unsigned char bytes[4] = {length >> 24, length >> 16, length >> 8, length};
+	fwrite(bytes, 1, 4, writer->fp);
+	writer->crc = 0xffffffffu;
+	pngWrite(writer, (const unsigned char *)type, 4);
+}
+
+static void pngEndChunk(PngWriter *writer) {
+	unsigned int crc = writer->crc ^ 0xffffffffu;
+	unsigned char bytes[4] = {crc >> 24, crc >> 16, crc >> 8, crc};
+	fwrite(bytes, 1, 4, writer->fp);
+}
+
+// Write image bytes, starting a new stored block whenever one fills up
+static void pngWriteImageData(PngWriter *writer, const unsigned char *data, size_t length) {
+	while (length > 0) {
+		if (writer->blockLeft == 0) {
+			unsigned int size = writer->dataLeft < PNG_MAX_STORED_BLOCK ? writer->dataLeft : PNG_MAX_STORED_BLOCK;
+			unsigned char header[5] = {
+				writer->dataLeft == size, size & 0xff, size >> 8, ~size & 0xff, (~size >> 8) & 0xff
+			};
+			pngWrite(writer, header, 5);
+			writer->blockLeft = size;
+		}
+		size_t n = length < writer->blockLeft ? length : writer->blockLeft;
+		pngWrite(writer, data, n);
+		for (size_t i=0; i<n; i++) {
+			writer->adlerA = (writer->adlerA + data[i]) % 65521;
+			writer->adlerB = (writer->adlerB + writer->adlerA) % 65521;
+		}
+		writer->blockLeft -= n;
+		writer->dataLeft -= n;
+		data += n;
+		length -= n;
+	}
+}
+
+int sr_writePNG(Framebuffer *fb, FILE *fp) {
+	static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	static const unsigned char zlibHeader[2] = {0x78, 0x01};
+	static const unsigned char filterNone = 0;
+
+	size_t rowSize = (size_t)fb->width * 3;
+	size_t dataSize = (rowSize + 1) * fb->height;
+	size_t blocks = (dataSize + PNG_MAX_STORED_BLOCK - 1) / PNG_MAX_STORED_BLOCK;
+	size_t idatSize = sizeof(zlibHeader) + dataSize + blocks*5 + 4;
+	if (idatSize > 0x7fffffffu) {
+		log_error("Frame of %ix%i is too large for an uncompressed PNG", fb->width, fb->height);
+		return 0;
+	}
+
+	PngWriter writer = {fp, 0, 1, 0, 0, dataSize};
+	fwrite(signature, 1, sizeof(signature), fp);
+
+	pngBeginChunk(&writer, "IHDR", 13);
+	pngWriteInt(&writer, fb->width);
+	pngWriteInt(&writer, fb->height);
+	unsigned char format[5] = {8, 2, 0, 0, 0}; // 8 bit rgb, no interlace
+	pngWrite(&writer, format, 5);
+	pngEndChunk(&writer);
+
+	pngBeginChunk(&writer, "IDAT", idatSize);
+	pngWrite(&writer, zlibHeader, sizeof(zlibHeader));
+	for (int y=0; y<fb->height; y++) {
+		pngWriteImageData(&writer, &filterNone, 1);
+		pngWriteImageData(&writer, fb->pixels + y*rowSize, rowSize);
+	}
+	pngWriteInt(&writer, (writer.adlerB << 16) | writer.adlerA);
+	pngEndChunk(&writer);
+
+	pngBeginChunk(&writer, "IEND", 0);
+	pngEndChunk(&writer);
+	return !ferror(fp);
+}
@@ -0,0 +1,189 @@
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#include <OpenGl/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#endif
+#include <math.h>
+#include <stdlib.h>
+
+#include "view/wallview.h"
+#include "view/rubiksmesh.h"
+#include "logger.h"
+
+#define POSITION_BUFFER 0
+#define FILL_COLOR_BUFFER 1
+#define LINE_COLOR_BUFFER 2
+#define NUM_BUFFERS 3
+
+#define WALL_SPACING 1.0 // grid cell size in model units, a cube spans 0.6
+#define WALL_LINE_WIDTH 5.0
+
+// Like the single cube view, all cubes share one set of buffers. Only cubes
+// whose version changed since the last frame are rebuilt, and the changed
+// span is uploaded in one call. The buffers hold cube-local positions; the
+// camera rotation and grid placement are applied per cube at draw time, so
+// dragging the view rebuilds nothing.
+typedef struct {
+	GLuint buffers[NUM_BUFFERS];
+	int initialized;
+	int size; // cubes the buffers hold
+	unsigned int *versions;
+	int *inProgress;
+	float *positions;
+	float *lineColors;
+} WallMesh;
+
+static WallMesh mesh;
+
+static int resizeMesh(Wall *wall);
+static void buildCube(Wall *wall, int index, float *fillColors);
+static void uploadSpan(int buffer, float *data, int first, int last);
+static void drawMesh(Wall *wall, Vec2d rotation, float scale, float lineWidth);
+static void drawPass(Wall *wall, Vec2d rotation, float scale);
+
+void wall_draw(Wall *wall, Vec2d rotation) {
+	int size = wall_size(wall);
+	if (size == 0) {
+		return;
+	}
+	if (!mesh.initialized || mesh.size != size) {
+		if (!resizeMesh(wall)) {
+			return;
+		}
+	} else {
+		int first = size, last = -1;
+		for (int i=0; i<size; i++) {
+			if (mesh.versions[i] != wall->cubes[i].version) {
+				buildCube(wall, i, NULL);
+				first = i < first ? i : first;
+				last = i;
+			}
+		}
+		if (last >= 0) {
+			uploadSpan(POSITION_BUFFER, mesh.positions, first, last);
+			uploadSpan(LINE_COLOR_BUFFER, mesh.lineColors, first, last);
+		}
+	}
+
+	float scale = 2 / (WALL_SPACING * (wall->columns > wall->rows ? wall->columns : wall->rows));
+	drawMesh(wall, rotation, scale, fmax(1, WALL_LINE_WIDTH * scale));
+}
+
+// Reallocate the CPU mirrors and buffer objects, and write the fill colors,
+// which never change for a given cube
+static int resizeMesh(Wall *wall) {
+	int size = wall_size(wall);
+	size_t bytes = (size_t)size * RUBIKS_MESH_FLOATS * sizeof(float);
+	free(mesh.versions);
+	free(mesh.inProgress);
+	free(mesh.positions);
+	free(mesh.lineColors);
+	mesh.versions = calloc(size, sizeof(unsigned int));
+	mesh.inProgress = calloc(size, sizeof(int));
+	mesh.positions = malloc(bytes);
+	mesh.lineColors = malloc(bytes);
+	float *fillColors = malloc(bytes);
+	if (!mesh.versions || !mesh.inProgress || !mesh.positions || !mesh.lineColors || !fillColors) {
+		log_error("Unable to allocate mesh for %i cubes", size);
+		free(fillColors);
+		mesh.size = 0;
+		return 0;
+	}
+
+	if (!mesh.initialized) {
+		glGenBuffers(NUM_BUFFERS, mesh.buffers);
+		mesh.initialized = 1;
+	}
+	mesh.size = size;
+	for (int i=0; i<size; i++) {
+		buildCube(wall, i, fillColors);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[POSITION_BUFFER]);
+	glBufferData(GL_ARRAY_BUFFER, bytes, mesh.positions, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[LINE_COLOR_BUFFER]);
+	glBufferData(GL_ARRAY_BUFFER, bytes, mesh.lineColors, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[FILL_COLOR_BUFFER]);
+	glBufferData(GL_ARRAY_BUFFER, bytes, fillColors, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	free(fillColors);
+	return 1;
+}
+
+// Bake one cube into its slot in its own model space. Colors are only rewritten when fillColors is given or the cube in
+// progress changed.
+static void buildCube(Wall *wall, int index, float *fillColors) {
+	WallCube *cube = &wall->cubes[index];
+	int move = rc_animationMove(&cube->animation);
+	float degrees = move == -1 ? 0 : rc_animationDegrees(&cube->animation);
+	float *positions = mesh.positions + (size_t)index * RUBIKS_MESH_FLOATS;
+	float *lineColors = mesh.lineColors + (size_t)index * RUBIKS_MESH_FLOATS;
+
+	if (fillColors != NULL) {
+		rc_buildMesh(&cube->rubiks, move, degrees, positions,
+			fillColors + (size_t)index * RUBIKS_MESH_FLOATS, lineColors);
+	} else if (mesh.inProgress[index] != cube->rubiks.cubeInProgress) {
+		float unused[RUBIKS_MESH_FLOATS];
+		rc_buildMesh(&cube->rubiks, move, degrees, positions, unused, lineColors);
+	} else {
+		rc_buildMesh(&cube->rubiks, move, degrees, positions, NULL, NULL);
+	}
+	mesh.inProgress[index] = cube->rubiks.cubeInProgress;
+	mesh.versions[index] = cube->version;
+}
+
+static void uploadSpan(int buffer, float *data, int first, int last) {
+	size_t cubeBytes = RUBIKS_MESH_FLOATS * sizeof(float);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[buffer]);
+	glBufferSubData(GL_ARRAY_BUFFER, first * cubeBytes, (last - first + 1) * cubeBytes,
+		data + (size_t)first * RUBIKS_MESH_FLOATS);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static void drawMesh(Wall *wall, Vec2d rotation, float scale, float lineWidth) {
+	glPushMatrix();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[POSITION_BUFFER]);
+	glVertexPointer(3, GL_FLOAT, 0, 0);
+
+	// Draw outline
+	glEnable(GL_POLYGON_OFFSET_LINE);
+	glPolygonOffset(0,-1);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+	glLineWidth((GLfloat)lineWidth);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[LINE_COLOR_BUFFER]);
+	glColorPointer(3, GL_FLOAT, 0, 0);
+	drawPass(wall, rotation, scale);
+	glDisable(GL_POLYGON_OFFSET_LINE);
+
+	// Draw solid polygons
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1,1);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.buffers[FILL_COLOR_BUFFER]);
+	glColorPointer(3, GL_FLOAT, 0, 0);
+	drawPass(wall, rotation, scale);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glPopMatrix();
+}
+
+// Place each cube at its grid cell, turned about its own center by the
+// camera rotation. One draw call per cube, but the buffers stay untouched.
+static void drawPass(Wall *wall, Vec2d rotation, float scale) {
+	for (int i=0; i<mesh.size; i++) {
+		float offsetX = ((i % wall->columns) - (wall->columns - 1) / 2.0) * WALL_SPACING * scale;
+		float offsetY = ((wall->rows - 1) / 2.0 - (i / wall->columns)) * WALL_SPACING * scale;
+		glLoadIdentity();
+		glTranslatef(offsetX, offsetY, 0);
+		glRotatef(rotation.x, 1.0, 0.0, 0.0);
+		glRotatef(rotation.y, 0.0, 1.0, 0.0);
+		glScalef(scale, scale, scale);
+		glDrawArrays(GL_QUADS, i * RUBIKS_MESH_VERTEX_COUNT, RUBIKS_MESH_VERTEX_COUNT);
+	}
+}
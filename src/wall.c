@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "wall.h"
+#include "controller/solvercontroller.h"
+#include "logger.h"
+#include "trace.h"
+
+#define WALL_MAX_SOLUTION 2048
+#define WALL_SOLVED_PAUSE 1.0 // seconds to show a solved cube
+
+static void collectSolutions(Wall *wall);
+static void adoptSolution(WallCube *cube);
+static void startCube(Wall *wall, WallCube *cube);
+static int updateCube(Wall *wall, WallCube *cube, double turnsPerSecond, double elapsed);
+static void *workerMain(void *arg);
+static void solveCube(Wall *wall, int index, Step *solution, int *inProgress);
+
+int wall_init(Wall *wall, int columns, int rows, uint64_t seed) {
+	wall->columns = columns;
+	wall->rows = rows;
+	random_seed(&wall->random, seed);
+	pthread_mutex_init(&wall->lock, NULL);
+	pthread_cond_init(&wall->wake, NULL);
+	wall->workerCount = 0;
+	wall->stopping = 0;
+	wall->queueHead = 0;
+	wall->queueCount = 0;
+	wall->cubes = calloc(columns * rows, sizeof(WallCube));
+	wall->queue = malloc(columns * rows * sizeof(int));
+	if (wall->cubes == NULL || wall->queue == NULL) {
+		log_error("Unable to allocate a %ix%i wall", columns, rows);
+		wall_free(wall);
+		return 0;
+	}
+	for (int i=0; i<columns*rows; i++) {
+		WallCube *cube = &wall->cubes[i];
+		rc_initialize(&cube->rubiks);
+		rc_initAnimation(&cube->animation);
+		// Stagger the first shuffles so the wall does not move in lockstep
+		cube->idle = WALL_SOLVED_PAUSE * random_unit(&wall->random);
+	}
+	for (int i=0; i<WALL_WORKERS; i++) {
+		if (pthread_create(&wall->workers[i], NULL, workerMain, wall) != 0) {
+			log_error("Unable to start wall worker %i", i);
+			break;
+		}
+		wall->workerCount++;
+	}
+	if (wall->workerCount == 0) {
+		wall_free(wall);
+		return 0;
+	}
+	return 1;
+}
+
+void wall_free(Wall *wall) {
+	pthread_mutex_lock(&wall->lock);
+	wall->stopping = 1;
+	pthread_cond_broadcast(&wall->wake);
+	pthread_mutex_unlock(&wall->lock);
+	for (int i=0; i<wall->workerCount; i++) {
+		pthread_join(wall->workers[i], NULL);
+	}
+	wall->workerCount = 0;
+	pthread_mutex_destroy(&wall->lock);
+	pthread_cond_destroy(&wall->wake);
+
+	for (int i=0; wall->cubes != NULL && i<wall_size(wall); i++) {
+		free(wall->cubes[i].solution);
+		free(wall->cubes[i].inProgress);
+		free(wall->cubes[i].readySolution);
+		free(wall->cubes[i].readyInProgress);
+	}
+	free(wall->cubes);
+	free(wall->queue);
+	wall->cubes = NULL;
+	wall->queue = NULL;
+	wall->columns = 0;
+	wall->rows = 0;
+}
+
+int wall_size(Wall *wall) {
+	return wall->columns * wall->rows;
+}
+
+// Returns the number of moves started
+int wall_update(Wall *wall, double turnsPerSecond, double elapsed) {
+	collectSolutions(wall);
+	int moves = 0;
+	for (int i=0; i<wall_size(wall); i++) {
+		moves += updateCube(wall, &wall->cubes[i], turnsPerSecond, elapsed);
+	}
+	return moves;
+}
+
+// Take over every solution the workers have finished since the last frame
+static void collectSolutions(Wall *wall) {
+	pthread_mutex_lock(&wall->lock);
+	for (int i=0; i<wall_size(wall); i++) {
+		if (wall->cubes[i].solved) {
+			adoptSolution(&wall->cubes[i]);
+		}
+	}
+	pthread_mutex_unlock(&wall->lock);
+}
+
+static void adoptSolution(WallCube *cube) {
+	free(cube->solution);
+	free(cube->inProgress);
+	cube->solution = cube->readySolution;
+	cube->inProgress = cube->readyInProgress;
+	cube->solutionLength = cube->readyLength;
+	cube->readySolution = NULL;
+	cube->readyInProgress = NULL;
+	cube->nextMove = 0;
+	cube->solved = 0;
+	cube->waiting = 0;
+	if (cube->solutionLength < 0) {
+		log_error("%s", "Unable to solve wall cube, resetting it");
+		rc_reset(&cube->rubiks);
+		cube->solutionLength = 0;
+		cube->version++;
+	}
+}
+
+static int updateCube(Wall *wall, WallCube *cube, double turnsPerSecond, double elapsed) {
+	int started = 0;
+	if (!rc_animationIsRotating(&cube->animation)) {
+		if (cube->nextMove < cube->solutionLength) {
+			Step step = cube->solution[cube->nextMove];
+			cube->rubiks.cubeInProgress = cube->inProgress[cube->nextMove];
+			cube->nextMove++;
+			rc_beginAnimation(&cube->animation, &cube->rubiks, step.face, step.direction, 0);
+			started = 1;
+		} else {
+			if (cube->waiting) {
+				return 0;
+			}
+			if (cube->rubiks.cubeInProgress != -1) {
+				cube->rubiks.cubeInProgress = -1;
+				cube->version++;
+			}
+			cube->idle -= elapsed;
+			if (cube->idle <= 0) {
+				startCube(wall, cube);
+			}
+			return 0;
+		}
+	}
+	// The mesh bakes in the turn angle, so it only needs rebuilding when a
+	// fixed timestep moved it or a move started or finished
+	int move = rc_animationMove(&cube->animation);
+	float degrees = rc_animationDegrees(&cube->animation);
+	rc_updateAnimation(&cube->animation, &cube->rubiks, turnsPerSecond, elapsed);
+	if (started || rc_animationMove(&cube->animation) != move
+			|| rc_animationDegrees(&cube->animation) != degrees) {
+		cube->version++;
+	}
+	return started;
+}
+
+// Shuffle the cube and queue it for a worker to plan its solve. It shows
+// the shuffle until wall_update picks the solution up.
+static void startCube(Wall *wall, WallCube *cube) {
+	rc_randomize(&cube->rubiks, &wall->random);
+	cube->version++;
+	cube->nextMove = 0;
+	cube->solutionLength = 0;
+	cube->idle = WALL_SOLVED_PAUSE;
+	cube->waiting = 1;
+	pthread_mutex_lock(&wall->lock);
+	int tail = (wall->queueHead + wall->queueCount) % wall_size(wall);
+	wall->queue[tail] = cube - wall->cubes;
+	wall->queueCount++;
+	pthread_cond_signal(&wall->wake);
+	pthread_mutex_unlock(&wall->lock);
+}
+
+static void *workerMain(void *arg) {
+	Wall *wall = arg;
+	trace_nameThread("wall worker");
+	Step *solution = malloc(WALL_MAX_SOLUTION * sizeof(Step));
+	int *inProgress = malloc(WALL_MAX_SOLUTION * sizeof(int));
+	if (solution == NULL || inProgress == NULL) {
+		log_fatal("%s", "Unable to allocate wall worker");
+		exit(1);
+	}
+	pthread_mutex_lock(&wall->lock);
+	for (;;) {
+		while (!wall->stopping && wall->queueCount == 0) {
+			pthread_cond_wait(&wall->wake, &wall->lock);
+		}
+		if (wall->stopping) {
+			break;
+		}
+		int index = wall->queue[wall->queueHead];
+		wall->queueHead = (wall->queueHead + 1) % wall_size(wall);
+		wall->queueCount--;
+		pthread_mutex_unlock(&wall->lock);
+		solveCube(wall, index, solution, inProgress);
+		pthread_mutex_lock(&wall->lock);
+	}
+	pthread_mutex_unlock(&wall->lock);
+	free(solution);
+	free(inProgress);
+	return NULL;
+}
+
+// The render thread leaves a waiting cube's state alone, so it can be read
+// here without the lock
+static void solveCube(Wall *wall, int index, Step *solution, int *inProgress) {
+	WallCube *cube = &wall->cubes[index];
+	Rubiks snapshot = cube->rubiks;
+	int length = solver_computeSolution(&snapshot, solution, inProgress, WALL_MAX_SOLUTION, NULL);
+	Step *readySolution = NULL;
+	int *readyInProgress = NULL;
+	// An already solved shuffle has nothing to play back
+	if (length > 0) {
+		readySolution = malloc(length * sizeof(Step));
+		readyInProgress = malloc(length * sizeof(int));
+		if (readySolution == NULL || readyInProgress == NULL) {
+			log_fatal("Unable to allocate a %i move solution", length);
+			exit(1);
+		}
+		memcpy(readySolution, solution, length * sizeof(Step));
+		memcpy(readyInProgress, inProgress, length * sizeof(int));
+	}
+	pthread_mutex_lock(&wall->lock);
+	cube->readySolution = readySolution;
+	cube->readyInProgress = readyInProgress;
+	cube->readyLength = length;
+	cube->solved = 1;
+	pthread_mutex_unlock(&wall->lock);
+}
@@ -0,0 +1,24 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+// Minimal assertions for the unit tests: a failed check is reported with
+// its location and the test keeps going, then CHECK_DONE sets the exit status
+
+static int checksRun = 0;
+static int checksFailed = 0;
+
+#define CHECK(condition) do { \
+	checksRun++; \
+	if (!(condition)) { \
+		checksFailed++; \
+		fprintf(stderr, "%s:%i: check failed: %s\n", __FILE__, __LINE__, #condition); \
+	} \
+} while (0)
+
+#define CHECK_DONE(name) ( \
+	printf("%s: %i checks, %i failed\n", name, checksRun, checksFailed), \
+	checksFailed == 0 ? 0 : 1)
+
+#endif
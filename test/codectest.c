@@ -0,0 +1,88 @@
+#include <string.h>
+
+#include "cubiestate.h"
+#include "statecodec.h"
+#include "random.h"
+#include "logger.h"
+#include "check.h"
+
+#define RANDOM_STATES 1000
+#define BULK_STATES 64
+
+static int sameState(const CubieState *a, const CubieState *b);
+static void twistCorner(CubieState *state);
+
+int main() {
+	// Invalid records below are expected to log errors
+	logger_setLevel(LOG_FATAL);
+
+	// Every cube of a solved state has the identity orientation, index 0
+	CubieState solved, decoded;
+	cs_initSolved(&solved);
+	unsigned char record[STATE_BINARY_SIZE];
+	unsigned char expected[STATE_BINARY_SIZE] = {'R', 'C', 1};
+	codec_encodeBinary(&solved, record);
+	CHECK(memcmp(record, expected, STATE_BINARY_SIZE) == 0);
+	CHECK(codec_isBinary(record, STATE_BINARY_SIZE));
+	CHECK(!codec_isBinary(record, STATE_BINARY_SIZE - 1));
+	CHECK(codec_decodeBinary(&decoded, record) && sameState(&decoded, &solved));
+
+	Random random;
+	random_seed(&random, 1);
+	int roundTrips = 0;
+	for (int i=0; i<RANDOM_STATES; i++) {
+		CubieState state;
+		cs_randomize(&state, &random);
+		codec_encodeBinary(&state, record);
+		roundTrips += codec_decodeBinary(&decoded, record) && sameState(&decoded, &state);
+	}
+	CHECK(roundTrips == RANDOM_STATES);
+
+	CubieState states[BULK_STATES], bulkDecoded[BULK_STATES];
+	unsigned char records[BULK_STATES * STATE_BINARY_SIZE];
+	for (int i=0; i<BULK_STATES; i++) {
+		cs_randomize(&states[i], &random);
+	}
+	codec_encodeBinaryBulk(states, BULK_STATES, records);
+	codec_encodeBinary(&states[5], record);
+	CHECK(memcmp(records + 5*STATE_BINARY_SIZE, record, STATE_BINARY_SIZE) == 0);
+	CHECK(codec_decodeBinaryBulk(bulkDecoded, BULK_STATES, records) == BULK_STATES);
+	CHECK(sameState(&bulkDecoded[BULK_STATES-1], &states[BULK_STATES-1]));
+	// Decoding stops at the first bad record
+	records[10*STATE_BINARY_SIZE] = 'X';
+	CHECK(codec_decodeBinaryBulk(bulkDecoded, BULK_STATES, records) == 10);
+
+	codec_encodeBinary(&solved, record);
+	record[0] = 'X';
+	CHECK(!codec_decodeBinary(&decoded, record));
+	codec_encodeBinary(&solved, record);
+	record[2] = STATE_BINARY_VERSION + 1;
+	CHECK(!codec_decodeBinary(&decoded, record));
+	// Orientation 31 is out of range
+	codec_encodeBinary(&solved, record);
+	record[STATE_BINARY_HEADER_SIZE] |= 0x1F;
+	CHECK(!codec_decodeBinary(&decoded, record));
+	// Bits past the last cube must be zero
+	codec_encodeBinary(&solved, record);
+	record[STATE_BINARY_SIZE-1] |= 0x80;
+	CHECK(!codec_decodeBinary(&decoded, record));
+
+	CubieState twisted = solved;
+	twistCorner(&twisted);
+	codec_encodeBinary(&twisted, record);
+	CHECK(!codec_decodeBinary(&decoded, record));
+
+	return CHECK_DONE("codectest");
+}
+
+static int sameState(const CubieState *a, const CubieState *b) {
+	return memcmp(a->cubeAt, b->cubeAt, NUM_CUBES) == 0
+		&& memcmp(a->orientation, b->orientation, NUM_CUBES) == 0;
+}
+
+static void twistCorner(CubieState *state) {
+	CubieCoords coords;
+	cs_toCoords(state, &coords);
+	coords.cornerTwist[0] = (coords.cornerTwist[0] + 1) % 3;
+	cs_fromCoords(state, &coords);
+}
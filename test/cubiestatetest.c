@@ -0,0 +1,59 @@
+#include "cubiestate.h"
+#include "check.h"
+
+static void twistCorners(CubieCoords *coords);
+static void flipEdges(CubieCoords *coords);
+static int solvedAfter(void (*change)(CubieCoords *coords));
+static int orderOfRU();
+
+int main() {
+	CubieState state;
+	cs_initSolved(&state);
+	CHECK(cs_checkSolved(&state));
+	cs_rotateFace(&state, RIGHT_FACE, CLOCKWISE);
+	CHECK(!cs_checkSolved(&state));
+	cs_rotateFace(&state, RIGHT_FACE, COUNTERCLOCKWISE);
+	CHECK(cs_checkSolved(&state));
+
+	// Every piece at home is not enough, each must be unturned too
+	CHECK(!solvedAfter(twistCorners));
+	CHECK(!solvedAfter(flipEdges));
+
+	// (R U)^35 brings every piece home but leaves corners twisted
+	CHECK(orderOfRU() == 105);
+
+	return CHECK_DONE("cubiestatetest");
+}
+
+static void twistCorners(CubieCoords *coords) {
+	coords->cornerTwist[0] = 1;
+	coords->cornerTwist[1] = 2;
+}
+
+static void flipEdges(CubieCoords *coords) {
+	coords->edgeFlip[0] = 1;
+	coords->edgeFlip[1] = 1;
+}
+
+static int solvedAfter(void (*change)(CubieCoords *coords)) {
+	CubieState state;
+	CubieCoords coords;
+	cs_initSolved(&state);
+	cs_toCoords(&state, &coords);
+	change(&coords);
+	cs_fromCoords(&state, &coords);
+	return cs_checkSolved(&state);
+}
+
+static int orderOfRU() {
+	CubieState state;
+	cs_initSolved(&state);
+	for (int order=1; order<=1260; order++) {
+		cs_rotateFace(&state, RIGHT_FACE, CLOCKWISE);
+		cs_rotateFace(&state, UP_FACE, CLOCKWISE);
+		if (cs_checkSolved(&state)) {
+			return order;
+		}
+	}
+	return -1;
+}
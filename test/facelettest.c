@@ -0,0 +1,125 @@
+#include <string.h>
+
+#include "cubiestate.h"
+#include "facelet.h"
+#include "random.h"
+#include "check.h"
+
+#define RANDOM_STATES 1000
+
+static const char *solvedFacelets = "UUUUUUUUURRRRRRRRRFFFFFFFFFDDDDDDDDDLLLLLLLLLBBBBBBBBB";
+
+// Known strings after one clockwise turn from solved
+static const struct {
+	int face;
+	const char *facelets;
+} turns[] = {
+	{ RIGHT_FACE, "UUFUUFUUFRRRRRRRRRFFDFFDFFDDDBDDBDDBLLLLLLLLLUBBUBBUBB" },
+	{ UP_FACE, "UUUUUUUUUBBBRRRRRRRRRFFFFFFDDDDDDDDDFFFLLLLLLLLLBBBBBB" },
+	{ FRONT_FACE, "UUUUUULLLURRURRURRFFFFFFFFFRRRDDDDDDLLDLLDLLDBBBBBBBBB" },
+};
+
+static void checkDecode(const char *facelets, int expected);
+static void checkCoords(void (*change)(CubieCoords *coords), int expected);
+static void twistCorner(CubieCoords *coords);
+static void flipEdge(CubieCoords *coords);
+static void swapEdges(CubieCoords *coords);
+
+int main() {
+	CubieState state, decoded;
+	char facelets[FACELET_COUNT];
+	cs_initSolved(&state);
+	facelet_encode(&state, facelets);
+	CHECK(memcmp(facelets, solvedFacelets, FACELET_COUNT) == 0);
+	CHECK(facelet_decode(&decoded, solvedFacelets, FACELET_COUNT) == FACELET_OK);
+	CHECK(cs_checkSolved(&decoded));
+
+	for (int i=0; i<(int)(sizeof(turns) / sizeof(turns[0])); i++) {
+		cs_initSolved(&state);
+		cs_rotateFace(&state, turns[i].face, CLOCKWISE);
+		facelet_encode(&state, facelets);
+		CHECK(memcmp(facelets, turns[i].facelets, FACELET_COUNT) == 0);
+		CHECK(facelet_decode(&decoded, turns[i].facelets, FACELET_COUNT) == FACELET_OK);
+		CHECK(memcmp(decoded.cubeAt, state.cubeAt, NUM_CUBES) == 0);
+	}
+
+	Random random;
+	random_seed(&random, 2);
+	int roundTrips = 0;
+	for (int i=0; i<RANDOM_STATES; i++) {
+		cs_randomize(&state, &random);
+		facelet_encode(&state, facelets);
+		roundTrips += facelet_decode(&decoded, facelets, FACELET_COUNT) == FACELET_OK
+			&& memcmp(decoded.cubeAt, state.cubeAt, NUM_CUBES) == 0
+			&& memcmp(decoded.orientation, state.orientation, NUM_CUBES) == 0;
+	}
+	CHECK(roundTrips == RANDOM_STATES);
+
+	CHECK(facelet_decode(&decoded, solvedFacelets, FACELET_COUNT - 1) == FACELET_ERROR_LENGTH);
+	char bad[FACELET_COUNT + 1];
+	strcpy(bad, solvedFacelets);
+	bad[0] = 'X';
+	checkDecode(bad, FACELET_ERROR_CHARACTER);
+	strcpy(bad, solvedFacelets);
+	bad[0] = 'R';
+	checkDecode(bad, FACELET_ERROR_COUNT);
+	// Swapping two centers keeps the counts right
+	strcpy(bad, solvedFacelets);
+	bad[4] = 'R';
+	bad[13] = 'U';
+	checkDecode(bad, FACELET_ERROR_CENTERS);
+	// U and D stickers can't share a corner or an edge
+	strcpy(bad, solvedFacelets);
+	bad[8] = 'D';
+	bad[29] = 'U';
+	checkDecode(bad, FACELET_ERROR_CORNER);
+	strcpy(bad, solvedFacelets);
+	bad[10] = 'D';
+	bad[28] = 'R';
+	checkDecode(bad, FACELET_ERROR_EDGE);
+
+	checkCoords(twistCorner, FACELET_ERROR_TWIST);
+	checkCoords(flipEdge, FACELET_ERROR_FLIP);
+	checkCoords(swapEdges, FACELET_ERROR_PARITY);
+
+	CHECK(strcmp(facelet_errorString(FACELET_ERROR_PARITY), "corner and edge parity do not match") == 0);
+	CHECK(strcmp(facelet_errorString(1), "unknown error") == 0);
+
+	return CHECK_DONE("facelettest");
+}
+
+static void checkDecode(const char *facelets, int expected) {
+	CubieState state;
+	int error = facelet_decode(&state, facelets, FACELET_COUNT);
+	CHECK(error == expected);
+	if (error != expected) {
+		fprintf(stderr, "\t%s: got %i, expected %i\n", facelets, error, expected);
+	}
+}
+
+// Encode a solved cube changed in one way that no turns can reach
+static void checkCoords(void (*change)(CubieCoords *coords), int expected) {
+	CubieState state;
+	CubieCoords coords;
+	cs_initSolved(&state);
+	cs_toCoords(&state, &coords);
+	change(&coords);
+	cs_fromCoords(&state, &coords);
+	char facelets[FACELET_COUNT + 1];
+	facelet_encode(&state, facelets);
+	facelets[FACELET_COUNT] = '\0';
+	checkDecode(facelets, expected);
+}
+
+static void twistCorner(CubieCoords *coords) {
+	coords->cornerTwist[3] = 2;
+}
+
+static void flipEdge(CubieCoords *coords) {
+	coords->edgeFlip[7] = 1;
+}
+
+static void swapEdges(CubieCoords *coords) {
+	coords->edgePerm[0] = 1;
+	coords->edgePerm[1] = 0;
+}
@@ -0,0 +1,78 @@
+#include <string.h>
+
+#include "rubiks.h"
+#include "cubiestate.h"
+#include "notation.h"
+#include "check.h"
+
+#define MAX_STEPS 64
+#define TEXT_SIZE 256
+
+static int parse(const char *text, Step *steps, int *errorOffset);
+static void applyScramble(CubieState *state, int frame[NUM_FACES], const Step *steps, int count);
+
+int main() {
+	Step steps[MAX_STEPS];
+	int errorOffset = -1;
+	CHECK(parse("", steps, NULL) == 0);
+	CHECK(parse("  \t ", steps, NULL) == 0);
+
+	CHECK(parse("R U2 F'", steps, NULL) == 4);
+	CHECK(steps[0].face == RIGHT_FACE && steps[0].direction == CLOCKWISE);
+	CHECK(steps[1].face == UP_FACE && steps[2].face == UP_FACE && steps[2].direction == CLOCKWISE);
+	CHECK(steps[3].face == FRONT_FACE && steps[3].direction == COUNTERCLOCKWISE);
+
+	// Separators are optional; r and Rw are the same move
+	CHECK(parse("RUR'U'", steps, NULL) == 4);
+	CHECK(steps[2].face == RIGHT_FACE && steps[2].direction == COUNTERCLOCKWISE);
+	CHECK(parse("Rw r M E S x y z", steps, NULL) == 8);
+	CHECK(steps[0].face == WIDE_MOVES + RIGHT_FACE && steps[1].face == WIDE_MOVES + RIGHT_FACE);
+	CHECK(steps[2].face == SLICE_M && steps[3].face == SLICE_E && steps[4].face == SLICE_S);
+	CHECK(steps[5].face == ROTATE_X && steps[6].face == ROTATE_Y && steps[7].face == ROTATE_Z);
+	CHECK(parse("U2'", steps, NULL) == 2 && steps[1].direction == COUNTERCLOCKWISE);
+
+	CHECK(parse("R U Q", steps, &errorOffset) == NOTATION_ERROR_SYNTAX && errorOffset == 4);
+	CHECK(notation_parse("R U R U", 7, steps, 3, &errorOffset) == NOTATION_ERROR_OVERFLOW && errorOffset == 6);
+	CHECK(strcmp(notation_errorString(NOTATION_ERROR_SYNTAX), "unrecognized move") == 0);
+
+	// Formatting merges repeated quarter turns and drops those that cancel
+	char text[TEXT_SIZE];
+	int count = parse("R R U U U F F' B2 B2 D", steps, NULL);
+	CHECK(notation_format(steps, count, text, TEXT_SIZE) == 7 && strcmp(text, "R2 U' D") == 0);
+	count = parse("R U2 F' x", steps, NULL);
+	CHECK(notation_format(steps, count, text, TEXT_SIZE) > 0 && strcmp(text, "R U2 F' x") == 0);
+	CHECK(notation_format(steps, count, text, 4) == -1);
+	CHECK(notation_format(steps, 0, text, TEXT_SIZE) == 0 && text[0] == '\0');
+
+	// R U R' U' six times is the identity, and a scramble followed by
+	// its inverse always is, read through the frame the scramble left
+	CubieState state;
+	int frame[NUM_FACES] = {0, 1, 2, 3, 4, 5};
+	cs_initSolved(&state);
+	count = parse("R U R' U' R U R' U' R U R' U' R U R' U' R U R' U' R U R' U'", steps, NULL);
+	applyScramble(&state, frame, steps, count);
+	CHECK(cs_checkSolved(&state));
+	count = parse("r U2 M' x D S' y F' z", steps, NULL);
+	applyScramble(&state, frame, steps, count);
+	CHECK(!cs_checkSolved(&state));
+	count = parse("z' F y' S D' x' M U2 r'", steps, NULL);
+	applyScramble(&state, frame, steps, count);
+	CHECK(cs_checkSolved(&state));
+
+	return CHECK_DONE("notationtest");
+}
+
+static int parse(const char *text, Step *steps, int *errorOffset) {
+	return notation_parse(text, strlen(text), steps, MAX_STEPS, errorOffset);
+}
+
+// Applies moves the way rubiks-scramble does, turning physical faces
+static void applyScramble(CubieState *state, int frame[NUM_FACES], const Step *steps, int count) {
+	for (int i=0; i<count; i++) {
+		Step turns[2];
+		int turnCount = rc_resolveMove(frame, steps[i].face, steps[i].direction, turns);
+		for (int t=0; t<turnCount; t++) {
+			cs_rotateFace(state, turns[t].face, turns[t].direction);
+		}
+	}
+}
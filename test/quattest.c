@@ -83,6 +83,7 @@ int main() {
 		numPassed += test(cases[i]);
 	}
 	log_info("Test complete. Passed %i out of %i test cases.", numPassed, NUM_CASES);
+	return numPassed == NUM_CASES ? 0 : 1;
 }
 
 int test(TestCase c) {
@@ -94,11 +95,11 @@ int test(TestCase c) {
 		if ((c.rotations[i].x + c.rotations[i].y + c.rotations[i].z) == 0)
 			continue;
 		Quaternion qRot;
-		quatInitEuler(&qRot, c.rotations[i]);
+		quat_initEuler(&qRot, c.rotations[i]);
 		log_info("Applying rotation #%i", i);
 		log_info("Rotation angles:              {%f, %f, %f}", c.rotations[i].x, c.rotations[i].y, c.rotations[i].z);
 		log_info("Quaternion from angles:       {%f, %f, %f, %f}", qRot.x, qRot.y, qRot.z, qRot.w);
-		result = quatVecMultiply(&qRot, result);
+		result = quat_vecMultiply(&qRot, result);
 		log_info("Vector, rotated:              {%f, %f, %f}", result.x, result.y, result.z);
 		log_info("Vector, expected:             {%f, %f, %f}", c.expected[i].x, c.expected[i].y, c.expected[i].z);
 		isEqual &= vec3fCompare(result, c.expected[i]);
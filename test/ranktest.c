@@ -0,0 +1,63 @@
+#include <string.h>
+
+#include "cubiestate.h"
+#include "staterank.h"
+#include "random.h"
+#include "check.h"
+
+#define RANDOM_STATES 1000
+
+static int sameState(const CubieState *a, const CubieState *b);
+
+int main() {
+	CubieState state, unranked;
+	char text[RANK_STRING_SIZE];
+	cs_initSolved(&state);
+	StateRank rank = rank_fromState(&state);
+	CHECK(rank.high == 0 && rank.low == 0);
+	rank_toString(rank, text);
+	CHECK(strcmp(text, "0") == 0);
+
+	// The last rank is one less than the number of reachable states
+	StateRank last = {RANK_COUNT_HIGH, RANK_COUNT_LOW - 1};
+	StateRank count = {RANK_COUNT_HIGH, RANK_COUNT_LOW};
+	CHECK(rank_isValid(last));
+	CHECK(!rank_isValid(count));
+	CHECK(!rank_toState(&unranked, count));
+	rank_toString(last, text);
+	CHECK(strcmp(text, "43252003274489855999") == 0);
+	StateRank parsed;
+	CHECK(rank_fromString(&parsed, text, strlen(text)) && rank_compare(parsed, last) == 0);
+	CHECK(!rank_fromString(&parsed, "43252003274489856000", 20));
+	CHECK(!rank_fromString(&parsed, "12a", 3));
+	CHECK(!rank_fromString(&parsed, "", 0));
+	CHECK(rank_toState(&unranked, last) && rank_compare(rank_fromState(&unranked), last) == 0);
+
+	// A turn also twists its center, which ranks leave out
+	cs_rotateFace(&state, RIGHT_FACE, CLOCKWISE);
+	rank = rank_fromState(&state);
+	CHECK(rank.high != 0 || rank.low != 0);
+	CHECK(rank_toState(&unranked, rank) && memcmp(unranked.cubeAt, state.cubeAt, NUM_CUBES) == 0);
+	CHECK(rank_compare(rank_fromState(&unranked), rank) == 0);
+	CHECK(rank_compare(rank, last) < 0 && rank_compare(last, rank) > 0);
+
+	Random random;
+	random_seed(&random, 3);
+	int roundTrips = 0;
+	for (int i=0; i<RANDOM_STATES; i++) {
+		cs_randomize(&state, &random);
+		rank = rank_fromState(&state);
+		rank_toString(rank, text);
+		roundTrips += rank_isValid(rank)
+			&& rank_toState(&unranked, rank) && sameState(&unranked, &state)
+			&& rank_fromString(&parsed, text, strlen(text)) && rank_compare(parsed, rank) == 0;
+	}
+	CHECK(roundTrips == RANDOM_STATES);
+
+	return CHECK_DONE("ranktest");
+}
+
+static int sameState(const CubieState *a, const CubieState *b) {
+	return memcmp(a->cubeAt, b->cubeAt, NUM_CUBES) == 0
+		&& memcmp(a->orientation, b->orientation, NUM_CUBES) == 0;
+}
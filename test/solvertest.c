@@ -0,0 +1,70 @@
+#include "rubiks.h"
+#include "cubiestate.h"
+#include "random.h"
+#include "logger.h"
+#include "controller/solvercontroller.h"
+#include "check.h"
+
+#define RANDOM_STATES 100
+#define MAX_STEPS 2048
+
+static int solvedBy(const CubieState *start, const Step *solution, int count);
+static void twistCorners(CubieState *state);
+static int stageTotal(const SolverStats *stats, int halfTurns);
+
+int main() {
+	logger_setLevel(LOG_WARN);
+	Random random;
+	random_seed(&random, 4);
+	Step solution[MAX_STEPS];
+	int solves = 0;
+	int twistedSolves = 0;
+	int additive = 0;
+	for (int i=0; i<RANDOM_STATES; i++) {
+		CubieState start;
+		Rubiks rubiks;
+		cs_randomize(&start, &random);
+		rc_initialize(&rubiks);
+		cs_toRubiks(&start, &rubiks);
+		SolverStats stats;
+		int count = solver_computeSolution(&rubiks, solution, NULL, MAX_STEPS, &stats);
+		solves += count >= 0 && solvedBy(&start, solution, count);
+		additive += stageTotal(&stats, 0) == stats.quarterTurns && stageTotal(&stats, 1) == stats.halfTurns;
+
+		// The same moves from a start with two corners twisted in place
+		// bring every piece home but leave those corners turned
+		twistCorners(&start);
+		twistedSolves += count >= 0 && solvedBy(&start, solution, count);
+	}
+	CHECK(solves == RANDOM_STATES);
+	CHECK(twistedSolves == 0);
+	// Same-face runs crossing stages are credited to one of them
+	CHECK(additive == RANDOM_STATES);
+
+	return CHECK_DONE("solvertest");
+}
+
+// Solutions from an unrotated cube turn physical faces
+static int solvedBy(const CubieState *start, const Step *solution, int count) {
+	CubieState state = *start;
+	for (int i=0; i<count; i++) {
+		cs_rotateFace(&state, solution[i].face, solution[i].direction);
+	}
+	return cs_checkSolved(&state);
+}
+
+static void twistCorners(CubieState *state) {
+	CubieCoords coords;
+	cs_toCoords(state, &coords);
+	coords.cornerTwist[0] = (coords.cornerTwist[0] + 1) % 3;
+	coords.cornerTwist[1] = (coords.cornerTwist[1] + 2) % 3;
+	cs_fromCoords(state, &coords);
+}
+
+static int stageTotal(const SolverStats *stats, int halfTurns) {
+	int total = 0;
+	for (int stage=0; stage<SOLVER_NUM_STAGES; stage++) {
+		total += halfTurns ? stats->stages[stage].halfTurns : stats->stages[stage].quarterTurns;
+	}
+	return total;
+}
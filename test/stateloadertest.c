@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "rubiks.h"
+#include "cubiestate.h"
+#include "stateloader.h"
+#include "random.h"
+#include "logger.h"
+#include "check.h"
+
+#define RANDOM_STATES 100
+#define MAX_LINE 2048
+
+static int parsesAs(const CubieState *state, const CubieState *expected);
+static int parsesAfter(void (*change)(CubieCoords *coords));
+static void twistCorner(CubieCoords *coords);
+static void flipEdge(CubieCoords *coords);
+static void swapEdges(CubieCoords *coords);
+
+int main() {
+	// Rejected states below are expected to log errors
+	logger_setLevel(LOG_FATAL);
+
+	CubieState solved;
+	cs_initSolved(&solved);
+	CHECK(parsesAs(&solved, &solved));
+
+	Random random;
+	random_seed(&random, 5);
+	int roundTrips = 0;
+	for (int i=0; i<RANDOM_STATES; i++) {
+		CubieState state;
+		cs_randomize(&state, &random);
+		roundTrips += parsesAs(&state, &state);
+	}
+	CHECK(roundTrips == RANDOM_STATES);
+
+	// Dumps of states no sequence of turns reaches
+	CHECK(!parsesAfter(twistCorner));
+	CHECK(!parsesAfter(flipEdge));
+	CHECK(!parsesAfter(swapEdges));
+
+	// A corner rotated as if it sat in another slot
+	CubieState moved = solved;
+	moved.orientation[cornerSlots[0]] = cs_faceTurn(UP_FACE, CLOCKWISE);
+	CHECK(!parsesAs(&moved, NULL));
+
+	// The whole cube turned, centers included
+	CubieState turned;
+	int turn = cs_faceTurn(UP_FACE, CLOCKWISE);
+	for (int id=0; id<NUM_CUBES; id++) {
+		turned.cubeAt[cs_orientationPosition(turn, id)] = id;
+		turned.orientation[cs_orientationPosition(turn, id)] = turn;
+	}
+	CHECK(!parsesAs(&turned, NULL));
+
+	return CHECK_DONE("stateloadertest");
+}
+
+// Write state the way rc_writeState dumps it and parse it back. With no
+// expected state, only whether it parsed is returned.
+static int parsesAs(const CubieState *state, const CubieState *expected) {
+	Rubiks rubiks;
+	rc_initialize(&rubiks);
+	cs_toRubiks(state, &rubiks);
+	FILE *fp = tmpfile();
+	if (fp == NULL) {
+		return 0;
+	}
+	char line[MAX_LINE];
+	rc_writeState(&rubiks, fp);
+	rewind(fp);
+	int read = fgets(line, MAX_LINE, fp) != NULL;
+	fclose(fp);
+	CubieState parsed;
+	if (!read || !loader_parseQuaternionState(&parsed, line, strcspn(line, "\n"))) {
+		return 0;
+	}
+	return expected == NULL || (memcmp(parsed.cubeAt, expected->cubeAt, NUM_CUBES) == 0
+		&& memcmp(parsed.orientation, expected->orientation, NUM_CUBES) == 0);
+}
+
+static int parsesAfter(void (*change)(CubieCoords *coords)) {
+	CubieState state;
+	CubieCoords coords;
+	cs_initSolved(&state);
+	cs_toCoords(&state, &coords);
+	change(&coords);
+	cs_fromCoords(&state, &coords);
+	return parsesAs(&state, NULL);
+}
+
+static void twistCorner(CubieCoords *coords) {
+	coords->cornerTwist[0] = 1;
+}
+
+static void flipEdge(CubieCoords *coords) {
+	coords->edgeFlip[0] = 1;
+}
+
+static void swapEdges(CubieCoords *coords) {
+	coords->edgePerm[0] = 1;
+	coords->edgePerm[1] = 0;
+}
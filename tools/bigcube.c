@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bigcube.h"
+#include "rubiks.h"
+#include "random.h"
+#include "timer.h"
+#include "view/softrender.h"
+#include "logger.h"
+
+// Scrambles an NxN cube with random layer turns and reports the turn rate,
+// optionally undoing the scramble to check it comes back solved and
+// rendering the scrambled cube to an image.
+
+typedef struct {
+	unsigned char face;
+	unsigned char direction;
+	unsigned short layer;
+} Turn;
+
+static void printUsage(const char *name);
+static int writeImage(BigCube *cube, const char *fileName, int width, int height, Vec2d camera);
+
+int main(int argc, char *argv[]) {
+	int size = 7;
+	long turns = 1000000;
+	unsigned int seed = time(NULL);
+	int undo = 0;
+	const char *image = NULL;
+	int width = 800;
+	int height = 800;
+	Vec2d camera = {-30, 30};
+	int invalid = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:m:r:uo:g:c:h")) != -1) {
+		switch (opt) {
+			case 'n':
+				size = atoi(optarg);
+				break;
+			case 'm':
+				turns = atol(optarg);
+				break;
+			case 'r':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			case 'u':
+				undo = 1;
+				break;
+			case 'o':
+				image = optarg;
+				break;
+			case 'g':
+				invalid |= sscanf(optarg, "%dx%d", &width, &height) != 2;
+				break;
+			case 'c':
+				invalid |= sscanf(optarg, "%lf,%lf", &camera.x, &camera.y) != 2;
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (invalid || optind != argc || turns < 0 || width <= 0 || height <= 0) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	BigCube cube;
+	if (!bc_init(&cube, size)) {
+		return EXIT_FAILURE;
+	}
+
+	// Turns are drawn up front so the timing covers only the engine
+	Random random;
+	random_seed(&random, seed);
+	Turn *scramble = malloc(turns * sizeof(Turn));
+	if (scramble == NULL) {
+		log_error("Unable to allocate %li turns", turns);
+		return EXIT_FAILURE;
+	}
+	for (long i=0; i<turns; i++) {
+		scramble[i].face = random_below(&random, NUM_FACES);
+		scramble[i].layer = random_below(&random, size);
+		scramble[i].direction = random_below(&random, 2);
+	}
+
+	double start = timer_now();
+	for (long i=0; i<turns; i++) {
+		bc_turn(&cube, scramble[i].face, scramble[i].layer, scramble[i].direction ? CLOCKWISE : COUNTERCLOCKWISE);
+	}
+	double seconds = timer_now() - start;
+	fprintf(stderr, "%ix%i: %li turns in %.3fs (%.0f turns/s, %.1f ns/turn)\n", size, size, turns, seconds,
+		seconds > 0 ? turns / seconds : 0, turns > 0 ? seconds * 1e9 / turns : 0);
+
+	int ok = 1;
+	if (image != NULL) {
+		ok = writeImage(&cube, image, width, height, camera);
+	}
+	if (undo) {
+		for (long i=turns-1; i>=0; i--) {
+			bc_turn(&cube, scramble[i].face, scramble[i].layer, scramble[i].direction ? COUNTERCLOCKWISE : CLOCKWISE);
+		}
+		int solved = bc_checkSolved(&cube);
+		fprintf(stderr, "Undone: %s\n", solved ? "solved" : "NOT SOLVED");
+		ok = ok && solved;
+	}
+
+	free(scramble);
+	bc_free(&cube);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void printUsage(const char *name) {
+	fprintf(stderr, "Usage: %s [-n size] [-m turns] [-r seed] [-u] [-o image] [-g WxH] [-c camx,camy]\n", name);
+	fprintf(stderr, "\tScrambles a size x size cube (%i to %i) with random layer turns and prints the\n",
+		BIGCUBE_MIN_SIZE, BIGCUBE_MAX_SIZE);
+	fprintf(stderr, "\tturn rate. -u undoes the scramble and fails unless the cube is solved again;\n");
+	fprintf(stderr, "\t-o renders the scrambled cube, as PNG for .png names and PPM otherwise.\n");
+}
+
+static int writeImage(BigCube *cube, const char *fileName, int width, int height, Vec2d camera) {
+	Framebuffer fb;
+	if (!sr_initFramebuffer(&fb, width, height)) {
+		return 0;
+	}
+	int ok = sr_drawBigCube(&fb, cube, camera);
+	FILE *fp = fopen(fileName, "wb");
+	if (fp == NULL) {
+		log_error("Unable to open image file: %s", fileName);
+		sr_freeFramebuffer(&fb);
+		return 0;
+	}
+	size_t length = strlen(fileName);
+	if (length >= 4 && strcmp(fileName + length - 4, ".png") == 0) {
+		ok = sr_writePNG(&fb, fp) && ok;
+	} else {
+		ok = sr_writePPM(&fb, fp) && ok;
+	}
+	ok = fclose(fp) == 0 && ok;
+	sr_freeFramebuffer(&fb);
+	return ok;
+}
@@ -0,0 +1,632 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "rubiks.h"
+#include "cubiestate.h"
+#include "timer.h"
+#include "logger.h"
+#include "trace.h"
+
+// Counts the distinct states at each depth from solved, in the half turn
+// and quarter turn metrics, by breadth first search over packed cubie
+// coordinates. Worker threads expand a level into sorted runs on disk,
+// which are merged with the two previous levels to drop states already
+// seen, so only the run buffers have to fit in memory. Finished levels
+// are kept on disk and a later run resumes from the deepest pair.
+
+#define METRIC_HALF 0
+#define METRIC_QUARTER 1
+#define NUM_METRICS 2
+#define MAX_METRIC_MOVES 18
+
+#define READ_BLOCK 4096 // frontier keys handed to a worker at a time
+#define MERGE_BLOCK 4096 // keys buffered per merge input and for output
+#define MIN_RUN_KEYS 4096
+#define LEVEL_MAGIC 0x46444352u // "RCDF"
+#define FILE_NAME_SIZE 1024
+
+// Corners and edges packed 5 bits per slot, permutation above orientation,
+// so keys compare and sort as two words
+typedef struct {
+	uint64_t corners;
+	uint64_t edges;
+} StateKey;
+
+// Level and run files are a header followed by count sorted, distinct keys,
+// in host byte order
+typedef struct {
+	uint32_t magic;
+	uint32_t depth;
+	uint64_t count;
+} LevelHeader;
+
+typedef struct {
+	const char *name;
+	int count;
+	CubieCoords moves[MAX_METRIC_MOVES];
+} Metric;
+
+// Shared by the workers expanding one level
+typedef struct {
+	const Metric *metric;
+	const char *directory;
+	int depth; // of the level being generated
+	FILE *frontier;
+	size_t runKeys;
+	int runs;
+	int ok;
+	pthread_mutex_t lock;
+} Expansion;
+
+typedef struct {
+	FILE *fp;
+	StateKey keys[MERGE_BLOCK];
+	size_t count;
+	size_t next;
+	int ok;
+} KeyReader;
+
+static void printUsage(const char *name);
+static void initMetric(Metric *metric, int which);
+static void applyMove(const CubieCoords *state, const CubieCoords *move, CubieCoords *out);
+static StateKey packKey(const CubieCoords *coords);
+static void unpackKey(StateKey key, CubieCoords *coords);
+static int compareKeys(const void *a, const void *b);
+static int keyLess(StateKey a, StateKey b);
+static int keyEqual(StateKey a, StateKey b);
+static size_t sortUnique(StateKey *keys, size_t count);
+static void levelFileName(char *out, const char *directory, const Metric *metric, int depth);
+static void runFileName(char *out, const char *directory, const Metric *metric, int depth, int run);
+static int readLevelCount(const char *fileName, int depth, uint64_t *count);
+static int writeKeys(const char *fileName, int depth, const StateKey *keys, size_t count);
+static void removeStaleRuns(const Metric *metric, const char *directory, int depth);
+static int searchMetric(const Metric *metric, const char *directory, int maxDepth, int threads, size_t memory);
+static int64_t expandLevel(const Metric *metric, const char *directory, int depth, int threads, size_t memory);
+static void *expandWorker(void *arg);
+static int writeRun(Expansion *expansion, StateKey *keys, size_t count);
+static int64_t mergeLevel(const Metric *metric, const char *directory, int depth, int runs);
+static int openReader(KeyReader *reader, const char *fileName, int depth);
+static const StateKey *peekKey(KeyReader *reader);
+static int readerHas(KeyReader *reader, StateKey key);
+static void siftDown(KeyReader **heap, int size, int i);
+
+int main(int argc, char *argv[]) {
+	int maxDepth = 6;
+	int metrics[NUM_METRICS] = {1, 1};
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	long megabytes = 1024;
+	const char *directory = "depth";
+	const char *logSpec = "warn";
+	int opt;
+	while ((opt = getopt(argc, argv, "d:t:j:M:o:L:h")) != -1) {
+		switch (opt) {
+			case 'd':
+				maxDepth = atoi(optarg);
+				break;
+			case 't':
+				metrics[METRIC_HALF] = strcmp(optarg, "half") == 0 || strcmp(optarg, "both") == 0;
+				metrics[METRIC_QUARTER] = strcmp(optarg, "quarter") == 0 || strcmp(optarg, "both") == 0;
+				break;
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'M':
+				megabytes = atol(optarg);
+				break;
+			case 'o':
+				directory = optarg;
+				break;
+			case 'L':
+				logSpec = optarg;
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind != argc || maxDepth < 0 || megabytes < 1 || !(metrics[METRIC_HALF] || metrics[METRIC_QUARTER])
+			|| !logger_configure(logSpec)) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+		log_error("Unable to create frontier directory: %s", directory);
+		return EXIT_FAILURE;
+	}
+	if (!trace_init()) {
+		return EXIT_FAILURE;
+	}
+
+	for (int which=0; which<NUM_METRICS; which++) {
+		if (!metrics[which]) {
+			continue;
+		}
+		Metric metric;
+		initMetric(&metric, which);
+		if (!searchMetric(&metric, directory, maxDepth, threads, (size_t)megabytes << 20)) {
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+static void printUsage(const char *name) {
+	fprintf(stderr, "Usage: %s [-d max depth] [-t half|quarter|both] [-j threads] [-M megabytes] [-o dir] [-L log spec]\n", name);
+	fprintf(stderr, "\tCounts the distinct states at each depth from solved, up to max depth (default 6).\n");
+	fprintf(stderr, "\tLevels are written to dir (default depth) and a rerun resumes from them, so\n");
+	fprintf(stderr, "\tdeep searches need disk space of 16 bytes per state. Megabytes bounds the run\n");
+	fprintf(stderr, "\tbuffers shared by the threads (default 1024).\n");
+}
+
+// The metric's moves as permutations of a solved cube, taken from the
+// cubie model so they match cs_rotateFace
+static void initMetric(Metric *metric, int which) {
+	metric->name = which == METRIC_HALF ? "half" : "quarter";
+	metric->count = 0;
+	for (int face=0; face<NUM_FACES; face++) {
+		CubieState state;
+		cs_initSolved(&state);
+		cs_rotateFace(&state, face, CLOCKWISE);
+		cs_toCoords(&state, &metric->moves[metric->count++]);
+		cs_rotateFace(&state, face, CLOCKWISE);
+		if (which == METRIC_HALF) {
+			cs_toCoords(&state, &metric->moves[metric->count++]);
+		}
+		cs_rotateFace(&state, face, CLOCKWISE);
+		cs_toCoords(&state, &metric->moves[metric->count++]);
+	}
+}
+
+static void applyMove(const CubieCoords *state, const CubieCoords *move, CubieCoords *out) {
+	static const unsigned char twistSum[6] = {0, 1, 2, 0, 1, 2};
+	for (int i=0; i<NUM_CORNERS; i++) {
+		int from = move->cornerPerm[i];
+		out->cornerPerm[i] = state->cornerPerm[from];
+		out->cornerTwist[i] = twistSum[state->cornerTwist[from] + move->cornerTwist[i]];
+	}
+	for (int i=0; i<NUM_EDGES; i++) {
+		int from = move->edgePerm[i];
+		out->edgePerm[i] = state->edgePerm[from];
+		out->edgeFlip[i] = state->edgeFlip[from] ^ move->edgeFlip[i];
+	}
+}
+
+static StateKey packKey(const CubieCoords *coords) {
+	StateKey key = {0, 0};
+	for (int i=0; i<NUM_CORNERS; i++) {
+		key.corners = key.corners << 5 | coords->cornerPerm[i] << 2 | coords->cornerTwist[i];
+	}
+	for (int i=0; i<NUM_EDGES; i++) {
+		key.edges = key.edges << 5 | coords->edgePerm[i] << 1 | coords->edgeFlip[i];
+	}
+	return key;
+}
+
+static void unpackKey(StateKey key, CubieCoords *coords) {
+	for (int i=NUM_CORNERS-1; i>=0; i--) {
+		coords->cornerPerm[i] = (key.corners >> 2) & 7;
+		coords->cornerTwist[i] = key.corners & 3;
+		key.corners >>= 5;
+	}
+	for (int i=NUM_EDGES-1; i>=0; i--) {
+		coords->edgePerm[i] = (key.edges >> 1) & 15;
+		coords->edgeFlip[i] = key.edges & 1;
+		key.edges >>= 5;
+	}
+}
+
+static int compareKeys(const void *a, const void *b) {
+	const StateKey *x = a;
+	const StateKey *y = b;
+	return keyLess(*y, *x) - keyLess(*x, *y);
+}
+
+static int keyLess(StateKey a, StateKey b) {
+	return a.corners < b.corners || (a.corners == b.corners && a.edges < b.edges);
+}
+
+static int keyEqual(StateKey a, StateKey b) {
+	return a.corners == b.corners && a.edges == b.edges;
+}
+
+// Returns the number of distinct keys, which are left at the front
+static size_t sortUnique(StateKey *keys, size_t count) {
+	if (count == 0) {
+		return 0;
+	}
+	qsort(keys, count, sizeof(StateKey), compareKeys);
+	size_t unique = 1;
+	for (size_t i=1; i<count; i++) {
+		if (!keyEqual(keys[i], keys[unique-1])) {
+			keys[unique++] = keys[i];
+		}
+	}
+	return unique;
+}
+
+static void levelFileName(char *out, const char *directory, const Metric *metric, int depth) {
+	snprintf(out, FILE_NAME_SIZE, "%s/%s_%02i.keys", directory, metric->name, depth);
+}
+
+static void runFileName(char *out, const char *directory, const Metric *metric, int depth, int run) {
+	snprintf(out, FILE_NAME_SIZE, "%s/%s_%02i.run%i", directory, metric->name, depth, run);
+}
+
+// A level file only exists once it is complete
+static int readLevelCount(const char *fileName, int depth, uint64_t *count) {
+	FILE *fp = fopen(fileName, "rb");
+	if (fp == NULL) {
+		return 0;
+	}
+	LevelHeader header;
+	int ok = fread(&header, sizeof(header), 1, fp) == 1 && header.magic == LEVEL_MAGIC && header.depth == (uint32_t)depth;
+	fclose(fp);
+	if (!ok) {
+		log_warn("Ignoring invalid level file: %s", fileName);
+		return 0;
+	}
+	*count = header.count;
+	return 1;
+}
+
+static int writeKeys(const char *fileName, int depth, const StateKey *keys, size_t count) {
+	FILE *fp = fopen(fileName, "wb");
+	if (fp == NULL) {
+		log_error("Unable to write keys: %s", fileName);
+		return 0;
+	}
+	LevelHeader header = {LEVEL_MAGIC, depth, count};
+	int ok = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(keys, sizeof(StateKey), count, fp) == count;
+	ok = fclose(fp) == 0 && ok;
+	if (!ok) {
+		log_error("Unable to write keys: %s", fileName);
+	}
+	return ok;
+}
+
+static int searchMetric(const Metric *metric, const char *directory, int maxDepth, int threads, size_t memory) {
+	char fileName[FILE_NAME_SIZE];
+	uint64_t total = 0;
+	uint64_t count;
+	int depth = 0;
+	for ( ; depth<=maxDepth; depth++) {
+		levelFileName(fileName, directory, metric, depth);
+		if (!readLevelCount(fileName, depth, &count)) {
+			break;
+		}
+		total += count;
+		printf("%-7s %2i %15" PRIu64 " %16" PRIu64 "  (resumed)\n", metric->name, depth, count, total);
+	}
+	if (depth == 0) {
+		CubieState solved;
+		CubieCoords coords;
+		cs_initSolved(&solved);
+		cs_toCoords(&solved, &coords);
+		StateKey key = packKey(&coords);
+		if (!writeKeys(fileName, 0, &key, 1)) {
+			return 0;
+		}
+		total = 1;
+		printf("%-7s %2i %15i %16i\n", metric->name, 0, 1, 1);
+		depth = 1;
+	}
+	fflush(stdout);
+	if (depth <= maxDepth) {
+		removeStaleRuns(metric, directory, depth);
+	}
+
+	for ( ; depth<=maxDepth; depth++) {
+		double start = timer_now();
+		int64_t found = expandLevel(metric, directory, depth, threads, memory);
+		if (found < 0) {
+			return 0;
+		}
+		double seconds = timer_now() - start;
+		total += found;
+		printf("%-7s %2i %15" PRId64 " %16" PRIu64 "  %.3fs\n", metric->name, depth, found, total, seconds);
+		fflush(stdout);
+		if (found == 0) {
+			break;
+		}
+	}
+	return 1;
+}
+
+// An interrupted run leaves the runs and partial merge of the level it was
+// generating, which may number more than this run writes
+static void removeStaleRuns(const Metric *metric, const char *directory, int depth) {
+	char prefix[FILE_NAME_SIZE];
+	char partName[FILE_NAME_SIZE];
+	char fileName[FILE_NAME_SIZE];
+	int prefixLength = snprintf(prefix, sizeof(prefix), "%s_%02i.run", metric->name, depth);
+	snprintf(partName, sizeof(partName), "%s_%02i.part", metric->name, depth);
+	DIR *dir = opendir(directory);
+	if (dir == NULL) {
+		return;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, prefix, prefixLength) == 0 || strcmp(entry->d_name, partName) == 0) {
+			snprintf(fileName, sizeof(fileName), "%s/%s", directory, entry->d_name);
+			log_warn("Removing %s left by an interrupted run", fileName);
+			remove(fileName);
+		}
+	}
+	closedir(dir);
+}
+
+// Generates level depth from the frontier at depth-1, returning its size
+// or -1 on an error
+static int64_t expandLevel(const Metric *metric, const char *directory, int depth, int threads, size_t memory) {
+	char fileName[FILE_NAME_SIZE];
+	levelFileName(fileName, directory, metric, depth - 1);
+	Expansion expansion = {metric, directory, depth, fopen(fileName, "rb"), 0, 0, 1, PTHREAD_MUTEX_INITIALIZER};
+	LevelHeader header;
+	if (expansion.frontier == NULL || fread(&header, sizeof(header), 1, expansion.frontier) != 1) {
+		log_error("Unable to read frontier: %s", fileName);
+		if (expansion.frontier != NULL) {
+			fclose(expansion.frontier);
+		}
+		return -1;
+	}
+	expansion.runKeys = memory / threads / sizeof(StateKey);
+	if (expansion.runKeys < MIN_RUN_KEYS) {
+		expansion.runKeys = MIN_RUN_KEYS;
+	}
+
+	trace_begin("expand", "depth");
+	pthread_t *workers = malloc(threads * sizeof(pthread_t));
+	if (workers == NULL) {
+		log_error("Unable to allocate %i workers", threads);
+		fclose(expansion.frontier);
+		return -1;
+	}
+	int started = 0;
+	for ( ; started<threads; started++) {
+		if (pthread_create(&workers[started], NULL, expandWorker, &expansion) != 0) {
+			log_error("Unable to start depth worker %i", started);
+			pthread_mutex_lock(&expansion.lock);
+			expansion.ok = 0;
+			pthread_mutex_unlock(&expansion.lock);
+			break;
+		}
+	}
+	for (int t=0; t<started; t++) {
+		pthread_join(workers[t], NULL);
+	}
+	free(workers);
+	expansion.ok = !ferror(expansion.frontier) && expansion.ok;
+	fclose(expansion.frontier);
+	trace_end("expand", "depth");
+	if (!expansion.ok) {
+		log_error("Failed to expand level %i", depth - 1);
+		return -1;
+	}
+
+	trace_begin("merge", "depth");
+	int64_t found = mergeLevel(metric, directory, depth, expansion.runs);
+	trace_end("merge", "depth");
+	return found;
+}
+
+static void *expandWorker(void *arg) {
+	Expansion *expansion = arg;
+	const Metric *metric = expansion->metric;
+	trace_nameThread("depth worker");
+	StateKey *block = malloc(READ_BLOCK * sizeof(StateKey));
+	StateKey *run = malloc(expansion->runKeys * sizeof(StateKey));
+	int ok = block != NULL && run != NULL;
+	size_t used = 0;
+	while (ok) {
+		pthread_mutex_lock(&expansion->lock);
+		size_t count = fread(block, sizeof(StateKey), READ_BLOCK, expansion->frontier);
+		pthread_mutex_unlock(&expansion->lock);
+		if (count == 0) {
+			break;
+		}
+		for (size_t i=0; i<count && ok; i++) {
+			CubieCoords state;
+			unpackKey(block[i], &state);
+			for (int m=0; m<metric->count; m++) {
+				if (used == expansion->runKeys) {
+					ok = writeRun(expansion, run, used);
+					used = 0;
+				}
+				CubieCoords next;
+				applyMove(&state, &metric->moves[m], &next);
+				run[used++] = packKey(&next);
+			}
+		}
+	}
+	if (ok && used > 0) {
+		ok = writeRun(expansion, run, used);
+	}
+	if (!ok) {
+		pthread_mutex_lock(&expansion->lock);
+		expansion->ok = 0;
+		pthread_mutex_unlock(&expansion->lock);
+	}
+	free(block);
+	free(run);
+	return NULL;
+}
+
+static int writeRun(Expansion *expansion, StateKey *keys, size_t count) {
+	trace_begin("writeRun", "depth");
+	count = sortUnique(keys, count);
+	pthread_mutex_lock(&expansion->lock);
+	int run = expansion->runs++;
+	pthread_mutex_unlock(&expansion->lock);
+	char fileName[FILE_NAME_SIZE];
+	runFileName(fileName, expansion->directory, expansion->metric, expansion->depth, run);
+	int ok = writeKeys(fileName, expansion->depth, keys, count);
+	trace_end("writeRun", "depth");
+	return ok;
+}
+
+// Merges the runs into the level file for depth, leaving out the states
+// in the two levels before it. Neighbours of a level can only be one level
+// up or down, or in the same level, so no earlier level needs checking.
+// The runs are removed afterwards.
+static int64_t mergeLevel(const Metric *metric, const char *directory, int depth, int runs) {
+	char fileName[FILE_NAME_SIZE];
+	char partName[FILE_NAME_SIZE];
+	KeyReader *readers = calloc(runs + 2, sizeof(KeyReader));
+	KeyReader **heap = malloc((runs + 1) * sizeof(KeyReader*));
+	StateKey *out = malloc(MERGE_BLOCK * sizeof(StateKey));
+	if (readers == NULL || heap == NULL || out == NULL) {
+		log_error("Unable to allocate a merge of %i runs", runs);
+		return -1;
+	}
+
+	int ok = 1;
+	int heapSize = 0;
+	for (int run=0; run<runs && ok; run++) {
+		runFileName(fileName, directory, metric, depth, run);
+		ok = openReader(&readers[run], fileName, depth);
+		if (ok && peekKey(&readers[run]) != NULL) {
+			heap[heapSize++] = &readers[run];
+		}
+	}
+	for (int i=heapSize/2-1; i>=0; i--) {
+		siftDown(heap, heapSize, i);
+	}
+	KeyReader *previous = NULL;
+	KeyReader *current = &readers[runs+1];
+	levelFileName(fileName, directory, metric, depth - 1);
+	ok = ok && openReader(current, fileName, depth - 1);
+	if (depth >= 2) {
+		previous = &readers[runs];
+		levelFileName(fileName, directory, metric, depth - 2);
+		ok = ok && openReader(previous, fileName, depth - 2);
+	}
+
+	levelFileName(fileName, directory, metric, depth);
+	snprintf(partName, sizeof(partName), "%s/%s_%02i.part", directory, metric->name, depth);
+	FILE *fp = ok ? fopen(partName, "wb") : NULL;
+	LevelHeader header = {LEVEL_MAGIC, depth, 0};
+	ok = fp != NULL && fwrite(&header, sizeof(header), 1, fp) == 1;
+
+	StateKey last = {0, 0};
+	int haveLast = 0;
+	size_t buffered = 0;
+	while (ok && heapSize > 0) {
+		KeyReader *top = heap[0];
+		StateKey key = *peekKey(top);
+		top->next++;
+		if (peekKey(top) == NULL) {
+			heap[0] = heap[--heapSize];
+		}
+		siftDown(heap, heapSize, 0);
+
+		if (haveLast && keyEqual(key, last)) {
+			continue;
+		}
+		last = key;
+		haveLast = 1;
+		if (readerHas(current, key) || (previous != NULL && readerHas(previous, key))) {
+			continue;
+		}
+		out[buffered++] = key;
+		header.count++;
+		if (buffered == MERGE_BLOCK) {
+			ok = fwrite(out, sizeof(StateKey), buffered, fp) == buffered;
+			buffered = 0;
+		}
+	}
+	ok = ok && fwrite(out, sizeof(StateKey), buffered, fp) == buffered;
+	ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+	if (fp != NULL) {
+		ok = fclose(fp) == 0 && ok;
+	}
+	ok = ok && rename(partName, fileName) == 0;
+
+	for (int i=0; i<runs+2; i++) {
+		if (readers[i].fp != NULL) {
+			ok = ok && readers[i].ok;
+			fclose(readers[i].fp);
+		}
+	}
+	for (int run=0; run<runs; run++) {
+		runFileName(fileName, directory, metric, depth, run);
+		remove(fileName);
+	}
+	free(readers);
+	free(heap);
+	free(out);
+	if (!ok) {
+		log_error("Failed to merge level %i", depth);
+		return -1;
+	}
+	return header.count;
+}
+
+static int openReader(KeyReader *reader, const char *fileName, int depth) {
+	reader->fp = fopen(fileName, "rb");
+	reader->count = 0;
+	reader->next = 0;
+	LevelHeader header;
+	reader->ok = reader->fp != NULL && fread(&header, sizeof(header), 1, reader->fp) == 1
+		&& header.magic == LEVEL_MAGIC && header.depth == (uint32_t)depth;
+	if (!reader->ok) {
+		log_error("Unable to read keys: %s", fileName);
+	}
+	return reader->ok;
+}
+
+// NULL once the reader is exhausted
+static const StateKey *peekKey(KeyReader *reader) {
+	if (reader->next == reader->count) {
+		reader->count = fread(reader->keys, sizeof(StateKey), MERGE_BLOCK, reader->fp);
+		reader->next = 0;
+		if (reader->count == 0) {
+			reader->ok = reader->ok && !ferror(reader->fp);
+			return NULL;
+		}
+	}
+	return &reader->keys[reader->next];
+}
+
+// Keys must be asked for in increasing order
+static int readerHas(KeyReader *reader, StateKey key) {
+	const StateKey *next;
+	while ((next = peekKey(reader)) != NULL && keyLess(*next, key)) {
+		reader->next++;
+	}
+	return next != NULL && keyEqual(*next, key);
+}
+
+// Min heap on each reader's next key
+static void siftDown(KeyReader **heap, int size, int i) {
+	for (;;) {
+		int smallest = i;
+		int left = 2*i + 1;
+		int right = left + 1;
+		if (left < size && keyLess(*peekKey(heap[left]), *peekKey(heap[smallest]))) {
+			smallest = left;
+		}
+		if (right < size && keyLess(*peekKey(heap[right]), *peekKey(heap[smallest]))) {
+			smallest = right;
+		}
+		if (smallest == i) {
+			return;
+		}
+		KeyReader *swap = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = swap;
+		i = smallest;
+	}
+}
@@ -0,0 +1,359 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rubiks.h"
+#include "cubiestate.h"
+#include "stateloader.h"
+#include "notation.h"
+#include "timer.h"
+#include "controller/solvercontroller.h"
+#include "view/softrender.h"
+#include "logger.h"
+#include "trace.h"
+
+// Renders the solve of a scrambled cube to a numbered image sequence or a
+// raw rgb24 stream, without a display or GL context. The whole solution is
+// computed up front, so every frame's state is known and frames render in
+// parallel.
+
+#define MAX_SOLUTION 4096
+#define MAX_SCRAMBLE 1024
+#define FRAMES_PER_THREAD 2
+
+#define OUTPUT_RAW 0
+#define OUTPUT_PPM 1
+#define OUTPUT_PNG 2
+
+typedef struct {
+	Rubiks *states; // state before each move, plus the solved state
+	Step *moves;
+	int moveCount;
+	double fps;
+	double turnsPerSecond;
+	Vec2d camera;
+	int output;
+	const char *pattern;
+} Job;
+
+typedef struct {
+	const Job *job;
+	Framebuffer *frames;
+	int first; // frame number of frames[0]
+	int count;
+	int thread;
+	int threads;
+	int ok;
+	int started; // on a worker thread, rather than the calling one
+} Batch;
+
+static void printUsage(const char *name);
+static int loadStart(Rubiks *rubiks, const char *scramble, const char *stateFile);
+static int isFramePattern(const char *pattern);
+static int outputFormat(const char *pattern);
+static void *renderWorker(void *arg);
+static void renderBatch(Batch *batch);
+static void renderFrame(const Job *job, int frame, Framebuffer *fb);
+static int writeFrame(const Job *job, int frame, Framebuffer *fb);
+
+int main(int argc, char *argv[]) {
+	const char *scramble = NULL;
+	const char *stateFile = NULL;
+	const char *pattern = "frame%05d.ppm";
+	int width = 800;
+	int height = 800;
+	double fps = 30;
+	double turnsPerSecond = 3;
+	double hold = 1;
+	Vec2d camera = {-30, 30};
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *logSpec = "warn";
+	int invalid = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "s:l:o:g:r:t:e:c:j:L:h")) != -1) {
+		switch (opt) {
+			case 's':
+				scramble = optarg;
+				break;
+			case 'l':
+				stateFile = optarg;
+				break;
+			case 'o':
+				pattern = optarg;
+				break;
+			case 'g':
+				invalid |= sscanf(optarg, "%dx%d", &width, &height) != 2;
+				break;
+			case 'r':
+				fps = atof(optarg);
+				break;
+			case 't':
+				turnsPerSecond = atof(optarg);
+				break;
+			case 'e':
+				hold = atof(optarg);
+				break;
+			case 'c':
+				invalid |= sscanf(optarg, "%lf,%lf", &camera.x, &camera.y) != 2;
+				break;
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'L':
+				logSpec = optarg;
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (invalid || optind != argc || width <= 0 || height <= 0 || fps <= 0 || turnsPerSecond <= 0 || hold < 0
+			|| !logger_configure(logSpec)) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	Job job = {NULL, NULL, 0, fps, turnsPerSecond, camera, OUTPUT_RAW, pattern};
+	if (strcmp(pattern, "-") != 0) {
+		if (!isFramePattern(pattern)) {
+			log_error("Output must be - or contain one %%d style frame number: %s", pattern);
+			return EXIT_FAILURE;
+		}
+		job.output = outputFormat(pattern);
+	}
+
+	Rubiks start;
+	if (!loadStart(&start, scramble, stateFile)) {
+		return EXIT_FAILURE;
+	}
+
+	job.moves = malloc(MAX_SOLUTION * sizeof(Step));
+	int *inProgress = malloc(MAX_SOLUTION * sizeof(int));
+	if (job.moves == NULL || inProgress == NULL) {
+		log_error("Unable to allocate a %i move solution", MAX_SOLUTION);
+		return EXIT_FAILURE;
+	}
+	if (!trace_init()) {
+		return EXIT_FAILURE;
+	}
+	job.moveCount = solver_computeSolution(&start, job.moves, inProgress, MAX_SOLUTION, NULL);
+	if (job.moveCount < 0) {
+		log_error("%s", "Unable to compute a solution for the starting state");
+		return EXIT_FAILURE;
+	}
+
+	job.states = malloc((job.moveCount + 1) * sizeof(Rubiks));
+	if (job.states == NULL) {
+		log_error("Unable to allocate %i states", job.moveCount + 1);
+		return EXIT_FAILURE;
+	}
+	job.states[0] = start;
+	for (int i=0; i<job.moveCount; i++) {
+		job.states[i].cubeInProgress = inProgress[i];
+		job.states[i+1] = job.states[i];
+		rc_applyMove(&job.states[i+1], job.moves[i].face, job.moves[i].direction);
+	}
+	free(inProgress);
+
+	// Batches that can't get a thread are rendered on this one
+	pthread_t *workers = malloc(threads * sizeof(pthread_t));
+	Batch *batches = malloc(threads * sizeof(Batch));
+	Batch single;
+	if (workers == NULL || batches == NULL) {
+		log_warn("Unable to allocate %i render workers, rendering on one thread", threads);
+		free(workers);
+		free(batches);
+		workers = NULL;
+		batches = &single;
+		threads = 1;
+	}
+
+	int frameCount = (int)ceil((job.moveCount / turnsPerSecond + hold) * fps) + 1;
+	int batchSize = threads * FRAMES_PER_THREAD;
+	Framebuffer *frames = calloc(batchSize, sizeof(Framebuffer));
+	if (frames == NULL) {
+		log_error("Unable to allocate %i frames", batchSize);
+		return EXIT_FAILURE;
+	}
+	for (int i=0; i<batchSize; i++) {
+		if (!sr_initFramebuffer(&frames[i], width, height)) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	double startTime = timer_now();
+	int ok = 1;
+	for (int first=0; first<frameCount && ok; first+=batchSize) {
+		int count = frameCount - first < batchSize ? frameCount - first : batchSize;
+		for (int t=0; t<threads; t++) {
+			batches[t] = (Batch){&job, frames, first, count, t, threads, 1, 0};
+			batches[t].started = workers != NULL
+				&& pthread_create(&workers[t], NULL, renderWorker, &batches[t]) == 0;
+		}
+		for (int t=0; t<threads; t++) {
+			if (batches[t].started) {
+				pthread_join(workers[t], NULL);
+			} else {
+				renderBatch(&batches[t]);
+			}
+			ok = ok && batches[t].ok;
+		}
+		// A raw stream has to stay in frame order, so it is written here
+		for (int i=0; i<count && ok && job.output == OUTPUT_RAW; i++) {
+			size_t size = (size_t)width * height * 3;
+			ok = fwrite(frames[i].pixels, 1, size, stdout) == size;
+		}
+	}
+	double seconds = timer_now() - startTime;
+	fflush(stdout);
+
+	for (int i=0; i<batchSize; i++) {
+		sr_freeFramebuffer(&frames[i]);
+	}
+	free(frames);
+	free(workers);
+	if (batches != &single) {
+		free(batches);
+	}
+	free(job.states);
+	free(job.moves);
+
+	if (!ok) {
+		log_error("%s", "Failed to write frames");
+		return EXIT_FAILURE;
+	}
+	fprintf(stderr, "%i moves, %i frames (%.1fs at %.0f fps) rendered in %.3fs on %i threads (%.1f frames/s)\n",
+		job.moveCount, frameCount, frameCount / fps, fps, seconds, threads,
+		seconds > 0 ? frameCount / seconds : 0);
+	return EXIT_SUCCESS;
+}
+
+static void printUsage(const char *name) {
+	fprintf(stderr, "Usage: %s [-s scramble | -l statefile] [-o pattern|-] [-g WxH] [-r fps] [-t turns/s]\n", name);
+	fprintf(stderr, "\t\t[-e holdseconds] [-c camx,camy] [-j threads] [-L log spec]\n");
+	fprintf(stderr, "\tRenders the solve of the scramble (Singmaster notation), the first state in the\n");
+	fprintf(stderr, "\tstate file, or a random state. The pattern names each frame, e.g. out/%%05d.png;\n");
+	fprintf(stderr, "\t.png writes PNG, anything else PPM. - streams raw rgb24 frames to stdout, e.g.\n");
+	fprintf(stderr, "\t%s -o - | ffmpeg -f rawvideo -pix_fmt rgb24 -s 800x800 -r 30 -i - solve.mp4\n", name);
+}
+
+static int loadStart(Rubiks *rubiks, const char *scramble, const char *stateFile) {
+	rc_initialize(rubiks);
+	if (scramble != NULL) {
+		Step steps[MAX_SCRAMBLE];
+		int errorOffset = 0;
+		int count = notation_parse(scramble, strlen(scramble), steps, MAX_SCRAMBLE, &errorOffset);
+		if (count < 0) {
+			log_error("Scramble column %i: %s", errorOffset+1, notation_errorString(count));
+			return 0;
+		}
+		for (int i=0; i<count; i++) {
+			rc_applyMove(rubiks, steps[i].face, steps[i].direction);
+		}
+	} else if (stateFile != NULL) {
+		StateLoader loader;
+		CubieState state;
+		if (!loader_open(&loader, stateFile)) {
+			return 0;
+		}
+		int result = loader_next(&loader, &state);
+		loader_close(&loader);
+		if (result != 1) {
+			log_error("No valid state found in state file: %s", stateFile);
+			return 0;
+		}
+		cs_toRubiks(&state, rubiks);
+	} else {
+		Random random;
+		random_seed(&random, time(NULL));
+		rc_randomize(rubiks, &random);
+	}
+	return 1;
+}
+
+// Accept exactly one conversion of the form %d, %5d or %05d
+static int isFramePattern(const char *pattern) {
+	int conversions = 0;
+	for (const char *c=pattern; *c; c++) {
+		if (*c != '%') {
+			continue;
+		}
+		c++;
+		if (*c == '%') {
+			continue;
+		}
+		while (isdigit((unsigned char)*c)) {
+			c++;
+		}
+		if (*c != 'd') {
+			return 0;
+		}
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+static int outputFormat(const char *pattern) {
+	size_t length = strlen(pattern);
+	if (length >= 4 && strcmp(pattern + length - 4, ".png") == 0) {
+		return OUTPUT_PNG;
+	}
+	return OUTPUT_PPM;
+}
+
+static void *renderWorker(void *arg) {
+	trace_nameThread("render worker");
+	renderBatch(arg);
+	return NULL;
+}
+
+static void renderBatch(Batch *batch) {
+	for (int i=batch->thread; i<batch->count; i+=batch->threads) {
+		trace_begin("renderFrame", "render");
+		renderFrame(batch->job, batch->first + i, &batch->frames[i]);
+		trace_end("renderFrame", "render");
+		if (batch->job->output != OUTPUT_RAW) {
+			trace_begin("writeFrame", "render");
+			batch->ok = writeFrame(batch->job, batch->first + i, &batch->frames[i]) && batch->ok;
+			trace_end("writeFrame", "render");
+		}
+	}
+}
+
+static void renderFrame(const Job *job, int frame, Framebuffer *fb) {
+	double turns = frame / job->fps * job->turnsPerSecond;
+	int move = (int)turns;
+	int rotatingMove = -1;
+	float degrees = 0;
+	if (move >= job->moveCount) {
+		move = job->moveCount;
+	} else {
+		rotatingMove = job->moves[move].face;
+		degrees = 90 * (turns - move) * job->moves[move].direction;
+	}
+	// rc_buildMesh only reads the state, so threads can share it
+	sr_clear(fb);
+	sr_drawRubiks(fb, &job->states[move], rotatingMove, degrees, job->camera);
+}
+
+static int writeFrame(const Job *job, int frame, Framebuffer *fb) {
+	char fileName[4096];
+	snprintf(fileName, sizeof(fileName), job->pattern, frame);
+	FILE *fp = fopen(fileName, "wb");
+	if (fp == NULL) {
+		log_error("Unable to open frame file: %s", fileName);
+		return 0;
+	}
+	int ok = job->output == OUTPUT_PNG ? sr_writePNG(fb, fp) : sr_writePPM(fb, fp);
+	return fclose(fp) == 0 && ok;
+}
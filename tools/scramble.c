@@ -0,0 +1,274 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rubiks.h"
+#include "cubiestate.h"
+#include "facelet.h"
+#include "statecodec.h"
+#include "notation.h"
+#include "timer.h"
+#include "logger.h"
+
+// Applies every scramble line of the input files to a solved cube and writes
+// the resulting states, one per scramble, in any format bin/rubiks can load.
+// With -n it instead writes that many states drawn uniformly from every
+// reachable state, reproducible from the seed. Random states are drawn in
+// chunks, each from its own jump-separated stream of the seed, so threads
+// fill chunks independently and the output does not depend on -j.
+
+#define FORMAT_FACELET 0
+#define FORMAT_TEXT 1
+#define FORMAT_BINARY 2
+
+#define RANDOM_CHUNK 4096 // states drawn from each stream
+
+typedef struct {
+	Random random; // this chunk's stream
+	long count;
+	int format;
+	char *data; // the chunk's states in the output format
+	size_t size;
+	int started; // on a thread of its own
+} RandomChunk;
+
+static void printUsage(const char *name);
+static int runFile(const char *fileName, FILE *out, int format, Step *steps, int maxSteps);
+static int runRandom(long count, unsigned int seed, int threads, FILE *out, int format);
+static void *fillChunk(void *arg);
+static void writeState(CubieState *state, FILE *out, int format);
+
+static long totalScrambles = 0;
+static long totalMoves = 0;
+
+int main(int argc, char *argv[]) {
+	int format = FORMAT_FACELET;
+	int maxSteps = 1 << 20;
+	long randomCount = 0;
+	unsigned int seed = time(NULL);
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *outName = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "f:o:m:n:r:j:h")) != -1) {
+		switch (opt) {
+			case 'f':
+				if (strcmp(optarg, "facelet") == 0) {
+					format = FORMAT_FACELET;
+				} else if (strcmp(optarg, "text") == 0) {
+					format = FORMAT_TEXT;
+				} else if (strcmp(optarg, "binary") == 0) {
+					format = FORMAT_BINARY;
+				} else {
+					printUsage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'o':
+				outName = optarg;
+				break;
+			case 'm':
+				maxSteps = atoi(optarg);
+				break;
+			case 'n':
+				randomCount = atol(optarg);
+				break;
+			case 'r':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if ((optind >= argc) == (randomCount <= 0) || maxSteps <= 0) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	FILE *out = stdout;
+	if (outName && !(out = fopen(outName, format == FORMAT_BINARY ? "wb" : "w"))) {
+		log_error("Unable to open output file: %s", outName);
+		return EXIT_FAILURE;
+	}
+	if (randomCount > 0) {
+		double start = timer_now();
+		int failed = !runRandom(randomCount, seed, threads, out, format);
+		double seconds = timer_now() - start;
+		failed |= ferror(out);
+		if (out != stdout) {
+			failed |= fclose(out) != 0;
+		}
+		fprintf(stderr, "seed %u: %li random states on %i threads in %.3fs (%.0f states/s)\n",
+			seed, randomCount, threads, seconds, seconds > 0 ? randomCount / seconds : 0);
+		return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+	Step *steps = malloc(maxSteps * sizeof(Step));
+	if (steps == NULL) {
+		log_error("Unable to allocate %i steps", maxSteps);
+		return EXIT_FAILURE;
+	}
+
+	double start = timer_now();
+	int failed = 0;
+	for (int i=optind; i<argc; i++) {
+		failed += !runFile(argv[i], out, format, steps, maxSteps);
+	}
+	double seconds = timer_now() - start;
+
+	free(steps);
+	if (out != stdout) {
+		fclose(out);
+	}
+	fprintf(stderr, "%li scrambles, %li moves in %.3fs (%.0f moves/s)\n",
+		totalScrambles, totalMoves, seconds, seconds > 0 ? totalMoves / seconds : 0);
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void printUsage(const char *name) {
+	fprintf(stderr, "Usage: %s [-f facelet|text|binary] [-o output] [-m maxmoves] scramblefile...\n", name);
+	fprintf(stderr, "       %s [-f facelet|text|binary] [-o output] -n count [-r seed] [-j threads]\n", name);
+	fprintf(stderr, "\tEach non-empty line is a scramble in Singmaster notation (e.g. R U2 F').\n");
+	fprintf(stderr, "\tLines starting with '#' are ignored. -n writes count uniformly random states,\n");
+	fprintf(stderr, "\tthe same for a seed whatever the thread count (default one per CPU).\n");
+}
+
+static int runFile(const char *fileName, FILE *out, int format, Step *steps, int maxSteps) {
+	FILE *fp = fopen(fileName, "r");
+	if (fp == NULL) {
+		log_error("Unable to open scramble file: %s", fileName);
+		return 0;
+	}
+	char *line = NULL;
+	size_t capacity = 0;
+	ssize_t length;
+	int lineNumber = 0;
+	int ok = 1;
+	while ((length = getline(&line, &capacity, fp)) != -1) {
+		lineNumber++;
+		int first = strspn(line, " \t\r\n");
+		if (first == length || line[first] == '#') {
+			continue;
+		}
+		int errorOffset = 0;
+		int count = notation_parse(line, length, steps, maxSteps, &errorOffset);
+		if (count < 0) {
+			log_error("%s:%i:%i: %s", fileName, lineNumber, errorOffset+1, notation_errorString(count));
+			ok = 0;
+			continue;
+		}
+		// Rotations only relabel faces, so the state written is the physical
+		// one with the centers where they started
+		CubieState state;
+		int frame[NUM_FACES] = {0, 1, 2, 3, 4, 5};
+		cs_initSolved(&state);
+		for (int i=0; i<count; i++) {
+			Step turns[2];
+			int turnCount = rc_resolveMove(frame, steps[i].face, steps[i].direction, turns);
+			for (int t=0; t<turnCount; t++) {
+				cs_rotateFace(&state, turns[t].face, turns[t].direction);
+			}
+		}
+		writeState(&state, out, format);
+		totalScrambles++;
+		totalMoves += count;
+	}
+	free(line);
+	fclose(fp);
+	return ok;
+}
+
+// Chunks are filled a batch at a time, one per thread, and written in order
+static int runRandom(long count, unsigned int seed, int threads, FILE *out, int format) {
+	RandomChunk *batch = calloc(threads, sizeof(RandomChunk));
+	pthread_t *workers = malloc(threads * sizeof(pthread_t));
+	if (batch == NULL || workers == NULL) {
+		log_error("Unable to allocate %i random state workers", threads);
+		free(batch);
+		free(workers);
+		return 0;
+	}
+	Random stream;
+	random_seed(&stream, seed);
+	int ok = 1;
+	for (long first=0; first<count && ok; first+=(long)threads * RANDOM_CHUNK) {
+		int chunks = 0;
+		for ( ; chunks<threads && first + (long)chunks * RANDOM_CHUNK < count; chunks++) {
+			RandomChunk *chunk = &batch[chunks];
+			long left = count - first - (long)chunks * RANDOM_CHUNK;
+			chunk->random = stream;
+			random_jump(&stream);
+			chunk->count = left < RANDOM_CHUNK ? left : RANDOM_CHUNK;
+			chunk->format = format;
+			// A chunk that can't get a thread is filled on this one
+			chunk->started = threads > 1 && pthread_create(&workers[chunks], NULL, fillChunk, chunk) == 0;
+			if (!chunk->started) {
+				fillChunk(chunk);
+			}
+		}
+		for (int c=0; c<chunks; c++) {
+			RandomChunk *chunk = &batch[c];
+			if (chunk->started) {
+				pthread_join(workers[c], NULL);
+			}
+			if (chunk->data == NULL) {
+				log_error("%s", "Unable to buffer random states");
+				ok = 0;
+			} else if (ok) {
+				ok = fwrite(chunk->data, 1, chunk->size, out) == chunk->size;
+			}
+			free(chunk->data);
+			chunk->data = NULL;
+		}
+	}
+	free(batch);
+	free(workers);
+	return ok;
+}
+
+static void *fillChunk(void *arg) {
+	RandomChunk *chunk = arg;
+	FILE *buffer = open_memstream(&chunk->data, &chunk->size);
+	if (buffer == NULL) {
+		chunk->data = NULL;
+		return NULL;
+	}
+	for (long i=0; i<chunk->count; i++) {
+		CubieState state;
+		cs_randomize(&state, &chunk->random);
+		writeState(&state, buffer, chunk->format);
+	}
+	if (fclose(buffer) != 0) {
+		free(chunk->data);
+		chunk->data = NULL;
+	}
+	return NULL;
+}
+
+static void writeState(CubieState *state, FILE *out, int format) {
+	if (format == FORMAT_BINARY) {
+		unsigned char record[STATE_BINARY_SIZE];
+		codec_encodeBinary(state, record);
+		fwrite(record, 1, STATE_BINARY_SIZE, out);
+	} else if (format == FORMAT_TEXT) {
+		Rubiks rubiks;
+		rc_initialize(&rubiks);
+		cs_toRubiks(state, &rubiks);
+		rc_writeState(&rubiks, out);
+	} else {
+		char facelets[FACELET_COUNT+1];
+		facelet_encode(state, facelets);
+		facelets[FACELET_COUNT] = '\n';
+		fwrite(facelets, 1, FACELET_COUNT+1, out);
+	}
+}
@@ -0,0 +1,148 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rubiks.h"
+#include "cubiestate.h"
+#include "stateloader.h"
+#include "controller/solvercontroller.h"
+#include "controller/solverstats.h"
+#include "logger.h"
+#include "trace.h"
+
+// Solves every state in the given state files, or a batch of random
+// scrambles, and writes the solver statistics of each solve as a JSON line
+// followed by one line aggregating the batch.
+
+#define MAX_SOLUTION 4096
+
+static void printUsage(const char *name);
+static int solveFile(const char *fileName, SolverStatsAggregate *aggregate, int each, FILE *out);
+static int solve(Rubiks *rubiks, SolverStatsAggregate *aggregate, int each, FILE *out);
+
+static Step solution[MAX_SOLUTION];
+
+int main(int argc, char *argv[]) {
+	int count = 100;
+	int shuffleMoves = 20;
+	int uniform = 0;
+	unsigned int seed = time(NULL);
+	int each = 1;
+	const char *outName = NULL;
+	const char *logSpec = "warn";
+	int opt;
+	while ((opt = getopt(argc, argv, "n:m:ur:ao:L:h")) != -1) {
+		switch (opt) {
+			case 'n':
+				count = atoi(optarg);
+				break;
+			case 'm':
+				shuffleMoves = atoi(optarg);
+				break;
+			case 'u':
+				uniform = 1;
+				break;
+			case 'r':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			case 'a':
+				each = 0;
+				break;
+			case 'o':
+				outName = optarg;
+				break;
+			case 'L':
+				logSpec = optarg;
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (count < 0 || shuffleMoves < 0 || !logger_configure(logSpec)) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FILE *out = stdout;
+	if (outName && !(out = fopen(outName, "w"))) {
+		log_error("Unable to open output file: %s", outName);
+		return EXIT_FAILURE;
+	}
+
+	if (!trace_init()) {
+		return EXIT_FAILURE;
+	}
+	SolverStatsAggregate aggregate;
+	stats_initAggregate(&aggregate);
+	int ok = 1;
+	if (optind < argc) {
+		for (int i=optind; i<argc; i++) {
+			ok = solveFile(argv[i], &aggregate, each, out) && ok;
+		}
+	} else {
+		Random random;
+		random_seed(&random, seed);
+		for (int i=0; i<count && ok; i++) {
+			Rubiks rubiks;
+			rc_initialize(&rubiks);
+			if (uniform) {
+				rc_randomize(&rubiks, &random);
+			} else {
+				rc_shuffle(&rubiks, shuffleMoves, &random);
+			}
+			ok = solve(&rubiks, &aggregate, each, out);
+		}
+	}
+	stats_writeAggregateJSON(&aggregate, out);
+	stats_freeAggregate(&aggregate);
+	if (out != stdout) {
+		ok = fclose(out) == 0 && ok;
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void printUsage(const char *name) {
+	fprintf(stderr, "Usage: %s [-n count] [-m shuffle moves] [-u] [-r seed] [-a] [-o output] [-L log spec] [statefile...]\n", name);
+	fprintf(stderr, "\tSolves each state in the state files, or count random shuffles, and writes\n");
+	fprintf(stderr, "\tone JSON line of solver statistics per solve and a final aggregate line.\n");
+	fprintf(stderr, "\t-u draws uniformly random states instead of shuffling. -a writes only the\n");
+	fprintf(stderr, "\taggregate. Solver logging defaults to warn.\n");
+}
+
+static int solveFile(const char *fileName, SolverStatsAggregate *aggregate, int each, FILE *out) {
+	StateLoader loader;
+	if (!loader_open(&loader, fileName)) {
+		return 0;
+	}
+	CubieState state;
+	int result;
+	int ok = 1;
+	while (ok && (result = loader_next(&loader, &state)) != 0) {
+		if (result < 0) {
+			log_warn("Skipping invalid state on line %i of %s", loader.line, fileName);
+			continue;
+		}
+		Rubiks rubiks;
+		rc_initialize(&rubiks);
+		cs_toRubiks(&state, &rubiks);
+		ok = solve(&rubiks, aggregate, each, out);
+	}
+	loader_close(&loader);
+	return ok;
+}
+
+// Failed solves are recorded, only running out of memory stops the batch
+static int solve(Rubiks *rubiks, SolverStatsAggregate *aggregate, int each, FILE *out) {
+	SolverStats stats;
+	if (solver_computeSolution(rubiks, solution, NULL, MAX_SOLUTION, &stats) < 0) {
+		log_warn("%s", "Solve did not finish");
+	}
+	if (each) {
+		stats_writeJSON(&stats, out);
+	}
+	return stats_addSolve(aggregate, &stats);
+}
@@ -0,0 +1,560 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "rubiks.h"
+#include "cubiestate.h"
+#include "facelet.h"
+#include "statecodec.h"
+#include "stateloader.h"
+#include "notation.h"
+#include "timer.h"
+#include "controller/solvercontroller.h"
+#include "logger.h"
+#include "trace.h"
+
+// Long running solve service. Reads states from stdin, or from every client
+// of a Unix domain socket, and answers each with one line: "ok" followed by
+// the solution in Singmaster notation, or "error" followed by the reason.
+// Requests are text lines as in state files (a facelet string or a
+// quaternion dump) or binary state records, mixed freely. Clients may send
+// any number of requests without waiting for answers; a pool of workers
+// solves them and each client gets its answers back in request order.
+
+#define MAX_SOLUTION 4096
+#define RESPONSE_SIZE (MAX_SOLUTION*3 + 8) // "ok ", at most three characters a move, newline
+#define WINDOW 256 // requests a client may have in flight before its reads pause
+#define READ_BUFFER 65536 // also the longest text request
+#define WRITE_BUFFER 65536
+
+typedef struct Job Job;
+
+// One connection, served by a reader and a writer thread. Answers land in
+// a ring indexed by request number and are written out in that order.
+typedef struct {
+	int in;
+	int out;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	long submitted; // requests read
+	long written; // answers written
+	int readerDone;
+	int failed; // the client stopped reading answers
+	char *responses[WINDOW];
+} Client;
+
+struct Job {
+	Client *client;
+	long sequence;
+	CubieState state;
+	Job *next;
+};
+
+// Requests waiting for a worker, from every client
+typedef struct {
+	Job *head;
+	Job *tail;
+	int closed;
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+} JobQueue;
+
+static void printUsage(const char *name);
+static int serveSocket(const char *path);
+static void onSignal(int number);
+static int startThread(pthread_t *thread, void *(*run)(void*), void *arg);
+static Client *newClient(int in, int out);
+static void *clientMain(void *arg);
+static void serveClient(Client *client);
+static void readRequests(Client *client);
+static void submitLine(Client *client, char *line, int length);
+static void submitBinary(Client *client, const unsigned char *record);
+static long beginRequest(Client *client);
+static void finishRequest(Client *client, long sequence, char *response);
+static char *errorResponse(const char *reason, const char *detail);
+static void *allocate(size_t size);
+static void *writerMain(void *arg);
+static int writeAll(int fd, const char *data, size_t length);
+static void pushJob(Job *job);
+static Job *popJob();
+static void *workerMain(void *arg);
+static char *solveState(const CubieState *state, Step *solution);
+
+static JobQueue jobs = {NULL, NULL, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+static volatile sig_atomic_t stopping = 0;
+static long requestCount = 0;
+static long solvedCount = 0;
+
+int main(int argc, char *argv[]) {
+	const char *socketPath = NULL;
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *logSpec = "warn";
+	int opt;
+	while ((opt = getopt(argc, argv, "s:j:L:h")) != -1) {
+		switch (opt) {
+			case 's':
+				socketPath = optarg;
+				break;
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'L':
+				logSpec = optarg;
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind != argc || !logger_configure(logSpec)) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (!trace_init()) {
+		return EXIT_FAILURE;
+	}
+	// A client that hangs up shows as a failed write, not a signal
+	signal(SIGPIPE, SIG_IGN);
+
+	pthread_t *workers = malloc(threads * sizeof(pthread_t));
+	if (workers == NULL) {
+		log_error("Unable to allocate %i workers", threads);
+		return EXIT_FAILURE;
+	}
+	for (int t=0; t<threads; t++) {
+		if (!startThread(&workers[t], workerMain, NULL)) {
+			log_error("%s", "Unable to start solver workers");
+			return EXIT_FAILURE;
+		}
+	}
+
+	double start = timer_now();
+	int ok = 1;
+	if (socketPath != NULL) {
+		ok = serveSocket(socketPath);
+	} else {
+		Client *client = newClient(STDIN_FILENO, STDOUT_FILENO);
+		if (client == NULL) {
+			return EXIT_FAILURE;
+		}
+		serveClient(client);
+		ok = !client->failed;
+		free(client);
+	}
+	double seconds = timer_now() - start;
+
+	pthread_mutex_lock(&jobs.lock);
+	jobs.closed = 1;
+	pthread_cond_broadcast(&jobs.ready);
+	pthread_mutex_unlock(&jobs.lock);
+	for (int t=0; t<threads; t++) {
+		pthread_join(workers[t], NULL);
+	}
+	free(workers);
+
+	long requests = __atomic_load_n(&requestCount, __ATOMIC_RELAXED);
+	long solved = __atomic_load_n(&solvedCount, __ATOMIC_RELAXED);
+	fprintf(stderr, "%li requests, %li solved, %li errors in %.3fs (%.0f requests/s)\n",
+		requests, solved, requests - solved, seconds, seconds > 0 ? requests / seconds : 0);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void printUsage(const char *name) {
+	fprintf(stderr, "Usage: %s [-s socket] [-j threads] [-L log spec]\n", name);
+	fprintf(stderr, "\tSolves states read from stdin, or from clients of the Unix socket, with a pool\n");
+	fprintf(stderr, "\tof threads (default one per CPU). Each request is a text line (a facelet string\n");
+	fprintf(stderr, "\tor quaternion dump) or a %i byte binary state record; each gets one line back,\n",
+		STATE_BINARY_SIZE);
+	fprintf(stderr, "\t\"ok\" and the solution or \"error\" and the reason, in request order. Blank\n");
+	fprintf(stderr, "\tlines and lines starting with '#' get no answer.\n");
+}
+
+// Accepts clients until SIGINT or SIGTERM. Clients still connected then are
+// cut off.
+static int serveSocket(const char *path) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		log_error("Socket path too long: %s", path);
+		return 0;
+	}
+	strcpy(address.sun_path, path);
+
+	// Only a leftover socket is replaced, never another kind of file
+	struct stat info;
+	if (stat(path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+		unlink(path);
+	}
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0
+			|| listen(listener, SOMAXCONN) != 0) {
+		log_error("Unable to listen on %s: %s", path, strerror(errno));
+		return 0;
+	}
+
+	// No SA_RESTART, so a signal interrupts accept
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onSignal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	fprintf(stderr, "Listening on %s\n", path);
+
+	int ok = 1;
+	while (!stopping) {
+		int fd = accept(listener, NULL, NULL);
+		if (fd < 0) {
+			if (errno != EINTR && errno != ECONNABORTED) {
+				log_error("Unable to accept a client: %s", strerror(errno));
+				ok = 0;
+				break;
+			}
+			continue;
+		}
+		Client *client = newClient(fd, fd);
+		pthread_t thread;
+		if (client == NULL || !startThread(&thread, clientMain, client)) {
+			log_error("%s", "Unable to serve a client");
+			free(client);
+			close(fd);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+	close(listener);
+	unlink(path);
+	return ok;
+}
+
+static void onSignal(int number) {
+	stopping = 1;
+}
+
+// Every thread but main blocks the stop signals, so they always interrupt
+// the accept loop
+static int startThread(pthread_t *thread, void *(*run)(void*), void *arg) {
+	sigset_t block, previous;
+	sigemptyset(&block);
+	sigaddset(&block, SIGINT);
+	sigaddset(&block, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &block, &previous);
+	int result = pthread_create(thread, NULL, run, arg);
+	pthread_sigmask(SIG_SETMASK, &previous, NULL);
+	return result == 0;
+}
+
+static Client *newClient(int in, int out) {
+	Client *client = calloc(1, sizeof(Client));
+	if (client == NULL) {
+		log_error("%s", "Unable to allocate a client");
+		return NULL;
+	}
+	client->in = in;
+	client->out = out;
+	pthread_mutex_init(&client->lock, NULL);
+	pthread_cond_init(&client->changed, NULL);
+	return client;
+}
+
+static void *clientMain(void *arg) {
+	Client *client = arg;
+	trace_nameThread("client");
+	serveClient(client);
+	log_info("Client done: %li requests%s", client->written, client->failed ? ", stopped reading" : "");
+	close(client->in);
+	free(client);
+	return NULL;
+}
+
+// Returns once every request read has been answered
+static void serveClient(Client *client) {
+	pthread_t writer;
+	if (!startThread(&writer, writerMain, client)) {
+		log_error("%s", "Unable to start a client writer");
+		client->failed = 1;
+		return;
+	}
+	readRequests(client);
+	pthread_mutex_lock(&client->lock);
+	client->readerDone = 1;
+	pthread_cond_broadcast(&client->changed);
+	pthread_mutex_unlock(&client->lock);
+	pthread_join(writer, NULL);
+	pthread_mutex_destroy(&client->lock);
+	pthread_cond_destroy(&client->changed);
+}
+
+// Binary records start with their magic, which no text request can
+static void readRequests(Client *client) {
+	char *buffer = allocate(READ_BUFFER);
+	int used = 0;
+	int skipping = 0; // dropping the rest of an overlong line
+	for (;;) {
+		ssize_t count = read(client->in, buffer + used, READ_BUFFER - used);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0 || __atomic_load_n(&client->failed, __ATOMIC_RELAXED)) {
+			break;
+		}
+		used += count;
+
+		int begin = 0;
+		while (begin < used) {
+			char *next = buffer + begin;
+			int left = used - begin;
+			if (!skipping && codec_isBinary((unsigned char*)next, left)) {
+				submitBinary(client, (unsigned char*)next);
+				begin += STATE_BINARY_SIZE;
+				continue;
+			}
+			if (!skipping && left < STATE_BINARY_SIZE && left >= 2 && next[0] == STATE_BINARY_MAGIC0
+					&& next[1] == STATE_BINARY_MAGIC1) {
+				break; // the rest of a record
+			}
+			char *newline = memchr(next, '\n', left);
+			if (newline == NULL) {
+				break;
+			}
+			if (!skipping) {
+				submitLine(client, next, newline - next);
+			}
+			skipping = 0;
+			begin += newline - next + 1;
+		}
+		if (begin == 0 && used == READ_BUFFER && !skipping) {
+			finishRequest(client, beginRequest(client), errorResponse("request too long", NULL));
+			skipping = 1;
+		}
+		if (skipping) {
+			begin = used;
+		}
+		memmove(buffer, buffer + begin, used - begin);
+		used -= begin;
+	}
+	// An unterminated last line is still a request
+	if (used > 0 && !skipping) {
+		submitLine(client, buffer, used);
+	}
+	free(buffer);
+}
+
+static void submitLine(Client *client, char *line, int length) {
+	while (length > 0 && (line[length-1] == '\r' || line[length-1] == ' ' || line[length-1] == '\t')) {
+		length--;
+	}
+	if (length == 0 || line[0] == '#') {
+		return;
+	}
+	long sequence = beginRequest(client);
+	Job *job = allocate(sizeof(Job));
+	if (memchr(line, ':', length)) {
+		if (!loader_parseQuaternionState(&job->state, line, length)) {
+			free(job);
+			finishRequest(client, sequence, errorResponse("invalid quaternion state", NULL));
+			return;
+		}
+	} else {
+		int error = facelet_decode(&job->state, line, length);
+		if (error != FACELET_OK) {
+			free(job);
+			finishRequest(client, sequence, errorResponse("invalid facelet state:", facelet_errorString(error)));
+			return;
+		}
+	}
+	job->client = client;
+	job->sequence = sequence;
+	pushJob(job);
+}
+
+static void submitBinary(Client *client, const unsigned char *record) {
+	long sequence = beginRequest(client);
+	Job *job = allocate(sizeof(Job));
+	if (!codec_decodeBinary(&job->state, record)) {
+		free(job);
+		finishRequest(client, sequence, errorResponse("invalid binary state", NULL));
+		return;
+	}
+	job->client = client;
+	job->sequence = sequence;
+	pushJob(job);
+}
+
+// Waits for room in the client's window and numbers the request
+static long beginRequest(Client *client) {
+	pthread_mutex_lock(&client->lock);
+	while (client->submitted - client->written >= WINDOW) {
+		pthread_cond_wait(&client->changed, &client->lock);
+	}
+	long sequence = client->submitted++;
+	pthread_mutex_unlock(&client->lock);
+	__atomic_fetch_add(&requestCount, 1, __ATOMIC_RELAXED);
+	return sequence;
+}
+
+// Hands the answer to the client's writer, which frees it
+static void finishRequest(Client *client, long sequence, char *response) {
+	pthread_mutex_lock(&client->lock);
+	client->responses[sequence % WINDOW] = response;
+	if (sequence == client->written) {
+		pthread_cond_broadcast(&client->changed);
+	}
+	pthread_mutex_unlock(&client->lock);
+}
+
+static char *errorResponse(const char *reason, const char *detail) {
+	char *response = allocate(RESPONSE_SIZE);
+	snprintf(response, RESPONSE_SIZE, "error %s%s%s\n", reason, detail ? " " : "", detail ? detail : "");
+	return response;
+}
+
+// A request that can't be answered would stall its client for good
+static void *allocate(size_t size) {
+	void *memory = malloc(size);
+	if (memory == NULL) {
+		log_fatal("Unable to allocate %zu bytes", size);
+		exit(1);
+	}
+	return memory;
+}
+
+// Writes answers in order, batching those already done into one write.
+// Runs until the reader is done and every request has been answered; once
+// the client stops reading, answers are dropped.
+static void *writerMain(void *arg) {
+	Client *client = arg;
+	char *buffer = allocate(WRITE_BUFFER);
+	pthread_mutex_lock(&client->lock);
+	for (;;) {
+		while (client->responses[client->written % WINDOW] == NULL
+				&& !(client->readerDone && client->written == client->submitted)) {
+			pthread_cond_wait(&client->changed, &client->lock);
+		}
+		if (client->responses[client->written % WINDOW] == NULL) {
+			break;
+		}
+		size_t length = 0;
+		long next = client->written;
+		char *response;
+		while ((response = client->responses[next % WINDOW]) != NULL) {
+			size_t size = strlen(response);
+			if (length + size > WRITE_BUFFER) {
+				break;
+			}
+			memcpy(buffer + length, response, size);
+			length += size;
+			free(response);
+			client->responses[next % WINDOW] = NULL;
+			next++;
+		}
+		pthread_mutex_unlock(&client->lock);
+		if (!client->failed && !writeAll(client->out, buffer, length)) {
+			__atomic_store_n(&client->failed, 1, __ATOMIC_RELAXED);
+		}
+		pthread_mutex_lock(&client->lock);
+		client->written = next;
+		pthread_cond_broadcast(&client->changed);
+	}
+	pthread_mutex_unlock(&client->lock);
+	free(buffer);
+	return NULL;
+}
+
+static int writeAll(int fd, const char *data, size_t length) {
+	while (length > 0) {
+		ssize_t count = write(fd, data, length);
+		if (count < 0 && errno == EINTR) {
+			continue;
+		}
+		if (count <= 0) {
+			return 0;
+		}
+		data += count;
+		length -= count;
+	}
+	return 1;
+}
+
+static void pushJob(Job *job) {
+	job->next = NULL;
+	pthread_mutex_lock(&jobs.lock);
+	if (jobs.tail != NULL) {
+		jobs.tail->next = job;
+	} else {
+		jobs.head = job;
+	}
+	jobs.tail = job;
+	pthread_cond_signal(&jobs.ready);
+	pthread_mutex_unlock(&jobs.lock);
+}
+
+// Returns NULL once the queue is closed and empty
+static Job *popJob() {
+	pthread_mutex_lock(&jobs.lock);
+	while (jobs.head == NULL && !jobs.closed) {
+		pthread_cond_wait(&jobs.ready, &jobs.lock);
+	}
+	Job *job = jobs.head;
+	if (job != NULL) {
+		jobs.head = job->next;
+		if (jobs.head == NULL) {
+			jobs.tail = NULL;
+		}
+	}
+	pthread_mutex_unlock(&jobs.lock);
+	return job;
+}
+
+static void *workerMain(void *arg) {
+	trace_nameThread("solver worker");
+	Step *solution = allocate(MAX_SOLUTION * sizeof(Step));
+	Job *job;
+	while ((job = popJob()) != NULL) {
+		finishRequest(job->client, job->sequence, solveState(&job->state, solution));
+		free(job);
+	}
+	free(solution);
+	return NULL;
+}
+
+// Solutions turn physical faces, since request states are never rotated
+static char *solveState(const CubieState *state, Step *solution) {
+	Rubiks rubiks;
+	rc_initialize(&rubiks);
+	cs_toRubiks(state, &rubiks);
+	SolverStats stats;
+	int length = solver_computeSolution(&rubiks, solution, NULL, MAX_SOLUTION, &stats);
+	if (length < 0) {
+		return errorResponse(stats.failedStage >= 0 ? "no solution in" : "no solution",
+			stats.failedStage >= 0 ? solver_stageName(stats.failedStage) : NULL);
+	}
+	char *response = allocate(RESPONSE_SIZE);
+	strcpy(response, "ok");
+	int moves = notation_format(solution, length, response + 3, RESPONSE_SIZE - 4);
+	if (moves < 0) {
+		free(response);
+		return errorResponse("solution too long", NULL);
+	}
+	if (moves > 0) {
+		response[2] = ' ';
+		strcpy(response + 3 + moves, "\n");
+	} else {
+		strcpy(response + 2, "\n");
+	}
+	__atomic_fetch_add(&solvedCount, 1, __ATOMIC_RELAXED);
+	return response;
+}
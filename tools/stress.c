@@ -0,0 +1,211 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rubiks.h"
+#include "cubiestate.h"
+#include "timer.h"
+#include "controller/solvercontroller.h"
+#include "controller/solverstats.h"
+#include "logger.h"
+#include "trace.h"
+#include "utils.h"
+
+// Solves a seeded batch of random scrambles with a step cap, replays every
+// solution on the cubie model to check it really solves the cube, and
+// reports throughput and the distributions of solution length and solve
+// time. States that fail are saved in the inputs/ format for bin/rubiks.
+
+#define HISTOGRAM_WIDTH 50
+#define FILE_NAME_SIZE 1024
+
+static void printUsage(const char *name);
+static int verify(Rubiks *start, const Step *solution, int count);
+static int saveState(Rubiks *rubiks, const char *directory, unsigned int seed, int index);
+static void report(const char *name, const char *unit, double *values, int count, int bins);
+
+int main(int argc, char *argv[]) {
+	int count = 1000;
+	int shuffleMoves = 25;
+	int uniform = 0;
+	int maxSteps = 1000;
+	unsigned int seed = time(NULL);
+	const char *directory = "inputs";
+	int bins = 10;
+	const char *logSpec = "warn";
+	int opt;
+	while ((opt = getopt(argc, argv, "n:m:uc:r:d:b:L:h")) != -1) {
+		switch (opt) {
+			case 'n':
+				count = atoi(optarg);
+				break;
+			case 'm':
+				shuffleMoves = atoi(optarg);
+				break;
+			case 'u':
+				uniform = 1;
+				break;
+			case 'c':
+				maxSteps = atoi(optarg);
+				break;
+			case 'r':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			case 'd':
+				directory = optarg;
+				break;
+			case 'b':
+				bins = atoi(optarg);
+				break;
+			case 'L':
+				logSpec = optarg;
+				break;
+			default:
+				printUsage(argv[0]);
+				return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind != argc || count < 1 || shuffleMoves < 0 || maxSteps < 1 || bins < 1 || !logger_configure(logSpec)) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Step *solution = malloc(maxSteps * sizeof(Step));
+	double *moves = malloc(count * sizeof(double));
+	double *milliseconds = malloc(count * sizeof(double));
+	if (solution == NULL || moves == NULL || milliseconds == NULL) {
+		log_error("Unable to allocate a batch of %i solves", count);
+		return EXIT_FAILURE;
+	}
+
+	if (!trace_init()) {
+		return EXIT_FAILURE;
+	}
+	Random random;
+	random_seed(&random, seed);
+	int solved = 0;
+	int failed = 0;
+	double start = timer_now();
+	for (int i=0; i<count; i++) {
+		Rubiks rubiks;
+		rc_initialize(&rubiks);
+		if (uniform) {
+			rc_randomize(&rubiks, &random);
+		} else {
+			rc_shuffle(&rubiks, shuffleMoves, &random);
+		}
+
+		SolverStats stats;
+		int length = solver_computeSolution(&rubiks, solution, NULL, maxSteps, &stats);
+		if (length >= 0 && verify(&rubiks, solution, length)) {
+			moves[solved] = length;
+			milliseconds[solved] = stats.seconds * 1000;
+			solved++;
+			continue;
+		}
+
+		failed++;
+		fprintf(stderr, "Scramble %i failed: %s%s%s\n", i,
+			length < 0 ? "no solution" : "solution does not solve the cube",
+			stats.failedStage >= 0 ? " in " : "",
+			stats.failedStage >= 0 ? solver_stageName(stats.failedStage) : "");
+		saveState(&rubiks, directory, seed, i);
+	}
+	double seconds = timer_now() - start;
+
+	if (uniform) {
+		printf("seed %u: %i random states", seed, count);
+	} else {
+		printf("seed %u: %i scrambles of %i moves", seed, count, shuffleMoves);
+	}
+	printf(", %i solved, %i failed in %.3fs (%.0f solves/s)\n",
+		solved, failed, seconds, seconds > 0 ? count / seconds : 0);
+	if (solved > 0) {
+		report("solution length", "moves", moves, solved, bins);
+		report("solve time", "ms", milliseconds, solved, bins);
+	}
+
+	free(solution);
+	free(moves);
+	free(milliseconds);
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void printUsage(const char *name) {
+	fprintf(stderr, "Usage: %s [-n count] [-m shuffle moves] [-u] [-c step cap] [-r seed] [-d failure dir] [-b bins] [-L log spec]\n", name);
+	fprintf(stderr, "\tSolves count seeded random scrambles, allowing at most step cap moves each,\n");
+	fprintf(stderr, "\tchecks each solution and prints length and time histograms. Failing states\n");
+	fprintf(stderr, "\tare saved to the failure dir (default inputs) and make the exit status 1.\n");
+	fprintf(stderr, "\t-u draws uniformly random states instead of shuffling.\n");
+}
+
+// Replay on the cubie model rather than trusting the solver's own checks,
+// and compare every corner and edge, placement and orientation, with a
+// solved cube. Scrambles start unrotated, so the moves turn physical faces
+// and the centers stay home.
+static int verify(Rubiks *start, const Step *solution, int count) {
+	CubieState state;
+	CubieCoords coords, solved;
+	cs_fromRubiks(&state, start);
+	for (int i=0; i<count; i++) {
+		cs_rotateFace(&state, solution[i].face, solution[i].direction);
+	}
+	cs_toCoords(&state, &coords);
+	cs_initSolved(&state);
+	cs_toCoords(&state, &solved);
+	return memcmp(&coords, &solved, sizeof(CubieCoords)) == 0;
+}
+
+static int saveState(Rubiks *rubiks, const char *directory, unsigned int seed, int index) {
+	char fileName[FILE_NAME_SIZE];
+	snprintf(fileName, sizeof(fileName), "%s/stress_%u_%i.txt", directory, seed, index);
+	FILE *fp = fopen(fileName, "w");
+	if (fp == NULL) {
+		log_error("Unable to save failing state: %s", fileName);
+		return 0;
+	}
+	rc_writeState(rubiks, fp);
+	int ok = fclose(fp) == 0;
+	fprintf(stderr, "\tsaved to %s\n", fileName);
+	return ok;
+}
+
+static void report(const char *name, const char *unit, double *values, int count, int bins) {
+	qsort(values, count, sizeof(double), compareDoubles);
+	double mean = 0;
+	for (int i=0; i<count; i++) {
+		mean += values[i];
+	}
+	mean /= count;
+	double min = values[0];
+	double max = values[count-1];
+	printf("%s (%s): min %.3f mean %.3f p50 %.3f p90 %.3f p99 %.3f max %.3f\n", name, unit, min, mean,
+		percentile(values, count, 0.5), percentile(values, count, 0.9), percentile(values, count, 0.99), max);
+
+	int *histogram = calloc(bins, sizeof(int));
+	if (histogram == NULL) {
+		return;
+	}
+	double width = (max - min) / bins;
+	int tallest = 0;
+	for (int i=0; i<count; i++) {
+		int bin = width > 0 ? (int)((values[i] - min) / width) : 0;
+		if (bin >= bins) {
+			bin = bins - 1;
+		}
+		histogram[bin]++;
+		if (histogram[bin] > tallest) {
+			tallest = histogram[bin];
+		}
+	}
+	for (int bin=0; bin<bins; bin++) {
+		int bar = (histogram[bin] * HISTOGRAM_WIDTH + tallest - 1) / tallest;
+		printf("  %10.3f - %-10.3f %7i %.*s\n", min + bin*width, min + (bin+1)*width, histogram[bin], bar,
+			"##################################################");
+	}
+	free(histogram);
+}